@@ -0,0 +1,195 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// Measures the fuzzy fallback of completion, Completer::completeFuzzy(), on
+// prefixes that no phrase starts with: every prefix of 3 to 12 characters of
+// every fifth phrase, with one character replaced by a letter that makes it
+// miss. Each table is searched with no time limit to find the worst-case
+// prefixes, which are listed, and then with the default budget to show
+// that it holds.
+//
+// Usage: bench_fuzzy <table dir>
+
+#include <fcitx-utils/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "completer.h"
+#include "inputtable.h"
+#include "tableformat.h"
+#include "utf8.h"
+
+namespace {
+
+constexpr size_t kPhraseStep = 5;
+constexpr size_t kMinLength = 3;
+constexpr size_t kMaxLength = 12;
+constexpr size_t kWorstCount = 10;
+// Each search is timed this many times, and the fastest time is kept, so
+// that the worst cases are not those the scheduler interrupted.
+constexpr int kRepeats = 3;
+
+std::vector<std::string> listTables(const std::string& dir) {
+  std::vector<std::string> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto& path = entry.path();
+    if ((path.extension() == ".json" ||
+         path.extension() == McFoxIM::TableFormat::kFileExtension) &&
+        path.filename().string().rfind("TW_", 0) == 0) {
+      paths.push_back(path.string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+// Typos of the prefixes of a phrase that no phrase starts with.
+void addTypos(const McFoxIM::InputTable& table, std::string_view phrase,
+              std::vector<std::string>& queries) {
+  std::vector<size_t> ends;
+  for (size_t pos = 0; pos < phrase.size();) {
+    McFoxIM::Utf8::nextCharacter(phrase, pos);
+    ends.push_back(pos);
+  }
+  for (size_t length = kMinLength;
+       length <= std::min(kMaxLength, ends.size()); ++length) {
+    std::string query(phrase.substr(0, ends[length - 1]));
+    // The middle character is replaced.
+    size_t start = length / 2 == 0 ? 0 : ends[length / 2 - 1];
+    size_t end = ends[length / 2];
+    query.replace(start, end - start, query[start] == 'q' ? "x" : "q");
+    auto [first, last] = table.prefixRange(query);
+    if (first == last) {
+      queries.push_back(std::move(query));
+    }
+  }
+}
+
+struct Timing {
+  double micros;
+  size_t table;
+  std::string query;
+  size_t candidates;
+};
+
+std::vector<Timing> run(
+    const std::vector<std::shared_ptr<McFoxIM::InputTable>>& tables,
+    const std::vector<std::vector<std::string>>& queries,
+    std::chrono::microseconds budget) {
+  std::vector<Timing> timings;
+  for (size_t t = 0; t < tables.size(); ++t) {
+    McFoxIM::Completer completer([&, t]() { return tables[t]; });
+    for (const auto& query : queries[t]) {
+      Timing timing{0, t, query, 0};
+      for (int repeat = 0; repeat < kRepeats; ++repeat) {
+        auto start = std::chrono::steady_clock::now();
+        timing.candidates = completer.completeFuzzy(query, budget).size();
+        std::chrono::duration<double, std::micro> elapsed =
+            std::chrono::steady_clock::now() - start;
+        if (repeat == 0 || elapsed.count() < timing.micros) {
+          timing.micros = elapsed.count();
+        }
+      }
+      timings.push_back(std::move(timing));
+    }
+  }
+  std::sort(timings.begin(), timings.end(),
+            [](const Timing& a, const Timing& b) {
+              return a.micros > b.micros;
+            });
+  return timings;
+}
+
+void report(const char* title, const std::vector<Timing>& timings) {
+  double total = 0;
+  size_t found = 0;
+  for (const auto& timing : timings) {
+    total += timing.micros;
+    found += timing.candidates > 0;
+  }
+  auto percentile = [&](double p) {
+    return timings[static_cast<size_t>((1 - p) * (timings.size() - 1))].micros;
+  };
+  std::printf(
+      "  %-10s mean %7.1f us, p50 %7.1f us, p99 %7.1f us, max %7.1f us, "
+      "%zu of %zu with candidates\n",
+      title, total / timings.size(), percentile(0.5), percentile(0.99),
+      timings.front().micros, found, timings.size());
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <table dir>" << std::endl;
+    return 1;
+  }
+  fcitx::Log::setLogRule("*=2");
+
+  auto paths = listTables(argv[1]);
+  std::vector<std::shared_ptr<McFoxIM::InputTable>> tables;
+  std::vector<std::vector<std::string>> queries(paths.size());
+  size_t searches = 0;
+  for (size_t t = 0; t < paths.size(); ++t) {
+    tables.push_back(std::make_shared<McFoxIM::InputTable>());
+    if (!tables[t]->load(paths[t])) {
+      std::cerr << "Failed to load " << paths[t] << std::endl;
+      return 1;
+    }
+    size_t group = 0;
+    for (size_t i = 0; i < tables[t]->size(); i = tables[t]->groupEnd(i)) {
+      if (group++ % kPhraseStep == 0) {
+        addTypos(*tables[t], tables[t]->decodePhraseAt(i), queries[t]);
+      }
+    }
+    searches += queries[t].size();
+  }
+  std::printf("%s: %zu tables, %zu prefixes with a typo\n", argv[1],
+              tables.size(), searches);
+  if (searches == 0) {
+    return 0;
+  }
+
+  auto unlimited = run(tables, queries, std::chrono::hours(1));
+  report("unlimited", unlimited);
+  std::printf("  worst-case prefixes:\n");
+  for (size_t i = 0; i < std::min(kWorstCount, unlimited.size()); ++i) {
+    const auto& timing = unlimited[i];
+    std::printf("    %7.1f us  %-14s %s\n", timing.micros,
+                std::filesystem::path(paths[timing.table])
+                    .stem()
+                    .string()
+                    .c_str(),
+                timing.query.c_str());
+  }
+  report("budget",
+         run(tables, queries, McFoxIM::Completer::kDefaultFuzzyBudget));
+  return 0;
+}
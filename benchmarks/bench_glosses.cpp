@@ -0,0 +1,99 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// Measures the memory the shared gloss dictionary saves when every JSON table
+// is resident at once, comparing tables that keep their own descriptions with
+// tables that intern them in one GlossDictionary. Compiled tables are left
+// out, as they read their descriptions from the mapping either way.
+//
+// Usage: bench_glosses <table dir>...
+
+#include <fcitx-utils/log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glossdictionary.h"
+#include "inputtable.h"
+
+namespace {
+
+std::vector<std::string> listTables(const std::string& dir) {
+  std::vector<std::string> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto& path = entry.path();
+    if (path.extension() == ".json" &&
+        path.filename().string().rfind("TW_", 0) == 0) {
+      paths.push_back(path.string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+size_t loadAll(const std::vector<std::string>& paths,
+               std::shared_ptr<McFoxIM::GlossDictionary> glosses) {
+  std::vector<McFoxIM::InputTable> tables(paths.size());
+  size_t bytes = 0;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    if (!tables[i].load(paths[i], glosses)) {
+      std::cerr << "Failed to load " << paths[i] << std::endl;
+      std::exit(1);
+    }
+    bytes += tables[i].memoryUsage();
+  }
+  return bytes;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <table dir>..." << std::endl;
+    return 1;
+  }
+  fcitx::Log::setLogRule("*=2");
+
+  for (int i = 1; i < argc; ++i) {
+    auto paths = listTables(argv[i]);
+    size_t separate = loadAll(paths, nullptr);
+    auto glosses = std::make_shared<McFoxIM::GlossDictionary>();
+    size_t tables = loadAll(paths, glosses);
+    size_t shared = tables + glosses->memoryUsage();
+
+    std::printf("%s: %zu tables\n", argv[i], paths.size());
+    std::printf("  own descriptions  %8zu KiB\n", separate / 1024);
+    std::printf("  shared glosses    %8zu KiB (%zu KiB for %zu glosses)\n",
+                shared / 1024, glosses->memoryUsage() / 1024,
+                glosses->size());
+    std::printf("  saved             %8zd KiB\n",
+                (static_cast<ssize_t>(separate) - static_cast<ssize_t>(shared)) /
+                    1024);
+  }
+  return 0;
+}
@@ -0,0 +1,161 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// Measures infix searches of the tables: the first page and all the phrases
+// that contain an infix, found by InputTable::infixEntries() with and
+// without the suffix array, and the time and memory it takes to build the
+// arrays. The infixes are the roots learners type: every substring of two
+// to six bytes of every fifth phrase, starting at a character.
+//
+// Usage: bench_infix <table dir>
+
+#include <fcitx-utils/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "inputtable.h"
+#include "tableformat.h"
+
+namespace {
+
+constexpr size_t kPageSize = 9;
+constexpr size_t kPhraseStep = 5;
+constexpr size_t kMinInfix = 2;
+constexpr size_t kMaxInfix = 6;
+
+std::vector<std::string> listTables(const std::string& dir) {
+  std::vector<std::string> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto& path = entry.path();
+    if ((path.extension() == ".json" ||
+         path.extension() == McFoxIM::TableFormat::kFileExtension) &&
+        path.filename().string().rfind("TW_", 0) == 0) {
+      paths.push_back(path.string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+void addInfixes(std::string_view phrase, std::vector<std::string>& queries) {
+  for (size_t start = 0; start < phrase.size(); ++start) {
+    if ((static_cast<uint8_t>(phrase[start]) & 0xc0) == 0x80) {
+      continue;
+    }
+    for (size_t length = kMinInfix;
+         length <= kMaxInfix && start + length <= phrase.size(); ++length) {
+      queries.emplace_back(phrase.substr(start, length));
+    }
+  }
+}
+
+// The mean time of a search and the matches it finds.
+double searchNanos(const std::vector<McFoxIM::InputTable>& tables,
+                   const std::vector<std::vector<std::string>>& queries,
+                   size_t count, size_t& matches) {
+  size_t searches = 0;
+  matches = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < tables.size(); ++t) {
+    for (const auto& query : queries[t]) {
+      matches += tables[t].infixEntries(query, count).size();
+      ++searches;
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (matches < searches) {
+    std::cerr << "Unexpected search results" << std::endl;
+    std::exit(1);
+  }
+  return elapsed.count() / std::max<size_t>(searches, 1);
+}
+
+void reportSearches(const char* title,
+                    const std::vector<McFoxIM::InputTable>& tables,
+                    const std::vector<std::vector<std::string>>& queries) {
+  size_t pageMatches = 0;
+  size_t allMatches = 0;
+  double page = searchNanos(tables, queries, kPageSize, pageMatches);
+  double all = searchNanos(tables, queries, SIZE_MAX, allMatches);
+  std::printf("  %-12s first page %9.0f ns, all %9.0f ns (%zu matches)\n",
+              title, page, all, allMatches);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <table dir>" << std::endl;
+    return 1;
+  }
+  fcitx::Log::setLogRule("*=2");
+
+  auto paths = listTables(argv[1]);
+  std::vector<McFoxIM::InputTable> tables(paths.size());
+  std::vector<std::vector<std::string>> queries(paths.size());
+  size_t phrases = 0;
+  size_t searches = 0;
+  size_t tableBytes = 0;
+  for (size_t t = 0; t < paths.size(); ++t) {
+    if (!tables[t].load(paths[t])) {
+      std::cerr << "Failed to load " << paths[t] << std::endl;
+      return 1;
+    }
+    size_t group = 0;
+    for (size_t i = 0; i < tables[t].size(); i = tables[t].groupEnd(i)) {
+      if (group++ % kPhraseStep == 0) {
+        addInfixes(tables[t].decodePhraseAt(i), queries[t]);
+      }
+    }
+    phrases += tables[t].size();
+    searches += queries[t].size();
+    tableBytes += tables[t].memoryUsage();
+  }
+  std::printf("%s: %zu phrases (%zu KiB), %zu infixes\n", argv[1], phrases,
+              tableBytes / 1024, searches);
+  reportSearches("scan", tables, queries);
+
+  size_t indexedBytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (auto& table : tables) {
+    table.buildInfixIndex();
+    indexedBytes += table.memoryUsage();
+  }
+  std::chrono::duration<double, std::milli> buildTime =
+      std::chrono::steady_clock::now() - start;
+  std::printf("  index build  %8.1f ms, %zu KiB (%.1f bytes/phrase)\n",
+              buildTime.count(), (indexedBytes - tableBytes) / 1024,
+              static_cast<double>(indexedBytes - tableBytes) /
+                  std::max<size_t>(phrases, 1));
+  reportSearches("suffix array", tables, queries);
+  return 0;
+}
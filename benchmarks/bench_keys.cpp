@@ -0,0 +1,170 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// Compares the plain phrase layout of InputTable with front-coded phrases:
+// the memory held by every table, and the latency of a completion lookup
+// (finding the prefix range and reading every phrase in it, as Completer
+// does) for prefixes of the phrases in the table. A synthetic table stands
+// in for a large user glossary.
+//
+// Usage: bench_keys <table dir> [<synthetic entry count>]
+
+#include <fcitx-utils/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "inputtable.h"
+#include "tableformat.h"
+
+namespace {
+
+constexpr size_t kDefaultSyntheticEntries = 200000;
+
+std::vector<std::string> listTables(const std::string& dir) {
+  std::vector<std::string> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto& path = entry.path();
+    if ((path.extension() == ".json" ||
+         path.extension() == McFoxIM::TableFormat::kFileExtension) &&
+        path.filename().string().rfind("TW_", 0) == 0) {
+      paths.push_back(path.string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+// Writes a table of random words built from Formosan-like syllables, which
+// share prefixes the way real glossaries do.
+std::string writeSyntheticTable(size_t entries) {
+  static const char* syllables[] = {"a",  "ka", "ma", "na", "pa", "sa",
+                                    "ta", "la", "ng", "ay", "aw", "i",
+                                    "u",  "ce", "fo", "ra", "’a", "ˈo"};
+  std::mt19937 random(42);
+  std::uniform_int_distribution<size_t> syllable(0, std::size(syllables) - 1);
+  std::uniform_int_distribution<int> length(2, 6);
+
+  auto path =
+      (std::filesystem::temp_directory_path() / "bench_keys_synthetic.json")
+          .string();
+  std::ofstream out(path);
+  out << R"({"name": "Synthetic", "data": [)";
+  for (size_t i = 0; i < entries; ++i) {
+    std::string word;
+    for (int n = length(random); n > 0; --n) {
+      word += syllables[syllable(random)];
+    }
+    out << (i ? "," : "") << "[\"" << word << "\", \"" << i << "\"]";
+  }
+  out << "]}";
+  return path;
+}
+
+std::vector<std::string> makeQueries(const McFoxIM::InputTable& table) {
+  std::vector<std::string> queries;
+  size_t step = std::max<size_t>(1, table.size() / 500);
+  for (size_t i = 0; i < table.size(); i += step) {
+    std::string phrase = table.decodePhraseAt(i);
+    for (size_t length = 1; length <= phrase.size(); ++length) {
+      queries.push_back(phrase.substr(0, length));
+    }
+  }
+  return queries;
+}
+
+double lookupMicros(const std::vector<McFoxIM::InputTable>& tables,
+                    const std::vector<std::vector<std::string>>& queries) {
+  size_t lookups = 0;
+  size_t bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < tables.size(); ++t) {
+    for (const auto& query : queries[t]) {
+      auto [first, last] = tables[t].prefixRange(query);
+      tables[t].visitPhrases(
+          first, last,
+          [&bytes](size_t, std::string_view phrase) { bytes += phrase.size(); });
+      ++lookups;
+    }
+  }
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (bytes == 0) {
+    std::cerr << "No phrases found" << std::endl;
+  }
+  return elapsed.count() / std::max<size_t>(lookups, 1);
+}
+
+void compare(const std::string& label, const std::vector<std::string>& paths) {
+  std::vector<McFoxIM::InputTable> plain(paths.size());
+  std::vector<McFoxIM::InputTable> compressed(paths.size());
+  std::vector<std::vector<std::string>> queries;
+  size_t plainBytes = 0;
+  size_t compressedBytes = 0;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    if (!plain[i].load(paths[i]) || !compressed[i].load(paths[i])) {
+      std::cerr << "Failed to load " << paths[i] << std::endl;
+      std::exit(1);
+    }
+    compressed[i].compressKeys();
+    plainBytes += plain[i].memoryUsage();
+    compressedBytes += compressed[i].memoryUsage();
+    queries.push_back(makeQueries(plain[i]));
+  }
+
+  std::printf("%s\n", label.c_str());
+  std::printf("  plain        %8zu KiB %8.2f us/lookup\n", plainBytes / 1024,
+              lookupMicros(plain, queries));
+  std::printf("  front-coded  %8zu KiB %8.2f us/lookup\n",
+              compressedBytes / 1024, lookupMicros(compressed, queries));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " <table dir> [<synthetic entry count>]" << std::endl;
+    return 1;
+  }
+  fcitx::Log::setLogRule("*=2");
+
+  auto paths = listTables(argv[1]);
+  compare(std::to_string(paths.size()) + " tables in " + argv[1], paths);
+
+  size_t entries =
+      argc > 2 ? std::strtoul(argv[2], nullptr, 10) : kDefaultSyntheticEntries;
+  auto synthetic = writeSyntheticTable(entries);
+  compare("synthetic table of " + std::to_string(entries) + " entries",
+          {synthetic});
+  std::filesystem::remove(synthetic);
+  return 0;
+}
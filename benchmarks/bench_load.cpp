@@ -0,0 +1,158 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// Compares the ways an input table can be loaded: the DOM-based JSON loader
+// InputTable used to have, the streaming JSON loader, and mapping a compiled
+// table. Each loader runs in a forked child so that its peak RSS is measured
+// on its own.
+//
+// Usage: bench_load <json dir> [<compiled table dir>]
+
+#include <fcitx-utils/log.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "inputtable.h"
+#include "tableformat.h"
+
+namespace {
+
+constexpr int kIterations = 20;
+
+struct DomEntry {
+  std::string phrase;
+  std::string description;
+};
+
+// The loader InputTable::load used before the streaming parser.
+size_t loadWithDom(const std::string& path) {
+  std::ifstream f(path);
+  nlohmann::json j;
+  f >> j;
+  std::string name = j.value("name", "");
+  std::vector<DomEntry> entries;
+  if (j.contains("data") && j["data"].is_array()) {
+    for (const auto& item : j["data"]) {
+      if (item.is_array() && item.size() >= 2) {
+        entries.push_back(
+            {item[0].get<std::string>(), item[1].get<std::string>()});
+      }
+    }
+  }
+  return entries.size();
+}
+
+size_t loadWithInputTable(const std::string& path) {
+  McFoxIM::InputTable table;
+  if (!table.load(path)) {
+    std::cerr << "Failed to load " << path << std::endl;
+    std::exit(1);
+  }
+  return table.size();
+}
+
+long maxRssKiB() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+std::vector<std::string> listTables(const std::string& dir,
+                                    const std::string& extension) {
+  std::vector<std::string> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto& path = entry.path();
+    if (path.extension() == extension &&
+        path.filename().string().rfind("TW_", 0) == 0) {
+      paths.push_back(path.string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+void run(const std::string& label, const std::vector<std::string>& paths,
+         const std::function<size_t(const std::string&)>& loader) {
+  std::cout.flush();
+  pid_t pid = fork();
+  if (pid != 0) {
+    waitpid(pid, nullptr, 0);
+    return;
+  }
+
+  // One pass with a single table resident at a time measures the peak of a
+  // table switch.
+  long baseline = maxRssKiB();
+  size_t entries = 0;
+  for (const auto& path : paths) {
+    entries += loader(path);
+  }
+  long peak = maxRssKiB() - baseline;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; ++i) {
+    for (const auto& path : paths) {
+      loader(path);
+    }
+  }
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  double perTable = elapsed.count() / kIterations / paths.size();
+
+  std::printf("%-10s %6zu tables %8zu entries %10.1f us/table %8ld KiB peak\n",
+              label.c_str(), paths.size(), entries, perTable, peak);
+  std::fflush(stdout);
+  _exit(0);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <json dir> [<compiled table dir>]"
+              << std::endl;
+    return 1;
+  }
+  fcitx::Log::setLogRule("*=2");
+
+  auto jsonTables = listTables(argv[1], ".json");
+  run("dom", jsonTables, loadWithDom);
+  run("streaming", jsonTables, loadWithInputTable);
+  if (argc > 2) {
+    run("compiled",
+        listTables(argv[2], McFoxIM::TableFormat::kFileExtension),
+        loadWithInputTable);
+  }
+  return 0;
+}
@@ -0,0 +1,183 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// Compares exact phrase lookups: the binary search and copy that
+// InputTable::getCandidates used to do, the same search without the copy,
+// and the perfect hash behind InputTable::equalRange. Half of the queries
+// are phrases of the table and half are not. Also reports the time and
+// memory it takes to build the hashes, which a table does on its first
+// exact lookup.
+//
+// Usage: bench_lookup <table dir>
+
+#include <fcitx-utils/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "inputtable.h"
+#include "perfecthash.h"
+#include "tableformat.h"
+
+namespace {
+
+constexpr int kRounds = 20;
+
+std::vector<std::string> listTables(const std::string& dir) {
+  std::vector<std::string> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto& path = entry.path();
+    if ((path.extension() == ".json" ||
+         path.extension() == McFoxIM::TableFormat::kFileExtension) &&
+        path.filename().string().rfind("TW_", 0) == 0) {
+      paths.push_back(path.string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+// The lookup before the perfect hash: the prefix range of the key, the
+// entries of the same length at its front, and a copy of each of them.
+std::vector<McFoxIM::InputTable::Entry> searchAndCopy(
+    const McFoxIM::InputTable& table, std::string_view key) {
+  auto [first, last] = table.prefixRange(key);
+  std::vector<McFoxIM::InputTable::Entry> results;
+  for (size_t i = first; i < last; ++i) {
+    std::string phrase = table.decodePhraseAt(i);
+    if (phrase.size() != key.size()) {
+      break;
+    }
+    results.push_back({std::move(phrase), std::string(table.descriptionAt(i))});
+  }
+  return results;
+}
+
+std::pair<size_t, size_t> search(const McFoxIM::InputTable& table,
+                                 std::string_view key) {
+  auto [first, last] = table.prefixRange(key);
+  size_t end = first;
+  std::string buffer;
+  while (end < last && table.phraseAt(end, buffer).size() == key.size()) {
+    ++end;
+  }
+  return {first, end};
+}
+
+template <typename Lookup>
+double lookupNanos(const std::vector<McFoxIM::InputTable>& tables,
+                   const std::vector<std::vector<std::string>>& queries,
+                   Lookup&& lookup) {
+  size_t lookups = 0;
+  size_t found = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < kRounds; ++round) {
+    for (size_t t = 0; t < tables.size(); ++t) {
+      for (const auto& query : queries[t]) {
+        found += lookup(tables[t], query);
+        ++lookups;
+      }
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (found != lookups / 2) {
+    std::cerr << "Unexpected lookup results" << std::endl;
+    std::exit(1);
+  }
+  return elapsed.count() / std::max<size_t>(lookups, 1);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <table dir>" << std::endl;
+    return 1;
+  }
+  fcitx::Log::setLogRule("*=2");
+
+  auto paths = listTables(argv[1]);
+  std::vector<McFoxIM::InputTable> tables(paths.size());
+  std::vector<std::vector<std::string>> queries(paths.size());
+  size_t phrases = 0;
+  size_t hashBytes = 0;
+  std::chrono::duration<double, std::micro> buildTime{0};
+  for (size_t t = 0; t < paths.size(); ++t) {
+    if (!tables[t].load(paths[t])) {
+      std::cerr << "Failed to load " << paths[t] << std::endl;
+      return 1;
+    }
+    std::vector<uint64_t> hashes;
+    for (size_t i = 0; i < tables[t].size(); i = tables[t].groupEnd(i)) {
+      std::string phrase = tables[t].decodePhraseAt(i);
+      hashes.push_back(McFoxIM::PerfectHash::hash(phrase));
+      queries[t].push_back(phrase);
+      // Not a phrase, since phrases are grouped.
+      queries[t].push_back(phrase + "\x01");
+    }
+    phrases += hashes.size();
+
+    auto start = std::chrono::steady_clock::now();
+    McFoxIM::PerfectHash hash;
+    if (!hash.build(hashes)) {
+      std::cerr << "Failed to hash " << paths[t] << std::endl;
+      return 1;
+    }
+    buildTime += std::chrono::steady_clock::now() - start;
+    hashBytes += hash.memoryUsage();
+    // Builds the index of the table, which otherwise the first timed lookup
+    // would.
+    tables[t].equalRange(queries[t].front());
+  }
+
+  std::printf("%zu tables in %s, %zu distinct phrases\n", paths.size(),
+              argv[1], phrases);
+  std::printf("  hash build       %8.0f us, %zu KiB (%.2f bytes/phrase)\n",
+              buildTime.count(), hashBytes / 1024,
+              static_cast<double>(hashBytes) / std::max<size_t>(phrases, 1));
+  std::printf("  search and copy  %8.1f ns/lookup\n",
+              lookupNanos(tables, queries,
+                          [](const auto& table, const std::string& query) {
+                            return !searchAndCopy(table, query).empty();
+                          }));
+  std::printf("  search           %8.1f ns/lookup\n",
+              lookupNanos(tables, queries,
+                          [](const auto& table, const std::string& query) {
+                            auto [first, last] = search(table, query);
+                            return first != last;
+                          }));
+  std::printf("  perfect hash     %8.1f ns/lookup\n",
+              lookupNanos(tables, queries,
+                          [](const auto& table, const std::string& query) {
+                            auto [first, last] = table.equalRange(query);
+                            return first != last;
+                          }));
+  return 0;
+}
@@ -0,0 +1,172 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// Measures reverse lookups of the tables, InputTable::glossEntries(), against
+// a scan of every description. The queries are every substring of every
+// tenth description, as a teacher would paste a gloss, and the first lookup
+// of each table, which builds its index, is reported on its own.
+//
+// Usage: bench_reverse <table dir>
+
+#include <fcitx-utils/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "inputtable.h"
+#include "tableformat.h"
+
+namespace {
+
+constexpr size_t kDescriptionStep = 10;
+
+std::vector<std::string> listTables(const std::string& dir) {
+  std::vector<std::string> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto& path = entry.path();
+    if ((path.extension() == ".json" ||
+         path.extension() == McFoxIM::TableFormat::kFileExtension) &&
+        path.filename().string().rfind("TW_", 0) == 0) {
+      paths.push_back(path.string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+bool startsCharacter(char byte) {
+  return (static_cast<uint8_t>(byte) & 0xc0) != 0x80;
+}
+
+void addSubstrings(std::string_view text, std::vector<std::string>& queries) {
+  for (size_t start = 0; start < text.size(); ++start) {
+    if (!startsCharacter(text[start])) {
+      continue;
+    }
+    for (size_t end = start + 1; end <= text.size(); ++end) {
+      if (end == text.size() || startsCharacter(text[end])) {
+        queries.emplace_back(text.substr(start, end - start));
+      }
+    }
+  }
+}
+
+size_t scan(const McFoxIM::InputTable& table, std::string_view query) {
+  size_t matches = 0;
+  for (size_t i = 0; i < table.size(); ++i) {
+    if (table.descriptionAt(i).find(query) != std::string_view::npos) {
+      ++matches;
+    }
+  }
+  return matches;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <table dir>" << std::endl;
+    return 1;
+  }
+  fcitx::Log::setLogRule("*=2");
+
+  auto paths = listTables(argv[1]);
+  std::vector<McFoxIM::InputTable> tables(paths.size());
+  std::vector<std::vector<std::string>> queries(paths.size());
+  size_t entries = 0;
+  size_t searches = 0;
+  size_t tableBytes = 0;
+  for (size_t t = 0; t < paths.size(); ++t) {
+    if (!tables[t].load(paths[t])) {
+      std::cerr << "Failed to load " << paths[t] << std::endl;
+      return 1;
+    }
+    for (size_t i = 0; i < tables[t].size(); i += kDescriptionStep) {
+      addSubstrings(tables[t].descriptionAt(i), queries[t]);
+    }
+    entries += tables[t].size();
+    searches += queries[t].size();
+    tableBytes += tables[t].memoryUsage();
+  }
+  std::printf("%s: %zu entries, %zu queries\n", argv[1], entries, searches);
+
+  std::chrono::duration<double, std::milli> slowestFirst{0};
+  std::chrono::duration<double, std::milli> firstTotal{0};
+  size_t indexBytes = 0;
+  for (const auto& table : tables) {
+    auto start = std::chrono::steady_clock::now();
+    table.glossEntries("的");
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    firstTotal += elapsed;
+    slowestFirst = std::max(slowestFirst, elapsed);
+    indexBytes += table.memoryUsage();
+  }
+  indexBytes -= tableBytes;
+  std::printf(
+      "  first lookup  %6.2f ms slowest, %6.1f ms in all, %zu KiB of index "
+      "(%.1f bytes/entry)\n",
+      slowestFirst.count(), firstTotal.count(), indexBytes / 1024,
+      static_cast<double>(indexBytes) / std::max<size_t>(entries, 1));
+
+  size_t indexMatches = 0;
+  size_t scanMatches = 0;
+  double slowest = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < tables.size(); ++t) {
+    for (const auto& query : queries[t]) {
+      auto queryStart = std::chrono::steady_clock::now();
+      indexMatches += tables[t].glossEntries(query).size();
+      std::chrono::duration<double, std::micro> elapsed =
+          std::chrono::steady_clock::now() - queryStart;
+      slowest = std::max(slowest, elapsed.count());
+    }
+  }
+  std::chrono::duration<double, std::nano> indexTime =
+      std::chrono::steady_clock::now() - start;
+  start = std::chrono::steady_clock::now();
+  for (size_t t = 0; t < tables.size(); ++t) {
+    for (const auto& query : queries[t]) {
+      scanMatches += scan(tables[t], query);
+    }
+  }
+  std::chrono::duration<double, std::nano> scanTime =
+      std::chrono::steady_clock::now() - start;
+  if (indexMatches != scanMatches) {
+    std::cerr << "Unexpected lookup results" << std::endl;
+    return 1;
+  }
+  std::printf("  scan          %8.0f ns/query\n",
+              scanTime.count() / std::max<size_t>(searches, 1));
+  std::printf("  index         %8.0f ns/query, slowest %.1f us (%zu matches)\n",
+              indexTime.count() / std::max<size_t>(searches, 1), slowest,
+              indexMatches);
+  return 0;
+}
@@ -0,0 +1,231 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// Times the KeyScan kernels at each level the CPU supports, on the phrases
+// of the tables in the given directory:
+//
+// - the end of the run of phrases that start with a prefix, for every
+//   prefix of every phrase, against the binary search that prefixRange()
+//   does for longer runs, for prefixes of up to 8 bytes and longer ones;
+// - finding upper case letters in every phrase, and lowering them.
+//
+// Usage: bench_scan <table dir>
+
+#include <fcitx-utils/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "inputtable.h"
+#include "keyscan.h"
+#include "tableformat.h"
+
+namespace {
+
+constexpr int kRounds = 20;
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<std::string> listTables(const std::string& dir) {
+  std::vector<std::string> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto& path = entry.path();
+    if ((path.extension() == ".json" ||
+         path.extension() == McFoxIM::TableFormat::kFileExtension) &&
+        path.filename().string().rfind("TW_", 0) == 0) {
+      paths.push_back(path.string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+// The phrases of a table in one arena, the way the table stores them.
+struct Keys {
+  std::string arena;
+  std::vector<uint32_t> offsets{0};
+
+  size_t size() const { return offsets.size() - 1; }
+  std::string_view at(size_t index) const {
+    return std::string_view(arena).substr(
+        offsets[index], offsets[index + 1] - offsets[index]);
+  }
+};
+
+// A prefix and the first phrase that starts with it.
+struct Query {
+  size_t table;
+  size_t first;
+  std::string prefix;
+};
+
+const char* levelName(McFoxIM::KeyScan::Level level) {
+  switch (level) {
+    case McFoxIM::KeyScan::Level::kScalar:
+      return "scalar";
+    case McFoxIM::KeyScan::Level::kSse42:
+      return "sse4.2";
+    case McFoxIM::KeyScan::Level::kAvx2:
+      return "avx2";
+  }
+  return "";
+}
+
+template <typename Run>
+double nanosPer(size_t count, Run&& run) {
+  auto start = Clock::now();
+  for (int round = 0; round < kRounds; ++round) {
+    run();
+  }
+  std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+  return elapsed.count() / (kRounds * std::max<size_t>(count, 1));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <table dir>" << std::endl;
+    return 1;
+  }
+  fcitx::Log::setLogRule("*=2");
+
+  std::vector<Keys> tables;
+  std::vector<Query> queries;
+  size_t phrases = 0;
+  size_t bytes = 0;
+  for (const auto& path : listTables(argv[1])) {
+    McFoxIM::InputTable table;
+    if (!table.load(path)) {
+      std::cerr << "Failed to load " << path << std::endl;
+      return 1;
+    }
+    auto& keys = tables.emplace_back();
+    table.visitPhrases(0, table.size(),
+                       [&](size_t, std::string_view phrase) {
+                         keys.arena.append(phrase);
+                         keys.offsets.push_back(keys.arena.size());
+                       });
+    for (size_t i = 0; i < keys.size(); ++i) {
+      auto phrase = keys.at(i);
+      for (size_t length = 1; length <= phrase.size(); ++length) {
+        // Only the first phrase of each prefix.
+        if (i == 0 || !keys.at(i - 1).starts_with(phrase.substr(0, length))) {
+          queries.push_back(
+              {tables.size() - 1, i, std::string(phrase.substr(0, length))});
+        }
+      }
+    }
+    phrases += keys.size();
+    bytes += keys.arena.size();
+  }
+  std::printf("%zu tables in %s, %zu phrases, %zu bytes, %zu prefixes\n",
+              tables.size(), argv[1], phrases, bytes, queries.size());
+
+  size_t expected = 0;
+  std::printf("  run end, binary search  %6.1f ns/prefix\n",
+              nanosPer(queries.size(), [&]() {
+                size_t total = 0;
+                for (const auto& query : queries) {
+                  const auto& keys = tables[query.table];
+                  size_t left = query.first;
+                  size_t right = keys.size();
+                  while (left < right) {
+                    size_t mid = left + (right - left) / 2;
+                    if (keys.at(mid).starts_with(query.prefix)) {
+                      left = mid + 1;
+                    } else {
+                      right = mid;
+                    }
+                  }
+                  total += left - query.first;
+                }
+                expected = total;
+              }));
+
+  using Level = McFoxIM::KeyScan::Level;
+  for (auto level : {Level::kScalar, Level::kSse42, Level::kAvx2}) {
+    if (level > McFoxIM::KeyScan::supportedLevel()) {
+      std::printf("  %s: not supported\n", levelName(level));
+      continue;
+    }
+    const auto& kernels = McFoxIM::KeyScan::kernels(level);
+    // Prefixes of at most a word, and longer ones.
+    double runEnd[2];
+    size_t total = 0;
+    for (bool longer : {false, true}) {
+      size_t count = 0;
+      for (const auto& query : queries) {
+        count += (query.prefix.size() > 8) == longer;
+      }
+      runEnd[longer] = nanosPer(count, [&]() {
+        for (const auto& query : queries) {
+          if ((query.prefix.size() > 8) != longer) {
+            continue;
+          }
+          const auto& keys = tables[query.table];
+          total += kernels.prefixRunEnd(keys.arena.data(), keys.arena.size(),
+                                        keys.offsets.data(), query.first,
+                                        keys.size(), query.prefix) -
+                   query.first;
+        }
+      });
+    }
+    if (total != expected * kRounds) {
+      std::cerr << "Unexpected run ends" << std::endl;
+      return 1;
+    }
+
+    size_t upper = 0;
+    double hasUpper = nanosPer(phrases, [&]() {
+      upper = 0;
+      for (const auto& keys : tables) {
+        for (size_t i = 0; i < keys.size(); ++i) {
+          auto phrase = keys.at(i);
+          upper += kernels.hasUpper(phrase.data(), phrase.size());
+        }
+      }
+    });
+    std::vector<std::string> copies;
+    for (const auto& keys : tables) {
+      copies.push_back(keys.arena);
+    }
+    double toLower = nanosPer(bytes, [&]() {
+      for (auto& copy : copies) {
+        kernels.toLower(copy.data(), copy.size());
+      }
+    });
+    std::printf(
+        "  %-6s run end %5.1f / %5.1f ns/prefix, has upper %5.1f ns/phrase "
+        "(%zu), lower %5.2f ns/byte\n",
+        levelName(level), runEnd[false], runEnd[true], hasUpper, upper,
+        toLower);
+  }
+  return 0;
+}
@@ -0,0 +1,345 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// Compares the prefix search layouts of InputTable: a binary search over
+// the phrase arena, which tables used before they had a search index, the
+// trie, and the Eytzinger array. Every prefix of every phrase is a query.
+// Runs on the tables in the given directory and on a synthetic table of a
+// million phrases.
+//
+// Besides the time per search with warm caches, each layout is timed with
+// the caches flushed before every search. Divided by the time of one miss
+// to memory, measured with a pointer chase, that is about the number of
+// cache misses per search. Where the kernel allows it, the last level cache
+// misses of the warm searches are also counted.
+//
+// Usage: bench_search <table dir>
+
+#include <fcitx-utils/log.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "inputtable.h"
+#include "tableformat.h"
+
+namespace {
+
+constexpr int kRounds = 5;
+constexpr size_t kSyntheticSize = 1000000;
+constexpr size_t kSyntheticQueries = 20000;
+// Searches timed with flushed caches.
+constexpr size_t kColdSearches = 2000;
+// Larger than the last level cache.
+constexpr size_t kFlushBytes = 64 << 20;
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<std::string> listTables(const std::string& dir) {
+  std::vector<std::string> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto& path = entry.path();
+    if ((path.extension() == ".json" ||
+         path.extension() == McFoxIM::TableFormat::kFileExtension) &&
+        path.filename().string().rfind("TW_", 0) == 0) {
+      paths.push_back(path.string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+// The phrases of a table in one arena, the way the table stores them, with
+// the search tables did before they had an index.
+class Keys {
+ public:
+  explicit Keys(const McFoxIM::InputTable& table) {
+    table.visitPhrases(0, table.size(),
+                       [this](size_t, std::string_view phrase) {
+                         offsets_.push_back(arena_.size());
+                         arena_.append(phrase);
+                       });
+    offsets_.push_back(arena_.size());
+  }
+
+  size_t size() const { return offsets_.size() - 1; }
+  std::string_view at(size_t index) const {
+    return std::string_view(arena_).substr(
+        offsets_[index], offsets_[index + 1] - offsets_[index]);
+  }
+
+  std::pair<size_t, size_t> prefixRange(std::string_view prefix) const {
+    size_t left = 0;
+    size_t right = size();
+    while (left < right) {
+      size_t mid = left + (right - left) / 2;
+      if (at(mid) < prefix) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    size_t first = left;
+    right = size();
+    while (left < right) {
+      size_t mid = left + (right - left) / 2;
+      if (at(mid).starts_with(prefix)) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    return {first, left};
+  }
+
+ private:
+  std::string arena_;
+  std::vector<uint32_t> offsets_;
+};
+
+// Counts the last level cache misses of this thread, if the kernel lets it.
+class MissCounter {
+ public:
+  MissCounter() {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+  ~MissCounter() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  bool available() const { return fd_ >= 0; }
+  void start() {
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+  uint64_t stop() {
+    uint64_t count = 0;
+    if (fd_ >= 0) {
+      ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+      }
+    }
+    return count;
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+std::vector<char>& flushBuffer() {
+  static std::vector<char> buffer(kFlushBytes, 1);
+  return buffer;
+}
+
+void flushCaches() {
+  auto& buffer = flushBuffer();
+  for (size_t i = 0; i < buffer.size(); i += 64) {
+    ++buffer[i];
+  }
+}
+
+// The time of a load that misses every cache, from a random pointer chase.
+double missNanos() {
+  std::vector<size_t> next(kFlushBytes / sizeof(size_t));
+  std::vector<size_t> order(next.size() / 8);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), std::mt19937(7));
+  for (size_t i = 0; i < order.size(); ++i) {
+    next[order[i] * 8] = order[(i + 1) % order.size()] * 8;
+  }
+  constexpr size_t kLoads = 2000000;
+  size_t slot = order.front() * 8;
+  auto start = Clock::now();
+  for (size_t i = 0; i < kLoads; ++i) {
+    slot = next[slot];
+  }
+  std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+  if (slot == next.size()) {
+    std::exit(1);
+  }
+  return elapsed.count() / kLoads;
+}
+
+struct Query {
+  size_t table;
+  std::string prefix;
+};
+
+template <typename Search>
+void measure(const char* name, const std::vector<Query>& queries,
+             double missTime, Search&& search) {
+  MissCounter counter;
+  size_t matches = 0;
+  counter.start();
+  auto start = Clock::now();
+  for (int round = 0; round < kRounds; ++round) {
+    for (const auto& query : queries) {
+      auto [first, last] = search(query);
+      matches += last - first;
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+  uint64_t misses = counter.stop();
+  size_t searches = kRounds * queries.size();
+
+  // Every query, spread over the tables.
+  std::chrono::duration<double, std::nano> cold{0};
+  size_t step = std::max<size_t>(queries.size() / kColdSearches, 1);
+  size_t coldSearches = 0;
+  for (size_t i = 0; i < queries.size(); i += step) {
+    flushCaches();
+    auto coldStart = Clock::now();
+    auto [first, last] = search(queries[i]);
+    cold += Clock::now() - coldStart;
+    matches += last - first;
+    ++coldSearches;
+  }
+  if (matches < searches) {
+    std::cerr << "Unexpected search results" << std::endl;
+    std::exit(1);
+  }
+
+  double coldNanos = cold.count() / coldSearches;
+  std::printf("  %-14s %7.1f ns/search, cold %7.1f ns (~%4.1f misses)", name,
+              elapsed.count() / searches, coldNanos, coldNanos / missTime);
+  if (counter.available()) {
+    std::printf(", %5.2f LLC misses/search",
+                static_cast<double>(misses) / searches);
+  }
+  std::printf("\n");
+}
+
+void report(const char* title, std::vector<McFoxIM::InputTable>& tables,
+            const std::vector<Query>& queries, double missTime) {
+  std::vector<Keys> keys;
+  size_t phrases = 0;
+  for (const auto& table : tables) {
+    keys.emplace_back(table);
+    phrases += table.size();
+  }
+  std::printf("%s: %zu phrases, %zu searches\n", title, phrases,
+              queries.size());
+
+  measure("binary search", queries, missTime, [&](const Query& query) {
+    return keys[query.table].prefixRange(query.prefix);
+  });
+  using Layout = McFoxIM::InputTable::SearchLayout;
+  for (auto [layout, name] : {std::pair(Layout::kTrie, "trie"),
+                              std::pair(Layout::kEytzinger, "eytzinger")}) {
+    size_t bytes = 0;
+    for (auto& table : tables) {
+      table.setSearchLayout(layout);
+      bytes += table.memoryUsage();
+    }
+    std::printf("  %-14s %zu KiB in the tables\n", name, bytes / 1024);
+    measure(name, queries, missTime, [&](const Query& query) {
+      return tables[query.table].prefixRange(query.prefix);
+    });
+  }
+}
+
+// Every prefix of a phrase, shortest first.
+void addKeystrokes(size_t table, std::string_view phrase,
+                   std::vector<Query>& queries) {
+  for (size_t length = 1; length <= phrase.size(); ++length) {
+    queries.push_back({table, std::string(phrase.substr(0, length))});
+  }
+}
+
+// Phrases of an Amis-like alphabet, with the length of real phrases.
+std::vector<McFoxIM::InputTable::Entry> syntheticEntries() {
+  static constexpr std::string_view kLetters = "aaaacdefghiiklmnnoprsttuwy'^";
+  std::mt19937 random(19);
+  std::uniform_int_distribution<size_t> letter(0, kLetters.size() - 1);
+  std::uniform_int_distribution<size_t> length(3, 14);
+  std::vector<McFoxIM::InputTable::Entry> entries(kSyntheticSize);
+  for (auto& entry : entries) {
+    for (size_t i = length(random); i > 0; --i) {
+      entry.phrase += kLetters[letter(random)];
+    }
+  }
+  return entries;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <table dir>" << std::endl;
+    return 1;
+  }
+  fcitx::Log::setLogRule("*=2");
+
+  double missTime = missNanos();
+  std::printf("memory miss: %.1f ns\n", missTime);
+
+  auto paths = listTables(argv[1]);
+  std::vector<McFoxIM::InputTable> tables(paths.size());
+  std::vector<Query> queries;
+  for (size_t t = 0; t < paths.size(); ++t) {
+    if (!tables[t].load(paths[t])) {
+      std::cerr << "Failed to load " << paths[t] << std::endl;
+      return 1;
+    }
+    for (size_t i = 0; i < tables[t].size(); i = tables[t].groupEnd(i)) {
+      addKeystrokes(t, tables[t].decodePhraseAt(i), queries);
+    }
+  }
+  report(argv[1], tables, queries, missTime);
+
+  std::vector<McFoxIM::InputTable> synthetic(1);
+  synthetic[0].assign("Synthetic", syntheticEntries());
+  std::vector<Query> syntheticQueries;
+  size_t step = synthetic[0].size() / kSyntheticQueries;
+  for (size_t i = 0; i < synthetic[0].size(); i += step) {
+    addKeystrokes(0, synthetic[0].decodePhraseAt(i), syntheticQueries);
+  }
+  report("synthetic", synthetic, syntheticQueries, missTime);
+  return 0;
+}
@@ -0,0 +1,244 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+// Compares prefix searches per keystroke: the binary search that
+// InputTable::prefixRange used to do, over the same phrase arena, and the
+// trie it follows now. Every prefix of every phrase is a query, as typed
+// one key at a time. Runs on the tables in the given directory and on a
+// synthetic table of a million phrases, and reports the time and memory
+// it takes to build the tries.
+//
+// Usage: bench_trie <table dir>
+
+#include <fcitx-utils/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "inputtable.h"
+#include "prefixtrie.h"
+#include "tableformat.h"
+
+namespace {
+
+constexpr int kRounds = 5;
+constexpr size_t kSyntheticSize = 1000000;
+// Queries sampled from the synthetic table.
+constexpr size_t kSyntheticQueries = 20000;
+
+std::vector<std::string> listTables(const std::string& dir) {
+  std::vector<std::string> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto& path = entry.path();
+    if ((path.extension() == ".json" ||
+         path.extension() == McFoxIM::TableFormat::kFileExtension) &&
+        path.filename().string().rfind("TW_", 0) == 0) {
+      paths.push_back(path.string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+// The phrases of a table in one arena, the way the table stores them.
+class Keys {
+ public:
+  explicit Keys(const McFoxIM::InputTable& table) {
+    table.visitPhrases(0, table.size(),
+                       [this](size_t, std::string_view phrase) {
+                         offsets_.push_back(arena_.size());
+                         arena_.append(phrase);
+                       });
+    offsets_.push_back(arena_.size());
+  }
+
+  size_t size() const { return offsets_.size() - 1; }
+  std::string_view at(size_t index) const {
+    return std::string_view(arena_).substr(
+        offsets_[index], offsets_[index + 1] - offsets_[index]);
+  }
+
+  // The search before the trie.
+  std::pair<size_t, size_t> prefixRange(std::string_view prefix) const {
+    size_t left = 0;
+    size_t right = size();
+    while (left < right) {
+      size_t mid = left + (right - left) / 2;
+      if (at(mid) < prefix) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    size_t first = left;
+    right = size();
+    while (left < right) {
+      size_t mid = left + (right - left) / 2;
+      if (at(mid).substr(0, prefix.size()) == prefix) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    return {first, left};
+  }
+
+  size_t memoryUsage() const {
+    return arena_.capacity() + offsets_.capacity() * sizeof(uint32_t);
+  }
+
+ private:
+  std::string arena_;
+  std::vector<uint32_t> offsets_;
+};
+
+// Every prefix of a phrase, shortest first.
+void addKeystrokes(std::string_view phrase, std::vector<std::string>& queries) {
+  for (size_t length = 1; length <= phrase.size(); ++length) {
+    queries.emplace_back(phrase.substr(0, length));
+  }
+}
+
+template <typename Search>
+double searchNanos(size_t count,
+                   const std::vector<std::vector<std::string>>& queries,
+                   Search&& search) {
+  size_t searches = 0;
+  size_t matches = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < kRounds; ++round) {
+    for (size_t t = 0; t < count; ++t) {
+      for (const auto& query : queries[t]) {
+        auto [first, last] = search(t, query);
+        matches += last - first;
+        ++searches;
+      }
+    }
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (matches < searches) {
+    std::cerr << "Unexpected search results" << std::endl;
+    std::exit(1);
+  }
+  return elapsed.count() / std::max<size_t>(searches, 1);
+}
+
+void report(const char* title, const std::vector<McFoxIM::InputTable>& tables,
+            const std::vector<std::vector<std::string>>& queries) {
+  std::vector<Keys> keys;
+  size_t phrases = 0;
+  size_t searches = 0;
+  size_t keyBytes = 0;
+  size_t trieBytes = 0;
+  size_t nodes = 0;
+  std::chrono::duration<double, std::milli> buildTime{0};
+  for (size_t t = 0; t < tables.size(); ++t) {
+    keys.emplace_back(tables[t]);
+    const auto& tableKeys = keys.back();
+    phrases += tableKeys.size();
+    searches += queries[t].size();
+    keyBytes += tableKeys.memoryUsage();
+
+    auto start = std::chrono::steady_clock::now();
+    McFoxIM::PrefixTrie trie;
+    trie.build(tableKeys.size(),
+               [&](size_t index) { return tableKeys.at(index); });
+    buildTime += std::chrono::steady_clock::now() - start;
+    trieBytes += trie.memoryUsage();
+    nodes += trie.nodeCount();
+  }
+
+  std::printf("%s: %zu phrases (%zu KiB), %zu keystrokes\n", title, phrases,
+              keyBytes / 1024, searches);
+  std::printf(
+      "  trie build     %8.1f ms, %zu nodes, %zu KiB (%.2f bytes/phrase)\n",
+      buildTime.count(), nodes, trieBytes / 1024,
+      static_cast<double>(trieBytes) / std::max<size_t>(phrases, 1));
+  std::printf("  binary search  %8.1f ns/keystroke\n",
+              searchNanos(tables.size(), queries,
+                          [&](size_t t, const std::string& query) {
+                            return keys[t].prefixRange(query);
+                          }));
+  std::printf("  trie           %8.1f ns/keystroke\n",
+              searchNanos(tables.size(), queries,
+                          [&](size_t t, const std::string& query) {
+                            return tables[t].prefixRange(query);
+                          }));
+}
+
+// Phrases of an Amis-like alphabet, with the length of real phrases.
+std::vector<McFoxIM::InputTable::Entry> syntheticEntries() {
+  static constexpr std::string_view kLetters = "aaaacdefghiiklmnnoprsttuwy'^";
+  std::mt19937 random(19);
+  std::uniform_int_distribution<size_t> letter(0, kLetters.size() - 1);
+  std::uniform_int_distribution<size_t> length(3, 14);
+  std::vector<McFoxIM::InputTable::Entry> entries(kSyntheticSize);
+  for (auto& entry : entries) {
+    for (size_t i = length(random); i > 0; --i) {
+      entry.phrase += kLetters[letter(random)];
+    }
+  }
+  return entries;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <table dir>" << std::endl;
+    return 1;
+  }
+  fcitx::Log::setLogRule("*=2");
+
+  auto paths = listTables(argv[1]);
+  std::vector<McFoxIM::InputTable> tables(paths.size());
+  std::vector<std::vector<std::string>> queries(paths.size());
+  for (size_t t = 0; t < paths.size(); ++t) {
+    if (!tables[t].load(paths[t])) {
+      std::cerr << "Failed to load " << paths[t] << std::endl;
+      return 1;
+    }
+    for (size_t i = 0; i < tables[t].size(); i = tables[t].groupEnd(i)) {
+      addKeystrokes(tables[t].decodePhraseAt(i), queries[t]);
+    }
+  }
+  report(argv[1], tables, queries);
+
+  std::vector<McFoxIM::InputTable> synthetic(1);
+  synthetic[0].assign("Synthetic", syntheticEntries());
+  std::vector<std::vector<std::string>> syntheticQueries(1);
+  size_t step = synthetic[0].size() / kSyntheticQueries;
+  for (size_t i = 0; i < synthetic[0].size(); i += step) {
+    addKeystrokes(synthetic[0].decodePhraseAt(i), syntheticQueries[0]);
+  }
+  report("synthetic", synthetic, syntheticQueries);
+  return 0;
+}
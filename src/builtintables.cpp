@@ -0,0 +1,59 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "builtintables.h"
+
+#include <algorithm>
+
+namespace McFoxIM {
+namespace BuiltinTables {
+
+#ifdef FOX_BUILTIN_TABLES
+// Defined in the source generated by fox-tablec --embed.
+extern const Table kTables[];
+extern const size_t kTableCount;
+#endif
+
+std::span<const Table> tables() {
+#ifdef FOX_BUILTIN_TABLES
+  return {kTables, kTableCount};
+#else
+  return {};
+#endif
+}
+
+const Table* find(std::string_view id) {
+  auto all = tables();
+  auto table = std::lower_bound(
+      all.begin(), all.end(), id,
+      [](const Table& table, std::string_view id) {
+        return std::string_view(table.id) < id;
+      });
+  if (table == all.end() || table->id != id) {
+    return nullptr;
+  }
+  return &*table;
+}
+
+}  // namespace BuiltinTables
+}  // namespace McFoxIM
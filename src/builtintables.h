@@ -0,0 +1,59 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef BUILTINTABLES_H_
+#define BUILTINTABLES_H_
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace McFoxIM {
+
+/**
+ * The input tables compiled into the addon. When the addon is built with
+ * ENABLE_BUILTIN_TABLES, fox-tablec embeds every table in data/ as a compiled
+ * table (see tableformat.h) in a constexpr array, which InputTable uses in
+ * place from the read-only data of the library.
+ */
+namespace BuiltinTables {
+
+struct Table {
+  const char* id;
+  const char* data;
+  size_t size;
+};
+
+/** The prefix of the table paths InputTableManager uses for built-in tables. */
+constexpr std::string_view kPathPrefix = "builtin:";
+
+/** The built-in tables sorted by id, empty unless they are compiled in. */
+std::span<const Table> tables();
+
+/** The built-in table with the given id, or nullptr. */
+const Table* find(std::string_view id);
+
+}  // namespace BuiltinTables
+}  // namespace McFoxIM
+
+#endif  // BUILTINTABLES_H_
@@ -29,7 +29,7 @@ Candidate::Candidate(std::string displayText, std::string description)
     : displayText_(std::move(displayText)),
       description_(std::move(description)) {}
 
-void Candidate::appendDescription(const std::string& desc) {
+void Candidate::appendDescription(std::string_view desc) {
   if (!description_.empty()) {
     description_ += "/";
   }
@@ -25,6 +25,7 @@
 #define CANDIDATE_H_
 
 #include <string>
+#include <string_view>
 
 namespace McFoxIM {
 
@@ -36,7 +37,7 @@ class Candidate {
 
   const std::string& description() const { return description_; }
 
-  void appendDescription(const std::string& desc);
+  void appendDescription(std::string_view desc);
 
  private:
   std::string displayText_;
@@ -24,77 +24,254 @@
 #include "completer.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <tuple>
+
+#include "keyscan.h"
+#include "levenshteinautomaton.h"
+#include "utf8.h"
 
 namespace McFoxIM {
 
-Completer::Completer(TableProvider provider) : provider_(std::move(provider)) {}
+namespace {
 
-std::vector<Candidate> Completer::complete_(const std::string& prefix) {
-  if (prefix.empty()) {
-    return {};
+// Walks the entries of one source that start with a prefix, a group of
+// equal phrases at a time.
+class GroupCursor {
+ public:
+  // Descriptions of a table with a label are marked with it.
+  GroupCursor(const InputTable& table, std::string_view prefix,
+              std::string_view label = {})
+      : table_(&table), label_(label) {
+    std::tie(index_, last_) = table.prefixRange(prefix);
+    load();
   }
-  const auto& table = provider_();
-  const auto& data = table.entries();
 
-  int left = 0;
-  int right = static_cast<int>(data.size()) - 1;
-  int firstMatch = -1;
+  GroupCursor(const UserDictionary::Memtable& memtable,
+              std::string_view prefix)
+      : word_(memtable.lower_bound(prefix)),
+        end_(memtable.end()),
+        prefix_(prefix) {
+    load();
+  }
 
-  // Find the first entry that starts with the prefix
-  while (left <= right) {
-    int mid = left + (right - left) / 2;
-    const auto& key = data[mid].phrase;
+  bool done() const { return done_; }
+  const std::string& phrase() const { return phrase_; }
 
-    if (key < prefix) {
-      left = mid + 1;
+  // Calls append(description) for the entries of the current phrase and
+  // moves to the next phrase.
+  template <typename Append>
+  void consume(Append&& append) {
+    if (table_) {
+      size_t end = std::min(table_->groupEnd(index_), last_);
+      for (; index_ < end; ++index_) {
+        if (label_.empty()) {
+          append(table_->descriptionAt(index_));
+          continue;
+        }
+        labeled_.assign(table_->descriptionAt(index_));
+        labeled_.append("（").append(label_).append("）");
+        append(std::string_view(labeled_));
+      }
     } else {
-      bool startsWith = key.rfind(prefix, 0) == 0;
-      if (startsWith) {
-        firstMatch = mid;
-        right = mid - 1;
-      } else {
-        right = mid - 1;
+      for (; word_ != end_ && word_->first == phrase_; ++word_) {
+        append(std::string_view(word_->second));
       }
     }
+    load();
   }
 
-  if (firstMatch == -1) {
-    return {};
+ private:
+  void load() {
+    if (table_) {
+      done_ = index_ >= last_;
+      if (!done_) {
+        // Reuses the buffer of the previous phrase.
+        table_->visitPhrases(index_, index_ + 1,
+                             [this](size_t, std::string_view phrase) {
+                               phrase_.assign(phrase);
+                             });
+      }
+    } else {
+      done_ = word_ == end_ || !word_->first.starts_with(prefix_);
+      if (!done_) {
+        phrase_.assign(word_->first);
+      }
+    }
   }
 
+  const InputTable* table_ = nullptr;
+  std::string_view label_;
+  size_t index_ = 0;
+  size_t last_ = 0;
+  UserDictionary::Memtable::const_iterator word_;
+  UserDictionary::Memtable::const_iterator end_;
+  std::string_view prefix_;
+  std::string phrase_;
+  std::string labeled_;
+  bool done_ = true;
+};
+
+// Completes from a single table.
+std::vector<Candidate> completeTable(const InputTable& table,
+                                     const std::string& prefix) {
+  auto [first, last] = table.prefixRange(prefix);
+
+  // Equal phrases are grouped by the table, and phrases that differ only in
+  // case are merged into the candidate of the first one.
   std::vector<Candidate> results;
-  for (size_t i = firstMatch; i < data.size(); ++i) {
-    const auto& key = data[i].phrase;
-    if (key.rfind(prefix, 0) != 0) {
-      break;
+  std::vector<std::pair<uint32_t, size_t>> foldedResults;
+  table.visitGroups(first, last, [&](std::string_view phrase, size_t begin,
+                                     size_t end, uint32_t foldClass) {
+    Candidate* candidate = nullptr;
+    if (foldClass != InputTable::kNoFoldClass) {
+      auto folded = std::find_if(
+          foldedResults.begin(), foldedResults.end(),
+          [foldClass](const auto& entry) { return entry.first == foldClass; });
+      if (folded != foldedResults.end()) {
+        candidate = &results[folded->second];
+      } else {
+        foldedResults.emplace_back(foldClass, results.size());
+      }
+    }
+    if (!candidate) {
+      candidate = &results.emplace_back(std::string(phrase),
+                                        std::string(table.descriptionAt(begin)));
+      ++begin;
+    }
+    for (size_t i = begin; i < end; ++i) {
+      candidate->appendDescription(table.descriptionAt(i));
     }
+  });
 
-    // Check duplicates
-    bool duplicateFound = false;
-    std::string keyLower = key;
-    std::transform(keyLower.begin(), keyLower.end(), keyLower.begin(),
-                   ::tolower);
+  return results;
+}
+
+// The candidate of a ranked entry: its phrase, and the descriptions of the
+// entries in [first, last) with that phrase or one of its case variants.
+Candidate rankedCandidate(const InputTable& table, size_t entry, size_t first,
+                          size_t last) {
+  uint32_t foldClass = table.foldClassAt(entry);
+  if (foldClass == InputTable::kNoFoldClass) {
+    Candidate candidate(table.decodePhraseAt(entry),
+                        std::string(table.descriptionAt(entry)));
+    for (size_t i = entry + 1, end = table.groupEnd(entry); i < end; ++i) {
+      candidate.appendDescription(table.descriptionAt(i));
+    }
+    return candidate;
+  }
 
-    for (auto& result : results) {
-      std::string resultLower = result.displayText();
-      std::transform(resultLower.begin(), resultLower.end(),
-                     resultLower.begin(), ::tolower);
+  // Case variants are rare, and they are not next to each other, so the
+  // range is searched for them.
+  std::optional<Candidate> candidate;
+  table.visitGroups(first, last, [&](std::string_view phrase, size_t begin,
+                                     size_t end, uint32_t groupFoldClass) {
+    if (groupFoldClass != foldClass) {
+      return;
+    }
+    if (!candidate) {
+      candidate.emplace(std::string(phrase),
+                        std::string(table.descriptionAt(begin)));
+      ++begin;
+    }
+    for (size_t i = begin; i < end; ++i) {
+      candidate->appendDescription(table.descriptionAt(i));
+    }
+  });
+  return std::move(*candidate);
+}
 
-      if (resultLower == keyLower) {
-        result.appendDescription(data[i].description);
-        duplicateFound = true;
-        break;
+// Completes from several sources at once by merging their sorted entries.
+// Equal phrases take the descriptions of the sources in order.
+std::vector<Candidate> completeMerged(std::vector<GroupCursor>& cursors) {
+  std::vector<Candidate> results;
+  // The results of phrases with upper case letters by their lower case form.
+  // Of the phrases that differ only in case, the first one in byte order has
+  // an upper case letter, and the later ones are merged into its result.
+  std::map<std::string, size_t, std::less<>> casedResults;
+  std::string phrase;
+  while (true) {
+    const GroupCursor* next = nullptr;
+    for (const auto& cursor : cursors) {
+      if (!cursor.done() && (!next || cursor.phrase() < next->phrase())) {
+        next = &cursor;
       }
     }
+    if (!next) {
+      break;
+    }
+    phrase.assign(next->phrase());
 
-    if (duplicateFound) {
-      continue;
+    Candidate* candidate = nullptr;
+    bool cased = KeyScan::hasUpper(phrase);
+    if (cased || !casedResults.empty()) {
+      std::string lowered = phrase;
+      KeyScan::toLower(lowered);
+      auto folded = casedResults.find(lowered);
+      if (folded != casedResults.end()) {
+        candidate = &results[folded->second];
+      } else if (cased) {
+        casedResults.emplace(std::move(lowered), results.size());
+      }
+    }
+    for (auto& cursor : cursors) {
+      if (cursor.done() || cursor.phrase() != phrase) {
+        continue;
+      }
+      cursor.consume([&](std::string_view description) {
+        if (candidate) {
+          candidate->appendDescription(description);
+        } else {
+          candidate = &results.emplace_back(phrase, std::string(description));
+        }
+      });
     }
+  }
+  return results;
+}
+
+}  // namespace
 
-    results.emplace_back(key, data[i].description);
+Completer::Completer(TableProvider provider) : provider_(std::move(provider)) {}
+
+void Completer::setUserDictionaryProvider(UserDictionaryProvider provider) {
+  userDictionaryProvider_ = std::move(provider);
+}
+
+std::vector<Candidate> Completer::complete_(
+    const InputTable& table, const UserDictionary* userDictionary,
+    const std::string& prefix) {
+  if (prefix.empty()) {
+    return {};
+  }
+  bool hasUserWords = userDictionary && userDictionary->size() > 0;
+  if (table.members().empty() && !hasUserWords) {
+    return completeTable(table, prefix);
   }
 
-  return results;
+  // The sources are read in place, from the oldest entries to the newest.
+  std::vector<GroupCursor> cursors;
+  if (table.members().empty()) {
+    cursors.emplace_back(table, prefix);
+  }
+  for (const auto& member : table.members()) {
+    cursors.emplace_back(*member.table, prefix, member.label);
+  }
+  if (hasUserWords) {
+    if (const auto* run = userDictionary->run()) {
+      cursors.emplace_back(*run, prefix);
+    }
+    if (const auto* frozen = userDictionary->frozen()) {
+      cursors.emplace_back(*frozen, prefix);
+    }
+    cursors.emplace_back(userDictionary->memtable(), prefix);
+  }
+  return completeMerged(cursors);
 }
 
 std::vector<Candidate> Completer::complete(const std::string& prefix) {
@@ -102,13 +279,377 @@ std::vector<Candidate> Completer::complete(const std::string& prefix) {
     return {};
   }
 
+  auto table = provider_();
+  if (!table) {
+    return {};
+  }
+  const UserDictionary* userDictionary =
+      userDictionaryProvider_ ? userDictionaryProvider_() : nullptr;
+  auto results = completeAll(*table, userDictionary, prefix);
+  if (results.empty() && fuzzyBudget_.count() > 0) {
+    results = completeFuzzy_(*table, prefix, fuzzyBudget_);
+  }
+  return results;
+}
+
+Completer::Completion Completer::completeFirst(const std::string& prefix,
+                                               size_t count) {
+  Completion completion;
+  if (prefix.empty()) {
+    return completion;
+  }
+
+  auto table = provider_();
+  if (!table) {
+    return completion;
+  }
+  const UserDictionary* userDictionary =
+      userDictionaryProvider_ ? userDictionaryProvider_() : nullptr;
+
+  // The ranked lists only cover a table of its own, and a prefix that is
+  // not completed in lower case as well.
+  std::span<const uint32_t> ranked;
+  if (count > InputTable::kRankedCount || !table->members().empty() ||
+      (userDictionary && userDictionary->size() > 0) ||
+      std::isupper(static_cast<unsigned char>(prefix[0])) ||
+      !table->rankedEntries(prefix, ranked)) {
+    completion.candidates = completeAll(*table, userDictionary, prefix);
+    if (completion.candidates.empty() && fuzzyBudget_.count() > 0) {
+      completion.candidates = completeFuzzy_(*table, prefix, fuzzyBudget_);
+    }
+    return completion;
+  }
+
+  auto [first, last] = table->prefixRange(prefix);
+  for (uint32_t entry : ranked.first(std::min(count, ranked.size()))) {
+    completion.candidates.push_back(
+        rankedCandidate(*table, entry, first, last));
+  }
+  if (ranked.size() == InputTable::kRankedCount) {
+    // The rest comes from the same snapshot, and, like the first ones,
+    // without the user's words.
+    completion.completeAll = [table, prefix]() {
+      return completeAll(*table, nullptr, prefix);
+    };
+  }
+  return completion;
+}
+
+Completer::Completion Completer::completeInfix(const std::string& infix,
+                                               size_t count) {
+  Completion completion;
+  if (infix.empty()) {
+    return completion;
+  }
+
+  auto table = provider_();
+  if (!table) {
+    return completion;
+  }
+  const UserDictionary* userDictionary =
+      userDictionaryProvider_ ? userDictionaryProvider_() : nullptr;
+  if (!table->members().empty() ||
+      (userDictionary && userDictionary->size() > 0)) {
+    completion.candidates = completeInfixAll(*table, userDictionary, infix);
+    return completion;
+  }
+
+  // One more than needed tells whether there are more.
+  auto entries = table->infixEntries(infix, count + 1);
+  bool more = entries.size() > count;
+  entries.resize(std::min(entries.size(), count));
+  // Case variants are merged into one candidate, which may need phrases
+  // past the first ones.
+  for (uint32_t entry : entries) {
+    if (table->foldClassAt(entry) != InputTable::kNoFoldClass) {
+      completion.candidates = completeInfixAll(*table, nullptr, infix);
+      return completion;
+    }
+  }
+  for (uint32_t entry : entries) {
+    completion.candidates.push_back(
+        rankedCandidate(*table, entry, entry, table->groupEnd(entry)));
+  }
+  if (more) {
+    completion.completeAll = [table, infix]() {
+      return completeInfixAll(*table, nullptr, infix);
+    };
+  }
+  return completion;
+}
+
+std::vector<Candidate> Completer::completeInfixAll(
+    const InputTable& table, const UserDictionary* userDictionary,
+    const std::string& infix) {
+  // The candidates by phrase, from the sources in the order complete_()
+  // reads them.
+  std::map<std::string, Candidate, std::less<>> found;
+  auto add = [&](std::string_view phrase, std::string_view description) {
+    auto candidate = found.find(phrase);
+    if (candidate != found.end()) {
+      candidate->second.appendDescription(description);
+    } else {
+      found.emplace(std::string(phrase),
+                    Candidate(std::string(phrase), std::string(description)));
+    }
+  };
+  auto addTable = [&](const InputTable& source, std::string_view label) {
+    std::string labeled;
+    std::string buffer;
+    for (uint32_t entry : source.infixEntries(infix, SIZE_MAX)) {
+      std::string_view phrase = source.phraseAt(entry, buffer);
+      for (size_t i = entry, end = source.groupEnd(entry); i < end; ++i) {
+        if (label.empty()) {
+          add(phrase, source.descriptionAt(i));
+          continue;
+        }
+        labeled.assign(source.descriptionAt(i));
+        labeled.append("（").append(label).append("）");
+        add(phrase, labeled);
+      }
+    }
+  };
+  auto addWords = [&](const UserDictionary::Memtable& words) {
+    for (const auto& [phrase, description] : words) {
+      if (phrase.find(infix) != std::string::npos) {
+        add(phrase, description);
+      }
+    }
+  };
+
+  if (table.members().empty()) {
+    addTable(table, {});
+  }
+  for (const auto& member : table.members()) {
+    addTable(*member.table, member.label);
+  }
+  if (userDictionary && userDictionary->size() > 0) {
+    if (const auto* run = userDictionary->run()) {
+      addTable(*run, {});
+    }
+    if (const auto* frozen = userDictionary->frozen()) {
+      addWords(*frozen);
+    }
+    addWords(userDictionary->memtable());
+  }
+
+  // As in completeMerged(), the first of the phrases that differ only in
+  // case takes the descriptions of the later ones.
+  std::vector<Candidate> results;
+  std::map<std::string, size_t, std::less<>> casedResults;
+  for (auto& [phrase, candidate] : found) {
+    bool cased = KeyScan::hasUpper(phrase);
+    if (cased || !casedResults.empty()) {
+      std::string lowered = phrase;
+      KeyScan::toLower(lowered);
+      auto folded = casedResults.find(lowered);
+      if (folded != casedResults.end()) {
+        results[folded->second].appendDescription(candidate.description());
+        continue;
+      }
+      if (cased) {
+        casedResults.emplace(std::move(lowered), results.size());
+      }
+    }
+    results.push_back(std::move(candidate));
+  }
+  std::stable_sort(results.begin(), results.end(),
+                   [](const Candidate& a, const Candidate& b) {
+                     return a.displayText().length() <
+                            b.displayText().length();
+                   });
+  return results;
+}
+
+std::vector<Candidate> Completer::completeGloss(const std::string& text) {
+  if (text.empty()) {
+    return {};
+  }
+
+  auto table = provider_();
+  if (!table) {
+    return {};
+  }
+  const UserDictionary* userDictionary =
+      userDictionaryProvider_ ? userDictionaryProvider_() : nullptr;
+
+  // One candidate per phrase, in the order the phrases are found, and the
+  // length of the shortest description of each that matched.
+  std::vector<Candidate> results;
+  std::vector<size_t> lengths;
+  std::map<std::string, size_t, std::less<>> resultsByPhrase;
+  auto add = [&](std::string_view phrase, std::string_view description,
+                 std::string_view label) {
+    std::string labeled(description);
+    if (!label.empty()) {
+      labeled.append("（").append(label).append("）");
+    }
+    auto found = resultsByPhrase.find(phrase);
+    if (found != resultsByPhrase.end()) {
+      results[found->second].appendDescription(labeled);
+      lengths[found->second] =
+          std::min(lengths[found->second], description.size());
+      return;
+    }
+    resultsByPhrase.emplace(std::string(phrase), results.size());
+    results.emplace_back(std::string(phrase), std::move(labeled));
+    lengths.push_back(description.size());
+  };
+  auto addTable = [&](const InputTable& source, std::string_view label) {
+    std::string buffer;
+    for (uint32_t entry : source.glossEntries(text)) {
+      add(source.phraseAt(entry, buffer), source.descriptionAt(entry), label);
+    }
+  };
+  auto addWords = [&](const UserDictionary::Memtable& words) {
+    for (const auto& [phrase, description] : words) {
+      if (description.find(text) != std::string::npos) {
+        add(phrase, description, {});
+      }
+    }
+  };
+
+  if (table->members().empty()) {
+    addTable(*table, {});
+  }
+  for (const auto& member : table->members()) {
+    addTable(*member.table, member.label);
+  }
+  if (userDictionary && userDictionary->size() > 0) {
+    if (const auto* run = userDictionary->run()) {
+      addTable(*run, {});
+    }
+    if (const auto* frozen = userDictionary->frozen()) {
+      addWords(*frozen);
+    }
+    addWords(userDictionary->memtable());
+  }
+
+  std::vector<size_t> order(results.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return lengths[a] < lengths[b];
+  });
+  std::vector<Candidate> ranked;
+  ranked.reserve(order.size());
+  for (size_t i : order) {
+    ranked.push_back(std::move(results[i]));
+  }
+  return ranked;
+}
+
+std::vector<Candidate> Completer::completeFuzzy(
+    const std::string& prefix, std::chrono::microseconds budget) {
+  auto table = provider_();
+  if (!table) {
+    return {};
+  }
+  return completeFuzzy_(*table, prefix, budget);
+}
+
+std::vector<Candidate> Completer::completeFuzzy_(
+    const InputTable& table, const std::string& prefix,
+    std::chrono::microseconds budget) {
+  size_t length = std::count_if(prefix.begin(), prefix.end(),
+                                Utf8::startsCharacter);
+  uint32_t maxDistance = length >= kTwoEditLength   ? 2
+                         : length >= kOneEditLength ? 1
+                                                    : 0;
+  if (maxDistance == 0) {
+    return {};
+  }
+  auto deadline = std::chrono::steady_clock::now() + budget;
+
+  std::vector<std::pair<const InputTable*, std::string_view>> sources;
+  if (table.members().empty()) {
+    sources.emplace_back(&table, std::string_view());
+  }
+  for (const auto& member : table.members()) {
+    sources.emplace_back(member.table.get(), member.label);
+  }
+
+  struct Found {
+    uint32_t distance;
+    size_t length;
+    size_t source;
+    uint32_t entry;
+  };
+  std::vector<Found> found;
+  std::vector<InputTable::FuzzyMatch> matches;
+  std::string buffer;
+  for (uint32_t distance = 1; distance <= maxDistance; ++distance) {
+    LevenshteinAutomaton automaton(prefix, distance);
+    std::vector<Found> pass;
+    bool done = true;
+    for (size_t source = 0; source < sources.size() && done; ++source) {
+      const auto& sourceTable = *sources[source].first;
+      matches.clear();
+      done = sourceTable.fuzzyEntries(automaton, deadline, matches);
+      for (const auto& match : matches) {
+        pass.push_back({match.distance,
+                        sourceTable.phraseAt(match.entry, buffer).size(),
+                        source,
+                        match.entry});
+      }
+    }
+    // A search that ran out of time only adds the phrases it is for to
+    // those of the complete search before it.
+    if (done || distance == 1) {
+      found = std::move(pass);
+    } else {
+      for (const auto& item : pass) {
+        if (item.distance == distance) {
+          found.push_back(item);
+        }
+      }
+    }
+    if (!done) {
+      break;
+    }
+  }
+  std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) {
+    return std::tie(a.distance, a.length, a.source, a.entry) <
+           std::tie(b.distance, b.length, b.source, b.entry);
+  });
+
+  // Equal phrases, and phrases that differ only in case, are merged into
+  // the candidate of the nearest one.
+  std::vector<Candidate> results;
+  std::map<std::string, size_t, std::less<>> resultsByPhrase;
+  std::string labeled;
+  for (const auto& item : found) {
+    const auto& [sourceTable, label] = sources[item.source];
+    std::string_view phrase = sourceTable->phraseAt(item.entry, buffer);
+    std::string lowered(phrase);
+    KeyScan::toLower(lowered);
+    auto [result, added] =
+        resultsByPhrase.try_emplace(std::move(lowered), results.size());
+    for (size_t i = item.entry, end = sourceTable->groupEnd(item.entry);
+         i < end; ++i) {
+      labeled.assign(sourceTable->descriptionAt(i));
+      if (!label.empty()) {
+        labeled.append("（").append(label).append("）");
+      }
+      if (added) {
+        results.emplace_back(std::string(phrase), labeled);
+        added = false;
+      } else {
+        results[result->second].appendDescription(labeled);
+      }
+    }
+  }
+  return results;
+}
+
+std::vector<Candidate> Completer::completeAll(
+    const InputTable& table, const UserDictionary* userDictionary,
+    const std::string& prefix) {
   std::vector<Candidate> result;
   if (std::isupper(static_cast<unsigned char>(prefix[0]))) {
-    auto original = complete_(prefix);
+    auto original = complete_(table, userDictionary, prefix);
     std::string lowerPrefix = prefix;
-    std::transform(lowerPrefix.begin(), lowerPrefix.end(), lowerPrefix.begin(),
-                   ::tolower);
-    auto lowered = complete_(lowerPrefix);
+    KeyScan::toLower(lowerPrefix);
+    auto lowered = complete_(table, userDictionary, lowerPrefix);
 
     result = std::move(original);
     for (const auto& c : lowered) {
@@ -119,13 +660,16 @@ std::vector<Candidate> Completer::complete(const std::string& prefix) {
       result.emplace_back(text, c.description());
     }
   } else {
-    result = complete_(prefix);
+    result = complete_(table, userDictionary, prefix);
   }
 
-  std::sort(result.begin(), result.end(),
-            [](const Candidate& a, const Candidate& b) {
-              return a.displayText().length() < b.displayText().length();
-            });
+  // Candidates of the same length keep their order, which is what the
+  // ranked lists of the table assume.
+  std::stable_sort(result.begin(), result.end(),
+                   [](const Candidate& a, const Candidate& b) {
+                     return a.displayText().length() <
+                            b.displayText().length();
+                   });
   return result;
 }
 
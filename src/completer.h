@@ -24,21 +24,64 @@
 #ifndef COMPLETER_H_
 #define COMPLETER_H_
 
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "candidate.h"
 #include "inputtable.h"
+#include "userdictionary.h"
 
 namespace McFoxIM {
 
 class Completer {
  public:
-  using TableProvider = std::function<const InputTable&()>;
+  /**
+   * Returns the table to complete from. Each completion takes one snapshot
+   * and uses it until it returns, even if the provider publishes a new table
+   * in the meantime.
+   */
+  using TableProvider = std::function<std::shared_ptr<const InputTable>()>;
+
+  /** Returns the words the user added to the table, or nullptr. */
+  using UserDictionaryProvider = std::function<const UserDictionary*()>;
+
+  /** The first candidates of a prefix, and a way to complete the rest. */
+  struct Completion {
+    std::vector<Candidate> candidates;
+    // Completes all the candidates, these included, when there may be more
+    // than the ones above. Empty if they are all of them.
+    std::function<std::vector<Candidate>()> completeAll;
+  };
+
+  /** How long the fuzzy fallback may search on a keystroke by default. */
+  static constexpr std::chrono::microseconds kDefaultFuzzyBudget{3000};
+  /**
+   * The shortest prefixes, in characters, that completeFuzzy() completes
+   * within one edit and within two edits.
+   */
+  static constexpr size_t kOneEditLength = 3;
+  static constexpr size_t kTwoEditLength = 6;
 
   Completer(TableProvider provider);
 
+  /**
+   * Completes from the user's words too. They are merged with the table as
+   * if they had been added to it after its own entries.
+   */
+  void setUserDictionaryProvider(UserDictionaryProvider provider);
+
+  /**
+   * Completes a prefix that no phrase starts with from the phrases that
+   * start with a near miss of it (see completeFuzzy()), searching for at
+   * most the given time. A budget of zero, the default, turns this off.
+   */
+  void setFuzzyBudget(std::chrono::microseconds budget) {
+    fuzzyBudget_ = budget;
+  }
+
   /**
    * Completes the given prefix string.
    *
@@ -47,10 +90,74 @@ class Completer {
    */
   std::vector<Candidate> complete(const std::string& prefix);
 
+  /**
+   * Completes the given prefix string as far as the first candidates. They
+   * are the first ones complete() would return, and for most short prefixes
+   * they come from the table's ranked lists without a search or a sort.
+   *
+   * @param prefix The prefix to complete.
+   * @param count The number of candidates needed.
+   * @returns The first count candidates or more, or all of them if there
+   * are fewer.
+   */
+  Completion completeFirst(const std::string& prefix, size_t count);
+
+  /**
+   * Completes the phrases that contain the given string anywhere, shorter
+   * phrases first and phrases of the same length in order. The first
+   * candidates come from the table's infix index (see
+   * InputTable::infixEntries()) without finding all the phrases.
+   *
+   * @param infix The string to look for.
+   * @param count The number of candidates needed.
+   * @returns The first count candidates or more, or all of them if there
+   * are fewer.
+   */
+  Completion completeInfix(const std::string& infix, size_t count);
+
+  /**
+   * Finds the words whose description contains the given text, such as a
+   * Mandarin gloss. Each candidate shows a phrase, which is what is
+   * committed, and the descriptions of it that matched. Words with shorter
+   * descriptions come first, so that the words for exactly the text come
+   * before those whose glosses only mention it.
+   *
+   * @param text The text to look for in the descriptions.
+   * @returns A list of candidates.
+   */
+  std::vector<Candidate> completeGloss(const std::string& text);
+
+  /**
+   * Finds the phrases that start with a near miss of a prefix: within one
+   * edit of it if it has kOneEditLength characters, and within two if it
+   * has kTwoEditLength. Nearer phrases come first, then shorter ones.
+   * Phrases within one edit are searched for before those within two, so
+   * that if the search runs out of time, it has found the nearest ones.
+   *
+   * @param prefix The prefix to complete.
+   * @param budget How long to search for.
+   * @returns A list of candidates.
+   */
+  std::vector<Candidate> completeFuzzy(const std::string& prefix,
+                                       std::chrono::microseconds budget);
+
  private:
   TableProvider provider_;
+  UserDictionaryProvider userDictionaryProvider_;
+  std::chrono::microseconds fuzzyBudget_{0};
 
-  std::vector<Candidate> complete_(const std::string& prefix);
+  static std::vector<Candidate> completeAll(
+      const InputTable& table, const UserDictionary* userDictionary,
+      const std::string& prefix);
+  static std::vector<Candidate> completeFuzzy_(
+      const InputTable& table, const std::string& prefix,
+      std::chrono::microseconds budget);
+  static std::vector<Candidate> completeInfixAll(
+      const InputTable& table, const UserDictionary* userDictionary,
+      const std::string& infix);
+  static std::vector<Candidate> complete_(const InputTable& table,
+                                          const UserDictionary* userDictionary,
+                                          const std::string& prefix);
 };
 
 }  // namespace McFoxIM
@@ -0,0 +1,126 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "datadirectorywatcher.h"
+
+#include <fcitx-utils/log.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <ctime>
+#include <string_view>
+
+#include "tableformat.h"
+
+namespace McFoxIM {
+
+namespace {
+// How long a file has to stay untouched before it is reported.
+constexpr uint64_t kSettleDelayUsec = 200000;
+
+// Compiled tables and archives are served from shared mappings of their
+// files, so they may only be replaced by renaming a new file over them.
+// Writing one in place would already have torn the table in use, and
+// reloading it then would map the torn file again.
+bool isMappedTable(std::string_view fileName) {
+  return fileName.ends_with(TableFormat::kFileExtension) ||
+         fileName.ends_with(TableFormat::kArchiveExtension);
+}
+}  // namespace
+
+DataDirectoryWatcher::DataDirectoryWatcher(fcitx::EventLoop& eventLoop,
+                                           const std::string& path,
+                                           Callback callback)
+    : eventLoop_(eventLoop), callback_(std::move(callback)) {
+  fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd_ < 0) {
+    FCITX_WARN() << "Failed to initialize inotify, tables will not reload";
+    return;
+  }
+  // JSON tables, unions and the manifest are replaced either in place (close
+  // after write) or atomically (rename into the directory); compiled tables
+  // and archives only atomically.
+  if (inotify_add_watch(fd_, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    FCITX_WARN() << "Failed to watch " << path << ", tables will not reload";
+    return;
+  }
+
+  ioEvent_ = eventLoop_.addIOEvent(
+      fd_, fcitx::IOEventFlag::In,
+      [this](fcitx::EventSourceIO*, int, fcitx::IOEventFlags) {
+        readEvents();
+        return true;
+      });
+}
+
+DataDirectoryWatcher::~DataDirectoryWatcher() {
+  settleTimer_.reset();
+  ioEvent_.reset();
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void DataDirectoryWatcher::readEvents() {
+  alignas(struct inotify_event) char buffer[4096];
+  while (true) {
+    ssize_t length = read(fd_, buffer, sizeof(buffer));
+    if (length <= 0) {
+      break;
+    }
+    for (char* p = buffer; p < buffer + length;) {
+      const auto* event = reinterpret_cast<const struct inotify_event*>(p);
+      if (event->len > 0) {
+        if ((event->mask & IN_CLOSE_WRITE) && isMappedTable(event->name)) {
+          FCITX_WARN() << event->name
+                       << " was written in place; replace compiled tables by "
+                          "renaming a new file over them";
+        } else {
+          changedFiles_.insert(event->name);
+        }
+      }
+      p += sizeof(struct inotify_event) + event->len;
+    }
+  }
+
+  if (changedFiles_.empty()) {
+    return;
+  }
+  // Restart the timer on every change, so only settled files are reported.
+  settleTimer_ = eventLoop_.addTimeEvent(
+      CLOCK_MONOTONIC, fcitx::now(CLOCK_MONOTONIC) + kSettleDelayUsec, 0,
+      [this](fcitx::EventSourceTime*, uint64_t) {
+        flush();
+        return true;
+      });
+}
+
+void DataDirectoryWatcher::flush() {
+  auto changedFiles = std::move(changedFiles_);
+  changedFiles_.clear();
+  for (const auto& fileName : changedFiles) {
+    callback_(fileName);
+  }
+}
+
+}  // namespace McFoxIM
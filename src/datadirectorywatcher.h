@@ -0,0 +1,70 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef DATADIRECTORYWATCHER_H_
+#define DATADIRECTORYWATCHER_H_
+
+#include <fcitx-utils/event.h>
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+
+namespace McFoxIM {
+
+/**
+ * Watches a data directory with inotify on the fcitx event loop and reports
+ * the files that were written or moved into it. Bursts of changes are
+ * coalesced, so a file that is written in several steps is reported once
+ * after it has settled. Compiled tables and archives are mapped while they
+ * are in use, so they are only reported when a new file is moved over them.
+ */
+class DataDirectoryWatcher {
+ public:
+  using Callback = std::function<void(const std::string& fileName)>;
+
+  DataDirectoryWatcher(fcitx::EventLoop& eventLoop, const std::string& path,
+                       Callback callback);
+  ~DataDirectoryWatcher();
+  DataDirectoryWatcher(const DataDirectoryWatcher&) = delete;
+  DataDirectoryWatcher& operator=(const DataDirectoryWatcher&) = delete;
+
+  /** Whether the directory is being watched. */
+  bool isWatching() const { return ioEvent_ != nullptr; }
+
+ private:
+  void readEvents();
+  void flush();
+
+  fcitx::EventLoop& eventLoop_;
+  Callback callback_;
+  int fd_ = -1;
+  std::unique_ptr<fcitx::EventSourceIO> ioEvent_;
+  std::unique_ptr<fcitx::EventSourceTime> settleTimer_;
+  std::set<std::string> changedFiles_;
+};
+
+}  // namespace McFoxIM
+
+#endif  // DATADIRECTORYWATCHER_H_
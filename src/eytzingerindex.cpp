@@ -0,0 +1,121 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+#include "eytzingerindex.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace McFoxIM {
+
+namespace {
+
+// Fills the Eytzinger tree at node from the sorted values, in order.
+void fill(const std::vector<uint64_t>& sorted, size_t& next, size_t node,
+          size_t size, uint64_t* tree, uint32_t* ranks, size_t offset) {
+  if (node > size) {
+    return;
+  }
+  fill(sorted, next, 2 * node, size, tree, ranks, offset);
+  tree[node] = sorted[offset + next];
+  ranks[node] = static_cast<uint32_t>(offset + next);
+  ++next;
+  fill(sorted, next, 2 * node + 1, size, tree, ranks, offset);
+}
+
+}  // namespace
+
+void EytzingerIndex::build(size_t size, const KeyAt& keyAt) {
+  starts_.clear();
+  tree_.clear();
+  ranks_.clear();
+  if (size == 0 || size > std::numeric_limits<uint32_t>::max() - 256) {
+    return;
+  }
+
+  std::vector<uint64_t> sorted(size);
+  for (size_t i = 0; i < size; ++i) {
+    sorted[i] = pack(keyAt(i), 0);
+  }
+  starts_.assign(257, 0);
+  for (uint64_t value : sorted) {
+    ++starts_[(value >> 56) + 1];
+  }
+  for (size_t b = 0; b < 256; ++b) {
+    starts_[b + 1] += starts_[b];
+  }
+
+  // Each first byte has a tree of its own, with an unused slot 0.
+  tree_.assign(size + 256, 0);
+  ranks_.assign(size + 256, 0);
+  for (size_t b = 0; b < 256; ++b) {
+    size_t next = 0;
+    fill(sorted, next, 1, starts_[b + 1] - starts_[b], &tree_[starts_[b] + b],
+         &ranks_[starts_[b] + b], starts_[b]);
+  }
+}
+
+EytzingerIndex::Match EytzingerIndex::find(std::string_view prefix) const {
+  if (prefix.empty()) {
+    return {0, starts_.back(), 0};
+  }
+  size_t bucket = static_cast<uint8_t>(prefix[0]);
+  // Keys shorter than kWidth bytes pad with 0, which sorts before every
+  // byte of a key, so the keys that start with the prefix pack to values
+  // between its padding with 0 and with 0xff.
+  return {rank(bucket, pack(prefix, 0), false),
+          rank(bucket, pack(prefix, 0xff), true),
+          std::min(prefix.size(), kWidth)};
+}
+
+size_t EytzingerIndex::rank(size_t bucket, uint64_t value,
+                            bool inclusive) const {
+  size_t size = starts_[bucket + 1] - starts_[bucket];
+  const uint64_t* tree = &tree_[starts_[bucket] + bucket];
+  size_t node = 1;
+  while (node <= size) {
+    // The grandchildren four levels down fill two cache lines.
+    __builtin_prefetch(tree + 16 * node);
+    node = 2 * node + (inclusive ? tree[node] <= value : tree[node] < value);
+  }
+  // Undoes the right turns after the last left turn, which leads to the
+  // first value that the search did not pass.
+  node >>= __builtin_ffsll(~node);
+  return node == 0 ? starts_[bucket + 1]
+                   : ranks_[starts_[bucket] + bucket + node];
+}
+
+uint64_t EytzingerIndex::pack(std::string_view key, uint8_t padding) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < kWidth; ++i) {
+    value = value << 8 |
+            (i < key.size() ? static_cast<uint8_t>(key[i]) : padding);
+  }
+  return value;
+}
+
+size_t EytzingerIndex::memoryUsage() const {
+  return sizeof(uint32_t) * (starts_.capacity() + ranks_.capacity()) +
+         sizeof(uint64_t) * tree_.capacity();
+}
+
+}  // namespace McFoxIM
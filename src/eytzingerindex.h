@@ -0,0 +1,96 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+#ifndef EYTZINGERINDEX_H_
+#define EYTZINGERINDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+namespace McFoxIM {
+
+/**
+ * A search index of sorted keys that keeps a binary search within a few
+ * cache lines. The first kWidth bytes of every key are packed into an
+ * integer, and the keys are split by their first byte through a jump table.
+ * The integers of each first byte are stored in Eytzinger order, the order
+ * of a breadth-first walk of the search tree, so that the first levels of
+ * every search share cache lines and the next levels can be prefetched.
+ *
+ * Prefixes of at most kWidth bytes are resolved from the integers alone.
+ * Longer ones are narrowed to the keys that share their first kWidth bytes,
+ * which the caller then searches.
+ */
+class EytzingerIndex {
+ public:
+  static constexpr size_t kWidth = 8;
+
+  using KeyAt = std::function<std::string_view(size_t index)>;
+
+  /** The part of a prefix that the index resolves. */
+  struct Match {
+    // The keys that start with the first depth bytes of the prefix. If this
+    // is the whole prefix, [first, last) are the keys that start with it.
+    size_t first = 0;
+    size_t last = 0;
+    size_t depth = 0;
+  };
+
+  /**
+   * Builds the index of the given keys.
+   *
+   * @param size The number of keys.
+   * @param keyAt Returns a key, in byte order by index. Only called during
+   * the build.
+   */
+  void build(size_t size, const KeyAt& keyAt);
+
+  bool empty() const { return starts_.empty(); }
+
+  /** Finds the keys that start with a prefix, or with its first bytes. */
+  Match find(std::string_view prefix) const;
+
+  /** The bytes held by the arrays. */
+  size_t memoryUsage() const;
+
+ private:
+  // The first kWidth bytes of a key, padded with the given byte.
+  static uint64_t pack(std::string_view key, uint8_t padding);
+  // The number of keys of a first byte that are less than the value, or at
+  // most the value if inclusive.
+  size_t rank(size_t bucket, uint64_t value, bool inclusive) const;
+
+  // The keys of first byte b are [starts_[b], starts_[b + 1]).
+  std::vector<uint32_t> starts_;
+  // The packed keys of first byte b, in Eytzinger order from 1, are
+  // tree_[starts_[b] + b + 1, starts_[b + 1] + b + 1), and ranks_ holds the
+  // index of each of them.
+  std::vector<uint64_t> tree_;
+  std::vector<uint32_t> ranks_;
+};
+
+}  // namespace McFoxIM
+
+#endif  // EYTZINGERINDEX_H_
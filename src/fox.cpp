@@ -28,12 +28,34 @@
 #include <fcitx/candidatelist.h>
 #include <fcitx/event.h>
 #include <fcitx/inputcontext.h>
+#include <fcitx/inputmethodgroup.h>
+#include <fcitx/inputmethodmanager.h>
 #include <fcitx/inputpanel.h>
 #include <fcitx/instance.h>
 #include <fcitx/text.h>
 
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
+#include "builtintables.h"
+#include "indexcache.h"
+
 namespace McFoxIM {
 
+namespace {
+constexpr char kConfigFile[] = "conf/fox.conf";
+constexpr uint64_t kIdleCheckIntervalUsec = 60 * 1000000;
+
+// Input methods are named fox_<table id>, e.g. fox_TW_05.
+std::string tableIdFromInputMethod(const std::string& uniqueName) {
+  if (uniqueName.rfind("fox_", 0) == 0) {
+    return uniqueName.substr(4);
+  }
+  return uniqueName;
+}
+}  // namespace
+
 class FoxCandidate : public fcitx::CandidateWord {
  public:
   FoxCandidate(FoxEngine* engine, std::string text, int index)
@@ -53,8 +75,8 @@ class FoxCandidate : public fcitx::CandidateWord {
 // Note: The locate() method provided by fcitx::StandardPath::global() only
 // supports files but not directories. So we use scanDirectories() instead.
 #if USE_LEGACY_FCITX5_API_STANDARDPATH
-std::string findFoxDataPath() {
-  std::string foundPath = "";
+std::vector<std::string> findFoxDataPaths() {
+  std::vector<std::string> foundPaths;
   std::string targetSubPath = "fox/data";
 
   fcitx::StandardPath::global().scanDirectories(
@@ -63,63 +85,235 @@ std::string findFoxDataPath() {
         std::filesystem::path p =
             std::filesystem::path(basePath) / targetSubPath;
         if (std::filesystem::exists(p) && std::filesystem::is_directory(p)) {
-          foundPath = p.string();
-          return false;
+          foundPaths.push_back(p.string());
         }
         return true;
       });
 
-  return foundPath;
+  return foundPaths;
 }
 #else
-std::string findFoxDataPath() {
+std::vector<std::string> findFoxDataPaths() {
+  std::vector<std::string> foundPaths;
   std::string targetSubPath = "fox/data";
   auto dirs = fcitx::StandardPaths::global().directories(
       fcitx::StandardPathsType::PkgData);
   for (const auto& dir : dirs) {
     auto p = dir / targetSubPath;
     if (std::filesystem::exists(p) && std::filesystem::is_directory(p)) {
-      return p.string();
+      foundPaths.push_back(p.string());
     }
   }
-  return "";
+  return foundPaths;
+}
+#endif
+
+#if USE_LEGACY_FCITX5_API_STANDARDPATH
+std::string findUserDictionaryPath() {
+  return (std::filesystem::path(fcitx::StandardPath::global().userDirectory(
+              fcitx::StandardPath::Type::PkgData)) /
+          "fox/user")
+      .string();
+}
+#else
+std::string findUserDictionaryPath() {
+  return (fcitx::StandardPaths::global().userDirectory(
+              fcitx::StandardPathsType::PkgData) /
+          "fox/user")
+      .string();
 }
 #endif
 
-FoxEngine::FoxEngine(fcitx::Instance* /* Unused */)
-    : fcitx::InputMethodEngineV2() {
-  std::string dataPath = findFoxDataPath();
-  if (dataPath.empty()) {
-    FCITX_ERROR() << "FoxEngine data path is empty. Cannot initialize input "
-                     "table manager.";
-    throw std::runtime_error("FoxEngine data path is empty.");
+FoxEngine::FoxEngine(fcitx::Instance* instance)
+    : fcitx::InputMethodEngineV2(), instance_(instance) {
+  dispatcher_.attach(&instance_->eventLoop());
+  state_ = std::make_unique<InputState::EmptyState>();
+  reloadConfig();
+  // The tables are found once the event loop is idle, or on the first
+  // activation if that comes first. No table is loaded until the input
+  // method that uses it is activated.
+  initializeEvent_ = instance_->eventLoop().addDeferEvent(
+      [this](fcitx::EventSource*) {
+        initialize();
+        return true;
+      });
+}
+
+void FoxEngine::initialize() {
+  if (tableManager_) {
+    return;
+  }
+
+  // The user's directory comes first, so that tables dropped into it take
+  // precedence over the installed ones.
+  std::vector<std::string> dataPaths = findFoxDataPaths();
+  if (dataPaths.empty()) {
+    if (BuiltinTables::tables().empty()) {
+      FCITX_ERROR() << "FoxEngine data path is empty. No input table can be "
+                       "loaded.";
+    } else {
+      FCITX_INFO()
+          << "FoxEngine data path is empty, using the built-in tables.";
+    }
   }
-  tableManager_ = std::make_unique<InputTableManager>(dataPath);
-  // Set default table if available
-  if (!tableManager_->availableTables().empty()) {
-    tableManager_->setTable(0);
+  tableManager_ = std::make_unique<InputTableManager>(dataPaths);
+  tableManager_->setIndexCacheDirectory(IndexCache::defaultDirectory());
+  // Tables are loaded on a worker thread and published on the event loop.
+  tableManager_->setScheduler([this](std::function<void()> callback) {
+    dispatcher_.schedule(std::move(callback));
+  });
+  tableManager_->setTableReadyCallback(
+      [this](const std::string& /* Unused */) { refreshCandidates(); });
+
+  // Reload tables that are rebuilt or replaced while the engine is running.
+  for (const auto& dataPath : dataPaths) {
+    watchers_.push_back(std::make_unique<DataDirectoryWatcher>(
+        instance_->eventLoop(), dataPath,
+        [this, dataPath](const std::string& fileName) {
+          tableManager_->reloadFile(dataPath, fileName);
+        }));
   }
 
+  // Idle tables are checked for once a minute.
+  idleTimer_ = instance_->eventLoop().addTimeEvent(
+      CLOCK_MONOTONIC, fcitx::now(CLOCK_MONOTONIC) + kIdleCheckIntervalUsec,
+      0, [this](fcitx::EventSourceTime* source, uint64_t) {
+        evictIdleTables();
+        source->setNextInterval(kIdleCheckIntervalUsec);
+        source->setOneShot();
+        return true;
+      });
+
   completer_ = std::make_unique<Completer>(
-      [this]() -> const InputTable& { return tableManager_->currentTable(); });
+      [this]() { return tableManager_->currentTableSnapshot(); });
+  completer_->setUserDictionaryProvider(
+      [this]() -> const UserDictionary* { return currentUserDictionary(); });
 
   keyHandler_ = std::make_unique<KeyHandler>(*completer_);
-  state_ = std::make_unique<InputState::EmptyState>();
+  keyHandler_->setSelectionProvider([this]() -> std::string {
+    auto* context = activeContext_.get();
+    if (!context ||
+        !context->capabilityFlags().test(
+            fcitx::CapabilityFlag::SurroundingText) ||
+        !context->surroundingText().isValid()) {
+      return {};
+    }
+    return context->surroundingText().selectedText();
+  });
+  keyHandler_->setWordRemover([this](const std::string& word) {
+    auto* userDictionary = currentUserDictionary();
+    return userDictionary && userDictionary->remove(word);
+  });
+  applyConfig();
+
+  if (*config_.preloadTables) {
+    preloadConfiguredTables();
+  }
+}
+
+void FoxEngine::reloadConfig() {
+  fcitx::readAsIni(config_, kConfigFile);
+  applyConfig();
+}
 
+void FoxEngine::applyConfig() {
+  if (!tableManager_) {
+    // Applied once the tables are set up.
+    return;
+  }
+  tableManager_->setCacheLimits(
+      static_cast<size_t>(*config_.tableCacheSize),
+      static_cast<size_t>(*config_.tableCacheMemoryLimit) * 1024);
+  tableManager_->setCompressKeys(*config_.compressTableKeys);
+  tableManager_->setInfixSearch(*config_.infixSearch);
+  keyHandler_->setInfixSearch(*config_.infixSearch);
+  keyHandler_->setGlossLookup(*config_.glossLookup);
+  completer_->setFuzzyBudget(*config_.fuzzyCompletion
+                                 ? Completer::kDefaultFuzzyBudget
+                                 : std::chrono::microseconds(0));
+}
+
+void FoxEngine::setConfig(const fcitx::RawConfig& config) {
+  config_.load(config, true);
+  fcitx::safeSaveAsIni(config_, kConfigFile);
   reloadConfig();
 }
 
 void FoxEngine::activate(const fcitx::InputMethodEntry& entry,
-                         fcitx::InputContextEvent& /* Unused */) {
-  std::string tableName = entry.uniqueName();
-  if (tableName.rfind("fox_", 0) == 0) {
-    tableName = tableName.substr(4);
+                         fcitx::InputContextEvent& event) {
+  initialize();
+  activeContext_ = event.inputContext()->watch();
+  std::string tableName = tableIdFromInputMethod(entry.uniqueName());
+
+  // The table may have been evicted while it was idle.
+  if (currentTableName_ != tableName ||
+      (!tableManager_->isCached(tableName) && !tableManager_->isLoading())) {
+    tableManager_->requestTable(tableName);
+    currentTableName_ = tableName;
   }
+}
 
-  if (currentTableName_ != tableName) {
-    tableManager_->setTable(tableName);
-    currentTableName_ = tableName;
+void FoxEngine::evictIdleTables() {
+  tableManager_->evictIdleTables(
+      std::chrono::minutes(*config_.idleTableTimeout));
+  // Words added since the last check are merged while typing is idle.
+  for (auto& [id, userDictionary] : userDictionaries_) {
+    userDictionary->compact();
+  }
+}
+
+UserDictionary* FoxEngine::currentUserDictionary() {
+  if (currentTableName_.empty()) {
+    return nullptr;
   }
+  auto& userDictionary = userDictionaries_[currentTableName_];
+  if (!userDictionary) {
+    userDictionary = std::make_unique<UserDictionary>(
+        findUserDictionaryPath(), currentTableName_);
+    userDictionary->setScheduler([this](std::function<void()> callback) {
+      dispatcher_.schedule(std::move(callback));
+    });
+  }
+  return userDictionary.get();
+}
+
+void FoxEngine::preloadConfiguredTables() {
+  auto& inputMethodManager = instance_->inputMethodManager();
+  std::vector<std::string> ids;
+  for (const auto& groupName : inputMethodManager.groups()) {
+    const auto* group = inputMethodManager.group(groupName);
+    if (!group) {
+      continue;
+    }
+    for (const auto& item : group->inputMethodList()) {
+      if (item.name().rfind("fox_", 0) != 0) {
+        continue;
+      }
+      auto id = tableIdFromInputMethod(item.name());
+      if (std::find(ids.begin(), ids.end(), id) == ids.end()) {
+        ids.push_back(id);
+      }
+    }
+  }
+  tableManager_->preloadTables(ids);
+}
+
+void FoxEngine::refreshCandidates() {
+  // Candidates for text typed while the table was loading.
+  auto* context = activeContext_.get();
+  auto* inputState = dynamic_cast<InputState::InputtingState*>(state_.get());
+  if (!context || !inputState) {
+    return;
+  }
+
+  InputState::InputtingState::Args args;
+  args.cursorIndex = inputState->cursorIndex();
+  args.composingBuffer = inputState->composingBuffer();
+  args.candidates = completer_->complete(args.composingBuffer);
+  if (!args.candidates.empty()) {
+    args.selectedCandidateIndex = 0;
+  }
+  enterState(std::make_unique<InputState::InputtingState>(args), context);
 }
 
 void FoxEngine::reset(const fcitx::InputMethodEntry& entry,
@@ -141,7 +335,29 @@ void FoxEngine::keyEvent(const fcitx::InputMethodEntry& entry,
     return;
   }
 
+  initialize();
   auto context = keyEvent.inputContext();
+  activeContext_ = context->watch();
+  tableManager_->touchCurrentTable();
+
+  // A word without candidates that is committed as typed is learned. A
+  // table that is still loading, or failed to, has no candidates for any
+  // word, so nothing is learned until it is ready.
+  std::string newWord;
+  if (auto inputState =
+          dynamic_cast<InputState::InputtingState*>(state_.get())) {
+    // The text of a search is not a word.
+    char first = inputState->composingBuffer()[0];
+    if (*config_.learnNewWords && !tableManager_->isLoading() &&
+        tableManager_->isCached(currentTableName_) &&
+        inputState->candidatesInCurrentPage().empty() &&
+        first != KeyHandler::kInfixMarker &&
+        first != KeyHandler::kGlossMarker &&
+        (keyEvent.key().check(fcitx::Key(FcitxKey_Tab)) ||
+         keyEvent.key().check(fcitx::Key(FcitxKey_Return)))) {
+      newWord = inputState->composingBuffer();
+    }
+  }
 
   bool handled = keyHandler_->handle(
       keyEvent, *state_,
@@ -154,6 +370,11 @@ void FoxEngine::keyEvent(const fcitx::InputMethodEntry& entry,
 
   if (handled) {
     keyEvent.accept();
+    if (!newWord.empty()) {
+      if (auto* userDictionary = currentUserDictionary()) {
+        userDictionary->add(newWord);
+      }
+    }
   } else {
     if (auto inputState =
             dynamic_cast<InputState::InputtingState*>(state_.get())) {
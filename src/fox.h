@@ -27,16 +27,24 @@
 #include <fcitx-config/configuration.h>
 #include <fcitx-config/enum.h>
 #include <fcitx-config/iniparser.h>
+#include <fcitx-utils/event.h>
+#include <fcitx-utils/eventdispatcher.h>
 #include <fcitx-utils/i18n.h>
 #include <fcitx/addonfactory.h>
+#include <fcitx/inputcontext.h>
 #include <fcitx/inputmethodengine.h>
 
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "completer.h"
+#include "datadirectorywatcher.h"
 #include "inputstate.h"
 #include "inputtablemanager.h"
 #include "keyhandler.h"
+#include "userdictionary.h"
 
 namespace fcitx {
 class Instance;
@@ -44,6 +52,55 @@ class Instance;
 
 namespace McFoxIM {
 
+FCITX_CONFIGURATION(
+    FoxConfig,
+    fcitx::Option<int, fcitx::IntConstrain> tableCacheSize{
+        this, "TableCacheSize",
+        _("Number of input tables kept in memory"),
+        static_cast<int>(InputTableManager::kDefaultMaxCachedTables),
+        fcitx::IntConstrain(1, 64)};
+    fcitx::Option<int, fcitx::IntConstrain> tableCacheMemoryLimit{
+        this, "TableCacheMemoryLimit",
+        _("Memory limit of the input tables kept in memory (KiB, 0 for no "
+          "limit)"),
+        0, fcitx::IntConstrain(0, 1024 * 1024)};
+    fcitx::Option<int, fcitx::IntConstrain> idleTableTimeout{
+        this, "IdleTableTimeout",
+        _("Unload input tables that have not been used for this many minutes "
+          "(0 to keep them)"),
+        30, fcitx::IntConstrain(0, 24 * 60)};
+    fcitx::Option<bool> preloadTables{
+        this, "PreloadTables",
+        _("Load the tables of all configured input methods in the "
+          "background at startup"),
+        false};
+    fcitx::Option<bool> compressTableKeys{
+        this, "CompressTableKeys",
+        _("Compress the phrases of loaded tables to save memory at the cost "
+          "of slower lookups"),
+        false};
+    fcitx::Option<bool> infixSearch{
+        this, "InfixSearch",
+        _("Type * first to find the words that contain what is typed after "
+          "it"),
+        false};
+    fcitx::Option<bool> glossLookup{
+        this, "GlossLookup",
+        _("Type = to find the words whose Mandarin gloss contains the "
+          "selected text or what is typed after it"),
+        false};
+    fcitx::Option<bool> fuzzyCompletion{
+        this, "FuzzyCompletion",
+        _("Suggest the words that are one or two typos away when nothing "
+          "matches what is typed"),
+        false};
+    fcitx::Option<bool> learnNewWords{
+        this, "LearnNewWords",
+        _("Add words that have no candidates to the user dictionary when "
+          "they are committed with Tab or Return (Shift+Delete on a "
+          "candidate removes it again)"),
+        false};);
+
 class FoxEngine : public fcitx::InputMethodEngineV2 {
  public:
   FoxEngine(fcitx::Instance* instance);
@@ -55,7 +112,15 @@ class FoxEngine : public fcitx::InputMethodEngineV2 {
              fcitx::InputContext& context);
   void selectCandidate(int index, fcitx::InputContext* context);
 
+  void reloadConfig() override;
+  const fcitx::Configuration* getConfig() const override { return &config_; }
+  void setConfig(const fcitx::RawConfig& config) override;
+
  private:
+  // Finds the tables and sets up completion. Does nothing after the first
+  // call.
+  void initialize();
+  void applyConfig();
   void enterState(std::unique_ptr<InputState::InputState> newState,
                   fcitx::InputContext* context);
   void handleEmptyState(fcitx::InputContext* context);
@@ -65,12 +130,27 @@ class FoxEngine : public fcitx::InputMethodEngineV2 {
                             fcitx::InputContext* context);
   void updateUI(const InputState::InputtingState& newState,
                 fcitx::InputContext* context);
+  void refreshCandidates();
+  void preloadConfiguredTables();
+  void evictIdleTables();
+  // The user dictionary of the current table, opened on first use.
+  UserDictionary* currentUserDictionary();
 
+  fcitx::Instance* instance_;
+  FoxConfig config_;
   std::string currentTableName_;
+  // Declared before tableManager_ so that it outlives the table loader.
+  fcitx::EventDispatcher dispatcher_;
+  fcitx::TrackableObjectReference<fcitx::InputContext> activeContext_;
   std::unique_ptr<InputTableManager> tableManager_;
+  std::vector<std::unique_ptr<DataDirectoryWatcher>> watchers_;
+  std::unique_ptr<fcitx::EventSourceTime> idleTimer_;
   std::unique_ptr<Completer> completer_;
+  // By table id.
+  std::map<std::string, std::unique_ptr<UserDictionary>> userDictionaries_;
   std::unique_ptr<KeyHandler> keyHandler_;
   std::unique_ptr<InputState::InputState> state_;
+  std::unique_ptr<fcitx::EventSource> initializeEvent_;
 };
 
 class FoxAddonFactory : public fcitx::AddonFactory {
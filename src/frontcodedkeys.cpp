@@ -0,0 +1,110 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "frontcodedkeys.h"
+
+#include <algorithm>
+
+namespace McFoxIM {
+
+namespace {
+
+void appendVarint(std::vector<char>& out, size_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+size_t readVarint(const char* data, size_t& position) {
+  size_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    auto byte = static_cast<unsigned char>(data[position++]);
+    value |= static_cast<size_t>(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      return value;
+    }
+  }
+}
+
+}  // namespace
+
+void FrontCodedKeys::append(std::string_view key) {
+  if (size_ % kBlockSize == 0) {
+    blockOffsets_.push_back(static_cast<uint32_t>(data_.size()));
+    appendVarint(data_, key.size());
+    data_.insert(data_.end(), key.begin(), key.end());
+  } else {
+    size_t shared = std::mismatch(last_.begin(), last_.end(), key.begin(),
+                                  key.end())
+                        .first -
+                    last_.begin();
+    appendVarint(data_, shared);
+    appendVarint(data_, key.size() - shared);
+    data_.insert(data_.end(), key.begin() + shared, key.end());
+  }
+  last_.assign(key);
+  ++size_;
+}
+
+void FrontCodedKeys::shrinkToFit() {
+  data_.shrink_to_fit();
+  blockOffsets_.shrink_to_fit();
+  last_ = std::string();
+}
+
+size_t FrontCodedKeys::memoryUsage() const {
+  return data_.capacity() + sizeof(uint32_t) * blockOffsets_.capacity();
+}
+
+std::string FrontCodedKeys::at(size_t index) const {
+  std::string key;
+  at(index, key);
+  return key;
+}
+
+void FrontCodedKeys::at(size_t index, std::string& key) const {
+  size_t block = index / kBlockSize;
+  size_t position = decodeNext(blockOffsets_[block], true, key);
+  for (size_t i = block * kBlockSize; i < index; ++i) {
+    position = decodeNext(position, false, key);
+  }
+}
+
+size_t FrontCodedKeys::decodeNext(size_t position, bool head,
+                                  std::string& key) const {
+  size_t shared = head ? 0 : readVarint(data_.data(), position);
+  size_t length = readVarint(data_.data(), position);
+  key.resize(shared);
+  key.append(data_.data() + position, length);
+  return position + length;
+}
+
+std::string_view FrontCodedKeys::headOf(size_t block) const {
+  size_t position = blockOffsets_[block];
+  size_t length = readVarint(data_.data(), position);
+  return {data_.data() + position, length};
+}
+
+}  // namespace McFoxIM
@@ -0,0 +1,152 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef FRONTCODEDKEYS_H_
+#define FRONTCODEDKEYS_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace McFoxIM {
+
+/**
+ * A sorted list of keys stored with front coding.
+ *
+ * Keys are grouped in blocks of kBlockSize. The first key of a block, its
+ * head, is stored whole; every other key is stored as the length of the
+ * prefix it shares with the key before it plus the rest of its bytes. Block
+ * heads can be read in place, so searches binary search the heads and then
+ * decode a single block.
+ *
+ * Encoding (lengths are LEB128 varints):
+ *
+ *   block  := head entry*
+ *   head   := length bytes
+ *   entry  := shared suffixLength suffix
+ */
+class FrontCodedKeys {
+ public:
+  static constexpr size_t kBlockSize = 16;
+
+  FrontCodedKeys() = default;
+
+  /** Appends a key, which must not sort before the last appended key. */
+  void append(std::string_view key);
+
+  /** Releases the spare capacity left over from appending. */
+  void shrinkToFit();
+
+  size_t size() const { return size_; }
+
+  /** The bytes held by the encoded keys and the block index. */
+  size_t memoryUsage() const;
+
+  /** Decodes the key at the given index. */
+  std::string at(size_t index) const;
+  /** Decodes the key at the given index into key, reusing its buffer. */
+  void at(size_t index, std::string& key) const;
+
+  /**
+   * Finds the first key for which the predicate is false. The predicate must
+   * be true for a (possibly empty) run of leading keys and false for the
+   * rest.
+   */
+  template <typename Predicate>
+  size_t partitionPoint(Predicate&& predicate) const;
+
+  /**
+   * Calls visit(index, key) for every key in [first, last), decoding each
+   * block at most once. The key view is only valid during the call.
+   */
+  template <typename Visitor>
+  void visit(size_t first, size_t last, Visitor&& visit) const;
+
+ private:
+  // Reads one key from the encoded data at position, replacing the tail of
+  // key after its shared prefix. Returns the position of the next key.
+  size_t decodeNext(size_t position, bool head, std::string& key) const;
+  std::string_view headOf(size_t block) const;
+
+  std::vector<char> data_;
+  std::vector<uint32_t> blockOffsets_;
+  std::string last_;
+  size_t size_ = 0;
+};
+
+template <typename Predicate>
+size_t FrontCodedKeys::partitionPoint(Predicate&& predicate) const {
+  // Count the blocks whose head satisfies the predicate.
+  size_t left = 0;
+  size_t right = blockOffsets_.size();
+  while (left < right) {
+    size_t mid = left + (right - left) / 2;
+    if (predicate(headOf(mid))) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  if (left == 0) {
+    return 0;
+  }
+
+  // The partition point lies after the head of the last such block.
+  size_t block = left - 1;
+  size_t index = block * kBlockSize;
+  size_t end = std::min(index + kBlockSize, size_);
+  std::string key;
+  size_t position = decodeNext(blockOffsets_[block], true, key);
+  for (++index; index < end; ++index) {
+    position = decodeNext(position, false, key);
+    if (!predicate(std::string_view(key))) {
+      return index;
+    }
+  }
+  return end;
+}
+
+template <typename Visitor>
+void FrontCodedKeys::visit(size_t first, size_t last, Visitor&& visit) const {
+  if (first >= last) {
+    return;
+  }
+  std::string key;
+  size_t index = first - first % kBlockSize;
+  size_t position = 0;
+  for (; index < last; ++index) {
+    bool head = index % kBlockSize == 0;
+    position = decodeNext(head ? blockOffsets_[index / kBlockSize] : position,
+                          head, key);
+    if (index >= first) {
+      visit(index, std::string_view(key));
+    }
+  }
+}
+
+}  // namespace McFoxIM
+
+#endif  // FRONTCODEDKEYS_H_
@@ -0,0 +1,137 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "glossdictionary.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <mutex>
+
+namespace McFoxIM {
+
+namespace {
+
+size_t slotOf(std::string_view gloss, size_t slotCount) {
+  return std::hash<std::string_view>()(gloss) & (slotCount - 1);
+}
+
+}  // namespace
+
+uint32_t GlossDictionary::intern(std::string_view gloss) {
+  auto find = [this](std::string_view gloss) {
+    if (slots_.empty()) {
+      return kEmptySlot;
+    }
+    for (size_t slot = slotOf(gloss, slots_.size());;
+         slot = (slot + 1) & (slots_.size() - 1)) {
+      uint32_t id = slots_[slot];
+      if (id == kEmptySlot || glosses_[id] == gloss) {
+        return id;
+      }
+    }
+  };
+
+  {
+    std::shared_lock lock(mutex_);
+    uint32_t id = find(gloss);
+    if (id != kEmptySlot) {
+      return id;
+    }
+  }
+
+  std::unique_lock lock(mutex_);
+  uint32_t id = find(gloss);
+  if (id != kEmptySlot) {
+    return id;
+  }
+  // Keep the table at most half full.
+  if (2 * (glosses_.size() + 1) > slots_.size()) {
+    rehash(std::max<size_t>(64, 2 * slots_.size()));
+  }
+  id = static_cast<uint32_t>(glosses_.size());
+  glosses_.push_back(store(gloss));
+  size_t slot = slotOf(gloss, slots_.size());
+  while (slots_[slot] != kEmptySlot) {
+    slot = (slot + 1) & (slots_.size() - 1);
+  }
+  slots_[slot] = id;
+  return id;
+}
+
+std::string_view GlossDictionary::store(std::string_view gloss) {
+  if (gloss.empty()) {
+    // There may be no block yet.
+    return {};
+  }
+  if (gloss.size() > kBlockSize) {
+    // An oversized gloss gets a block of its own, put before the block that
+    // is being filled.
+    auto block = std::make_unique<char[]>(gloss.size());
+    std::memcpy(block.get(), gloss.data(), gloss.size());
+    std::string_view stored(block.get(), gloss.size());
+    blockBytes_ += gloss.size();
+    blocks_.insert(blocks_.empty() ? blocks_.end() : blocks_.end() - 1,
+                   std::move(block));
+    return stored;
+  }
+  if (gloss.size() > kBlockSize - blockUsed_) {
+    blocks_.push_back(std::make_unique<char[]>(kBlockSize));
+    blockUsed_ = 0;
+    blockBytes_ += kBlockSize;
+  }
+  char* data = blocks_.back().get() + blockUsed_;
+  std::memcpy(data, gloss.data(), gloss.size());
+  blockUsed_ += gloss.size();
+  return {data, gloss.size()};
+}
+
+void GlossDictionary::rehash(size_t slotCount) {
+  slots_.assign(slotCount, kEmptySlot);
+  for (uint32_t id = 0; id < glosses_.size(); ++id) {
+    size_t slot = slotOf(glosses_[id], slotCount);
+    while (slots_[slot] != kEmptySlot) {
+      slot = (slot + 1) & (slotCount - 1);
+    }
+    slots_[slot] = id;
+  }
+}
+
+std::string_view GlossDictionary::at(uint32_t id) const {
+  std::shared_lock lock(mutex_);
+  return glosses_[id];
+}
+
+size_t GlossDictionary::size() const {
+  std::shared_lock lock(mutex_);
+  return glosses_.size();
+}
+
+size_t GlossDictionary::memoryUsage() const {
+  std::shared_lock lock(mutex_);
+  return blockBytes_ + sizeof(std::string_view) * glosses_.capacity() +
+         sizeof(uint32_t) * slots_.capacity() +
+         sizeof(std::unique_ptr<char[]>) * blocks_.capacity();
+}
+
+}  // namespace McFoxIM
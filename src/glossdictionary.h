@@ -0,0 +1,89 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef GLOSSDICTIONARY_H_
+#define GLOSSDICTIONARY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+namespace McFoxIM {
+
+/**
+ * An interned store of descriptions shared by the loaded JSON tables.
+ *
+ * The dialect tables translate the same Mandarin glossary, so the same
+ * glosses appear in every table. Tables that share a dictionary keep a 32-bit
+ * gloss id per entry instead of their own copy of each description. Glosses
+ * are never removed, so the store is bounded by the distinct glosses of the
+ * JSON tables that have been parsed; compiled tables keep their descriptions
+ * in the mapping and never add to it. It is safe to use from several
+ * threads.
+ */
+class GlossDictionary {
+ public:
+  GlossDictionary() = default;
+  GlossDictionary(const GlossDictionary&) = delete;
+  GlossDictionary& operator=(const GlossDictionary&) = delete;
+
+  /**
+   * Adds a gloss to the dictionary.
+   *
+   * @returns The id of the gloss, the same for every equal gloss.
+   */
+  uint32_t intern(std::string_view gloss);
+
+  /** The gloss with the given id. The view stays valid with the dictionary. */
+  std::string_view at(uint32_t id) const;
+
+  /** The number of distinct glosses. */
+  size_t size() const;
+
+  /** The approximate bytes held by the dictionary. */
+  size_t memoryUsage() const;
+
+ private:
+  static constexpr size_t kBlockSize = 4096;
+  static constexpr uint32_t kEmptySlot = UINT32_MAX;
+
+  std::string_view store(std::string_view gloss);
+  void rehash(size_t slotCount);
+
+  mutable std::shared_mutex mutex_;
+  // The bytes of the glosses, in blocks that are never moved, so the views
+  // stay valid while the dictionary grows.
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  size_t blockUsed_ = kBlockSize;
+  size_t blockBytes_ = 0;
+  std::vector<std::string_view> glosses_;
+  // An open-addressing hash table of gloss ids.
+  std::vector<uint32_t> slots_;
+};
+
+}  // namespace McFoxIM
+
+#endif  // GLOSSDICTIONARY_H_
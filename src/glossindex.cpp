@@ -0,0 +1,152 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+#include "glossindex.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "utf8.h"
+
+namespace McFoxIM {
+
+namespace {
+
+std::vector<uint32_t> characters(std::string_view text) {
+  std::vector<uint32_t> result;
+  for (size_t pos = 0; pos < text.size();) {
+    result.push_back(Utf8::nextCharacter(text, pos));
+  }
+  return result;
+}
+
+}  // namespace
+
+void GlossIndex::build(size_t size, const TextAt& textAt) {
+  grams_.clear();
+  listStarts_.clear();
+  postings_.clear();
+
+  std::vector<std::pair<uint64_t, uint32_t>> pairs;
+  for (size_t i = 0; i < size; ++i) {
+    auto text = characters(textAt(i));
+    for (size_t c = 0; c < text.size(); ++c) {
+      uint32_t next = c + 1 < text.size() ? text[c + 1] : kEnd;
+      pairs.emplace_back(gram(text[c], next), static_cast<uint32_t>(i));
+    }
+  }
+  std::sort(pairs.begin(), pairs.end());
+  pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+  uint32_t previous = 0;
+  for (const auto& [key, index] : pairs) {
+    uint32_t delta = index - previous;
+    if (grams_.empty() || grams_.back() != key) {
+      grams_.push_back(key);
+      listStarts_.push_back(static_cast<uint32_t>(postings_.size()));
+      delta = index;
+    }
+    for (; delta >= 0x80; delta >>= 7) {
+      postings_.push_back(static_cast<uint8_t>(delta | 0x80));
+    }
+    postings_.push_back(static_cast<uint8_t>(delta));
+    previous = index;
+  }
+  listStarts_.push_back(static_cast<uint32_t>(postings_.size()));
+  grams_.shrink_to_fit();
+  listStarts_.shrink_to_fit();
+  postings_.shrink_to_fit();
+}
+
+void GlossIndex::decode(size_t index, std::vector<uint32_t>& list) const {
+  uint32_t value = 0;
+  for (size_t pos = listStarts_[index]; pos < listStarts_[index + 1];) {
+    uint32_t delta = 0;
+    for (int shift = 0;; shift += 7) {
+      uint8_t byte = postings_[pos++];
+      delta |= static_cast<uint32_t>(byte & 0x7f) << shift;
+      if (byte < 0x80) {
+        break;
+      }
+    }
+    value += delta;
+    list.push_back(value);
+  }
+}
+
+std::vector<uint32_t> GlossIndex::find(std::string_view text) const {
+  std::vector<uint32_t> result;
+  auto query = characters(text);
+  if (query.empty() || grams_.empty()) {
+    return result;
+  }
+
+  if (query.size() == 1) {
+    auto first = std::lower_bound(grams_.begin(), grams_.end(),
+                                  gram(query[0], 0));
+    auto last = std::lower_bound(first, grams_.end(), gram(query[0] + 1, 0));
+    for (auto it = first; it != last; ++it) {
+      decode(static_cast<size_t>(it - grams_.begin()), result);
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+  }
+
+  // The shortest lists are intersected first, which keeps the result small.
+  std::vector<size_t> lists;
+  for (size_t c = 0; c + 1 < query.size(); ++c) {
+    uint64_t key = gram(query[c], query[c + 1]);
+    auto it = std::lower_bound(grams_.begin(), grams_.end(), key);
+    if (it == grams_.end() || *it != key) {
+      return result;
+    }
+    lists.push_back(static_cast<size_t>(it - grams_.begin()));
+  }
+  auto bytes = [this](size_t index) {
+    return listStarts_[index + 1] - listStarts_[index];
+  };
+  std::sort(lists.begin(), lists.end(), [&](size_t a, size_t b) {
+    return bytes(a) < bytes(b);
+  });
+
+  decode(lists[0], result);
+  std::vector<uint32_t> list;
+  std::vector<uint32_t> both;
+  for (size_t i = 1; i < lists.size() && !result.empty(); ++i) {
+    list.clear();
+    decode(lists[i], list);
+    both.clear();
+    std::set_intersection(result.begin(), result.end(), list.begin(),
+                          list.end(), std::back_inserter(both));
+    result.swap(both);
+  }
+  return result;
+}
+
+size_t GlossIndex::memoryUsage() const {
+  return sizeof(uint64_t) * grams_.capacity() +
+         sizeof(uint32_t) * listStarts_.capacity() + postings_.capacity();
+}
+
+}  // namespace McFoxIM
@@ -0,0 +1,94 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+#ifndef GLOSSINDEX_H_
+#define GLOSSINDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+namespace McFoxIM {
+
+/**
+ * An inverted index of the character bigrams of a list of texts, such as the
+ * descriptions of a table, which finds the texts that may contain a string
+ * without reading them.
+ *
+ * Every text is indexed by each pair of adjacent UTF-8 characters in it, and
+ * by its last character followed by an end mark, so that every character of
+ * a text starts a bigram. A string of several characters is looked up by
+ * intersecting the lists of its bigrams, and a single character by merging
+ * the lists of the bigrams it starts.
+ *
+ * The lists are sorted, and stored as the differences between consecutive
+ * indices in LEB128 bytes, most of which take one byte.
+ */
+class GlossIndex {
+ public:
+  using TextAt = std::function<std::string_view(size_t index)>;
+
+  /**
+   * Builds the index of the given texts.
+   *
+   * @param size The number of texts.
+   * @param textAt Returns a text by index. Only called during the build.
+   */
+  void build(size_t size, const TextAt& textAt);
+
+  /**
+   * Finds the texts that have every bigram of a string.
+   *
+   * @returns The indices of the texts in order. They contain the string if
+   * it is a single character, and may contain it otherwise; the caller
+   * checks.
+   */
+  std::vector<uint32_t> find(std::string_view text) const;
+
+  /** The number of distinct bigrams. */
+  size_t gramCount() const { return grams_.size(); }
+
+  /** The bytes held by the index. */
+  size_t memoryUsage() const;
+
+ private:
+  // Follows the last character of a text.
+  static constexpr uint32_t kEnd = 0x110000;
+
+  static uint64_t gram(uint32_t first, uint32_t second) {
+    return (static_cast<uint64_t>(first) << 21) | second;
+  }
+  // Appends the list of the bigram at an index of grams_.
+  void decode(size_t index, std::vector<uint32_t>& list) const;
+
+  // The distinct bigrams in order, with their lists at
+  // postings_[listStarts_[i], listStarts_[i + 1]).
+  std::vector<uint64_t> grams_;
+  std::vector<uint32_t> listStarts_;
+  std::vector<uint8_t> postings_;
+};
+
+}  // namespace McFoxIM
+
+#endif  // GLOSSINDEX_H_
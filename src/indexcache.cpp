@@ -0,0 +1,115 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "indexcache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+#include "tableformat.h"
+#include "tablemanifest.h"
+
+namespace McFoxIM {
+namespace IndexCache {
+
+namespace {
+
+// A copy is named <path hash>-<version hash>.table.
+std::string hashName(uint64_t hash) {
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx",
+                static_cast<unsigned long long>(hash));
+  return name;
+}
+
+std::string pathPrefix(const std::filesystem::path& source) {
+  std::string path = source.string();
+  return hashName(TableManifest::checksum(path.data(), path.size())) + "-";
+}
+
+}  // namespace
+
+std::string defaultDirectory() {
+  std::filesystem::path directory;
+  if (const char* cache = std::getenv("XDG_CACHE_HOME"); cache && *cache) {
+    directory = cache;
+  } else if (const char* home = std::getenv("HOME"); home && *home) {
+    directory = std::filesystem::path(home) / ".cache";
+  } else {
+    return "";
+  }
+  return (directory / "fcitx5" / "fox").string();
+}
+
+std::string pathFor(const std::string& directory, const std::string& source) {
+  std::error_code ec;
+  auto path = std::filesystem::absolute(source, ec);
+  if (ec) {
+    return "";
+  }
+  auto size = std::filesystem::file_size(path, ec);
+  if (ec) {
+    return "";
+  }
+  auto time = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return "";
+  }
+
+  uint64_t version[2] = {
+      static_cast<uint64_t>(time.time_since_epoch().count()),
+      static_cast<uint64_t>(size)};
+  std::string name =
+      pathPrefix(path) +
+      hashName(TableManifest::checksum(reinterpret_cast<const char*>(version),
+                                       sizeof(version))) +
+      TableFormat::kFileExtension;
+  return (std::filesystem::path(directory) / name).string();
+}
+
+bool store(const std::string& directory, const std::string& source,
+           const InputTable& table) {
+  std::string path = pathFor(directory, source);
+  if (path.empty()) {
+    return false;
+  }
+  std::error_code ec;
+  std::filesystem::create_directories(directory, ec);
+  if (ec) {
+    return false;
+  }
+
+  std::string prefix = pathPrefix(std::filesystem::absolute(source, ec));
+  for (const auto& entry :
+       std::filesystem::directory_iterator(directory, ec)) {
+    std::string name = entry.path().filename().string();
+    if (name.starts_with(prefix) && entry.path() != path) {
+      std::filesystem::remove(entry.path(), ec);
+    }
+  }
+  return TableFormat::write(table, path);
+}
+
+}  // namespace IndexCache
+}  // namespace McFoxIM
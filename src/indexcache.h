@@ -0,0 +1,70 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef INDEXCACHE_H_
+#define INDEXCACHE_H_
+
+#include <string>
+
+namespace McFoxIM {
+
+class InputTable;
+
+/**
+ * The index cache keeps a compiled copy (see TableFormat) of every JSON
+ * table that has been loaded, so that the next load maps the copy instead of
+ * parsing and sorting the JSON again.
+ *
+ * A copy is named after the path, the modification time and the size of its
+ * JSON table, so a changed table misses the cache. Copies of older versions
+ * of a table are removed when a new copy is stored.
+ */
+namespace IndexCache {
+
+/**
+ * The cache directory of the addon: $XDG_CACHE_HOME/fcitx5/fox, or
+ * ~/.cache/fcitx5/fox when XDG_CACHE_HOME is not set.
+ *
+ * @returns The directory, or an empty string if neither variable is set.
+ */
+std::string defaultDirectory();
+
+/**
+ * The path of the cached copy of the given table in the given directory.
+ *
+ * @returns The path, or an empty string if the table cannot be examined.
+ */
+std::string pathFor(const std::string& directory, const std::string& source);
+
+/**
+ * Stores a copy of the given table, loaded from source.
+ *
+ * @returns true on success.
+ */
+bool store(const std::string& directory, const std::string& source,
+           const InputTable& table);
+
+}  // namespace IndexCache
+}  // namespace McFoxIM
+
+#endif  // INDEXCACHE_H_
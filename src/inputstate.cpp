@@ -35,16 +35,18 @@ InputtingState::InputtingState(Args args)
     : cursorIndex_(args.cursorIndex),
       composingBuffer_(std::move(args.composingBuffer)),
       candidates_(std::move(args.candidates)),
+      completeAll_(std::move(args.completeAll)),
       selectedCandidateIndex_(args.selectedCandidateIndex) {
   if (!candidates_.empty()) {
     size_t selectedIndex = selectedCandidateIndex_.value_or(0);
     selectedCandidateIndex_ = selectedIndex;
 
-    candidatePageCount_ =
-        (candidates_.size() + CANDIDATES_PER_PAGE - 1) / CANDIDATES_PER_PAGE;
-
     size_t pageIndex = selectedIndex / CANDIDATES_PER_PAGE;
     size_t startIndex = pageIndex * CANDIDATES_PER_PAGE;
+    // The first candidates are enough for the page they fill.
+    if (startIndex + CANDIDATES_PER_PAGE > candidates_.size()) {
+      candidates();
+    }
     size_t endIndex =
         std::min(startIndex + CANDIDATES_PER_PAGE, candidates_.size());
 
@@ -58,5 +60,20 @@ InputtingState::InputtingState(Args args)
   }
 }
 
+const std::vector<Candidate>& InputtingState::candidates() const {
+  if (completeAll_) {
+    candidates_ = completeAll_();
+    completeAll_ = nullptr;
+  }
+  return candidates_;
+}
+
+std::optional<size_t> InputtingState::candidatePageCount() const {
+  if (candidates_.empty()) {
+    return std::nullopt;
+  }
+  return (candidates().size() + CANDIDATES_PER_PAGE - 1) / CANDIDATES_PER_PAGE;
+}
+
 }  // namespace InputState
 }  // namespace McFoxIM
@@ -25,6 +25,7 @@
 #define INPUTSTATE_H_
 
 #include <cmath>
+#include <functional>
 #include <optional>
 #include <string>
 #include <vector>
@@ -59,13 +60,18 @@ class InputtingState : public InputState {
     std::string composingBuffer;
     std::vector<Candidate> candidates;
     std::optional<size_t> selectedCandidateIndex = std::nullopt;
+    // Completes all the candidates when the ones above are only the first
+    // (see Completer::completeFirst()). It runs once the state needs more
+    // than the page they are on.
+    std::function<std::vector<Candidate>()> completeAll;
   };
 
   explicit InputtingState(Args args);
 
   size_t cursorIndex() const { return cursorIndex_; }
   const std::string& composingBuffer() const { return composingBuffer_; }
-  const std::vector<Candidate>& candidates() const { return candidates_; }
+  /** All the candidates, which completes them if they are not yet. */
+  const std::vector<Candidate>& candidates() const;
   std::optional<size_t> selectedCandidateIndex() const {
     return selectedCandidateIndex_;
   }
@@ -79,20 +85,18 @@ class InputtingState : public InputState {
   std::optional<size_t> candidatePageIndex() const {
     return candidatePageIndex_;
   }
-  std::optional<size_t> candidatePageCount() const {
-    return candidatePageCount_;
-  }
+  std::optional<size_t> candidatePageCount() const;
 
  private:
   size_t cursorIndex_;
   std::string composingBuffer_;
-  std::vector<Candidate> candidates_;
+  mutable std::vector<Candidate> candidates_;
+  mutable std::function<std::vector<Candidate>()> completeAll_;
   std::optional<size_t> selectedCandidateIndex_;
 
   std::vector<Candidate> candidatesInCurrentPage_;
   std::optional<size_t> selectedCandidateIndexInCurrentPage_;
   std::optional<size_t> candidatePageIndex_;
-  std::optional<size_t> candidatePageCount_;
 };
 
 }  // namespace InputState
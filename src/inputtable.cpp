@@ -26,59 +26,874 @@
 #include <fcitx-utils/log.h>
 
 #include <algorithm>
-#include <fstream>
+#include <filesystem>
+#include <map>
+#include <numeric>
 #include <nlohmann/json.hpp>
+#include <thread>
+#include <tuple>
+
+#include "keyscan.h"
+#include "tableformat.h"
+#include "utf8.h"
 
 using json = nlohmann::json;
 
 namespace McFoxIM {
 
-bool InputTable::load(const std::string& path) {
-  std::ifstream f(path);
-  if (!f.is_open()) {
+// Receives the events of nlohmann's SAX parser for a table of the form
+// {"name": "...", "data": [["phrase", "description"], ...]}. No DOM is built:
+// the bytes of each string are appended from the parser straight into the
+// arenas, or the descriptions into the gloss dictionary when there is one.
+// Items with fewer than two fields are skipped, like non-array items, and a
+// non-string phrase or description fails the parse.
+class InputTable::JsonHandler {
+ public:
+  JsonHandler(std::string& name, Arenas& arenas, GlossDictionary* glosses)
+      : name_(name), arenas_(arenas), glosses_(glosses) {}
+
+  bool null() { return field(); }
+  bool boolean(bool) { return field(); }
+  bool number_integer(json::number_integer_t) { return field(); }
+  bool number_unsigned(json::number_unsigned_t) { return field(); }
+  bool number_float(json::number_float_t, const json::string_t&) {
+    return field();
+  }
+  bool binary(json::binary_t&) { return field(); }
+
+  bool string(json::string_t& value) {
+    if (depth_ == 1 && rootKey_ == "name") {
+      name_ = std::move(value);
+    } else if (inItem_ && depth_ == 3) {
+      if (itemFields_ == 0) {
+        arenas_.keys.insert(arenas_.keys.end(), value.begin(), value.end());
+      } else if (itemFields_ == 1 && glosses_) {
+        glossId_ = glosses_->intern(value);
+      } else if (itemFields_ == 1) {
+        arenas_.descriptions.insert(arenas_.descriptions.end(), value.begin(),
+                                    value.end());
+      }
+      ++itemFields_;
+    }
+    return true;
+  }
+
+  bool key(json::string_t& key) {
+    if (depth_ == 1) {
+      rootKey_ = std::move(key);
+    }
+    return true;
+  }
+
+  bool start_object(std::size_t) {
+    if (!field()) {
+      return false;
+    }
+    ++depth_;
+    return true;
+  }
+
+  bool end_object() {
+    --depth_;
+    return true;
+  }
+
+  bool start_array(std::size_t) {
+    if (depth_ == 1 && rootKey_ == "data") {
+      inData_ = true;
+    } else if (inData_ && depth_ == 2) {
+      inItem_ = true;
+      itemFields_ = 0;
+    } else if (!field()) {
+      return false;
+    }
+    ++depth_;
+    return true;
+  }
+
+  bool end_array() {
+    --depth_;
+    if (inItem_ && depth_ == 2) {
+      inItem_ = false;
+      endItem();
+    } else if (inData_ && depth_ == 1) {
+      inData_ = false;
+    }
+    return true;
+  }
+
+  bool parse_error(std::size_t, const std::string&, const json::exception&) {
+    return false;
+  }
+
+  bool sorted() const { return sorted_; }
+
+ private:
+  // Accounts for a non-string value. Only the fields after the phrase and the
+  // description of an item may be something other than strings.
+  bool field() {
+    if (!inItem_ || depth_ != 3) {
+      return true;
+    }
+    return itemFields_++ >= 2;
+  }
+
+  void endItem() {
+    auto& keyOffsets = arenas_.keyOffsets;
+    auto& descriptionOffsets = arenas_.descriptionOffsets;
+    if (itemFields_ < 2) {
+      // Drop the phrase of an incomplete item.
+      arenas_.keys.resize(keyOffsets.back());
+      return;
+    }
+
+    size_t count = keyOffsets.size() - 1;
+    keyOffsets.push_back(static_cast<uint32_t>(arenas_.keys.size()));
+    if (glosses_) {
+      arenas_.glossIds.push_back(glossId_);
+    } else {
+      descriptionOffsets.push_back(
+          static_cast<uint32_t>(arenas_.descriptions.size()));
+    }
+    if (count > 0 && sorted_) {
+      const char* keys = arenas_.keys.data();
+      std::string_view previous(keys + keyOffsets[count - 1],
+                                keyOffsets[count] - keyOffsets[count - 1]);
+      std::string_view current(keys + keyOffsets[count],
+                               keyOffsets[count + 1] - keyOffsets[count]);
+      sorted_ = !(current < previous);
+    }
+  }
+
+  std::string& name_;
+  Arenas& arenas_;
+  GlossDictionary* glosses_;
+  uint32_t glossId_ = 0;
+  std::string rootKey_;
+  int depth_ = 0;
+  bool inData_ = false;
+  bool inItem_ = false;
+  size_t itemFields_ = 0;
+  bool sorted_ = true;
+};
+
+namespace {
+
+// Tables smaller than this are sorted on the calling thread.
+constexpr size_t kParallelSortChunk = 16384;
+
+// Sorts large tables on several threads. Chunks are sorted side by side and
+// then merged pairwise, and both steps are stable.
+template <typename Less>
+void parallelStableSort(std::vector<size_t>& order, Less less) {
+  size_t chunks = std::min<size_t>(std::thread::hardware_concurrency(),
+                                   order.size() / kParallelSortChunk);
+  if (chunks < 2) {
+    std::stable_sort(order.begin(), order.end(), less);
+    return;
+  }
+
+  std::vector<size_t> bounds;
+  for (size_t i = 0; i <= chunks; ++i) {
+    bounds.push_back(order.size() * i / chunks);
+  }
+  auto at = [&](size_t bound) {
+    return order.begin() + static_cast<std::ptrdiff_t>(bounds[bound]);
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < chunks; ++i) {
+    threads.emplace_back(
+        [&, i]() { std::stable_sort(at(i), at(i + 1), less); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t width = 1; width < chunks; width *= 2) {
+    threads.clear();
+    for (size_t i = 0; i + width < chunks; i += 2 * width) {
+      threads.emplace_back([&, i, width]() {
+        std::inplace_merge(at(i), at(i + width),
+                           at(std::min(i + 2 * width, chunks)), less);
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+}
+
+}  // namespace
+
+// Rebuilds the arenas of an unsorted table in phrase order. Entries with
+// equal phrases keep their order.
+InputTable::Arenas InputTable::sortArenas(const Arenas& arenas) {
+  auto view = [](const std::vector<char>& blob,
+                 const std::vector<uint32_t>& offsets, size_t index) {
+    return std::string_view(blob.data() + offsets[index],
+                            offsets[index + 1] - offsets[index]);
+  };
+
+  bool interned = !arenas.glossIds.empty();
+  std::vector<size_t> order(arenas.keyOffsets.size() - 1);
+  std::iota(order.begin(), order.end(), 0);
+  parallelStableSort(order, [&](size_t a, size_t b) {
+    return view(arenas.keys, arenas.keyOffsets, a) <
+           view(arenas.keys, arenas.keyOffsets, b);
+  });
+
+  Arenas sorted;
+  sorted.keys.reserve(arenas.keys.size());
+  sorted.descriptions.reserve(arenas.descriptions.size());
+  for (size_t index : order) {
+    auto key = view(arenas.keys, arenas.keyOffsets, index);
+    sorted.keys.insert(sorted.keys.end(), key.begin(), key.end());
+    sorted.keyOffsets.push_back(static_cast<uint32_t>(sorted.keys.size()));
+    if (interned) {
+      sorted.glossIds.push_back(arenas.glossIds[index]);
+      continue;
+    }
+    auto description =
+        view(arenas.descriptions, arenas.descriptionOffsets, index);
+    sorted.descriptions.insert(sorted.descriptions.end(), description.begin(),
+                               description.end());
+    sorted.descriptionOffsets.push_back(
+        static_cast<uint32_t>(sorted.descriptions.size()));
+  }
+  return sorted;
+}
+
+bool InputTable::load(const std::string& path,
+                      std::shared_ptr<GlossDictionary> glosses) {
+  auto extension = std::filesystem::path(path).extension();
+  if (extension == TableFormat::kFileExtension ||
+      extension == TableFormat::kArchiveExtension) {
+    return loadCompiled(path);
+  }
+  return loadJson(path, std::move(glosses));
+}
+
+bool InputTable::loadJson(const std::string& path,
+                          std::shared_ptr<GlossDictionary> glosses) {
+  // The file is mapped rather than read so that the parser works straight
+  // from the page cache.
+  auto file = MappedFile::open(path);
+  if (!file) {
     FCITX_INFO() << "Failed to open file: " << path;
     return false;
   }
 
+  std::string name;
+  Arenas arenas;
+  // The phrases and descriptions are a little smaller than the file.
+  arenas.keys.reserve(file->size() / 4);
+  if (!glosses) {
+    arenas.descriptions.reserve(file->size() / 2);
+  }
+  JsonHandler handler(name, arenas, glosses.get());
   try {
-    json j;
-    f >> j;
+    if (!json::sax_parse(file->data(), file->data() + file->size(),
+                         &handler)) {
+      FCITX_INFO() << "Failed to parse " << path;
+      return false;
+    }
+  } catch (...) {
+    FCITX_INFO() << "Exception while loading " << path;
+    return false;
+  }
+
+  if (!handler.sorted()) {
+    FCITX_WARN() << path << " is not sorted by phrase, sorting it";
+    arenas = sortArenas(arenas);
+  }
+  arenas.keys.shrink_to_fit();
+  arenas.descriptions.shrink_to_fit();
+
+  name_ = std::move(name);
+  glosses_ = std::move(glosses);
+  adopt(std::move(arenas));
+  FCITX_INFO() << "Loaded " << size_ << " entries from " << path;
+  return true;
+}
 
-    name_ = j.value("name", "");
-    entries_.clear();
+bool InputTable::loadCompiled(const std::string& path) {
+  auto file = MappedFile::open(path);
+  if (!file) {
+    FCITX_INFO() << "Failed to map file: " << path;
+    return false;
+  }
+  if (!TableFormat::validate(file->data(), file->size())) {
+    FCITX_INFO() << "Invalid compiled table: " << path;
+    return false;
+  }
+  const char* data = file->data();
+  size_t size = file->size();
+  adoptCompiled(data, size, std::move(file));
+  FCITX_INFO() << "Mapped " << size_ << " entries from " << path;
+  return true;
+}
 
-    if (j.contains("data") && j["data"].is_array()) {
-      for (const auto& item : j["data"]) {
-        if (item.is_array() && item.size() >= 2) {
-          entries_.push_back(
-              {item[0].get<std::string>(), item[1].get<std::string>()});
+bool InputTable::loadBuiltin(const char* data, size_t size) {
+  if (!TableFormat::validate(data, size)) {
+    FCITX_INFO() << "Invalid built-in table";
+    return false;
+  }
+  adoptCompiled(data, size, nullptr);
+  return true;
+}
+
+void InputTable::adoptCompiled(const char* data, size_t size,
+                               std::unique_ptr<MappedFile> file) {
+  const auto* header = reinterpret_cast<const TableFormat::Header*>(data);
+  name_.assign(data + header->nameOffset, header->nameSize);
+  arenas_ = Arenas();
+  frontCodedKeys_.reset();
+  resetView();
+  dialects_ = TableFormat::readDialects(header);
+  if (const auto* archive = TableFormat::archiveHeaderOf(header)) {
+    dialectMasks_ =
+        reinterpret_cast<const uint32_t*>(data + archive->dialectMasksOffset);
+  }
+  mappedFile_ = std::move(file);
+  compiled_ = data;
+  compiledSize_ = size;
+  discardedBytes_ = 0;
+  size_ = header->entryCount;
+  keys_ = data + header->keyBlobOffset;
+  keyOffsets_ =
+      reinterpret_cast<const uint32_t*>(data + header->keyOffsetsOffset);
+  descriptions_ = data + header->descriptionBlobOffset;
+  descriptionOffsets_ = reinterpret_cast<const uint32_t*>(
+      data + header->descriptionOffsetsOffset);
+  // The descriptions are read from the mapping rather than interned, which
+  // would hash every one of them on each load.
+  glosses_.reset();
+  glossIds_ = nullptr;
+  buildGroups();
+}
+
+void InputTable::discardCompiled(size_t offset, size_t size) {
+  // Built-in tables live in the library and are left alone.
+  if (mappedFile_) {
+    mappedFile_->discard(offset, size);
+    discardedBytes_ += size;
+  }
+}
+
+void InputTable::assign(std::string name, const std::vector<Entry>& entries) {
+  Arenas arenas;
+  bool sorted = true;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    const auto& entry = entries[i];
+    arenas.keys.insert(arenas.keys.end(), entry.phrase.begin(),
+                       entry.phrase.end());
+    arenas.keyOffsets.push_back(static_cast<uint32_t>(arenas.keys.size()));
+    arenas.descriptions.insert(arenas.descriptions.end(),
+                               entry.description.begin(),
+                               entry.description.end());
+    arenas.descriptionOffsets.push_back(
+        static_cast<uint32_t>(arenas.descriptions.size()));
+    sorted = sorted && (i == 0 || !(entry.phrase < entries[i - 1].phrase));
+  }
+  if (!sorted) {
+    arenas = sortArenas(arenas);
+  }
+
+  name_ = std::move(name);
+  glosses_.reset();
+  adopt(std::move(arenas));
+}
+
+void InputTable::adopt(Arenas arenas) {
+  mappedFile_.reset();
+  frontCodedKeys_.reset();
+  resetView();
+  dialects_.clear();
+  compiled_ = nullptr;
+  compiledSize_ = 0;
+  discardedBytes_ = 0;
+  arenas_ = std::move(arenas);
+  size_ = arenas_.keyOffsets.size() - 1;
+  keys_ = arenas_.keys.data();
+  keyOffsets_ = arenas_.keyOffsets.data();
+  descriptions_ = arenas_.descriptions.data();
+  descriptionOffsets_ = arenas_.descriptionOffsets.data();
+  glossIds_ = arenas_.glossIds.data();
+  buildGroups();
+}
+
+void InputTable::resetView() {
+  dialectMasks_ = nullptr;
+  archive_.reset();
+  viewEntries_ = std::vector<uint32_t>();
+  entries_ = nullptr;
+  members_.clear();
+}
+
+std::shared_ptr<InputTable> InputTable::dialectView(
+    std::shared_ptr<const InputTable> archive, size_t dialect) {
+  if (!archive || dialect >= archive->dialects_.size() ||
+      archive->frontCodedKeys_) {
+    return nullptr;
+  }
+
+  auto view = std::make_shared<InputTable>();
+  view->name_ = archive->dialects_[dialect].name;
+  uint32_t bit = 1u << dialect;
+  for (size_t i = 0; i < archive->size_; ++i) {
+    if (archive->dialectMasks_[i] & bit) {
+      view->viewEntries_.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  view->viewEntries_.shrink_to_fit();
+  view->entries_ = view->viewEntries_.data();
+  view->size_ = view->viewEntries_.size();
+  view->keys_ = archive->keys_;
+  view->keyOffsets_ = archive->keyOffsets_;
+  view->descriptions_ = archive->descriptions_;
+  view->descriptionOffsets_ = archive->descriptionOffsets_;
+  view->glossIds_ = archive->glossIds_;
+  view->glosses_ = archive->glosses_;
+  view->archive_ = std::move(archive);
+  view->buildGroups();
+  return view;
+}
+
+std::shared_ptr<InputTable> InputTable::unionOf(std::string name,
+                                                std::vector<Member> members) {
+  auto table = std::make_shared<InputTable>();
+  table->name_ = std::move(name);
+  table->members_ = std::move(members);
+  table->buildGroups();
+  return table;
+}
+
+void InputTable::buildGroups() {
+  // The fold classes are found by searching the new keys, which the
+  // indexes of a previous load do not cover.
+  prefixTrie_ = PrefixTrie();
+  eytzingerIndex_ = EytzingerIndex();
+  groupStarts_.clear();
+  foldClasses_.clear();
+  infixIndex_ = SuffixArray();
+  infixGroups_.clear();
+  std::vector<size_t> casedGroups;
+  for (size_t i = 0; i < size_; ++i) {
+    auto phrase = keyAt(i);
+    if (i > 0 && phrase == keyAt(i - 1)) {
+      continue;
+    }
+    if (KeyScan::hasUpper(phrase)) {
+      casedGroups.push_back(groupStarts_.size());
+    }
+    groupStarts_.push_back(static_cast<uint32_t>(i));
+  }
+  groupStarts_.push_back(static_cast<uint32_t>(size_));
+  groupStarts_.shrink_to_fit();
+  buildGroupIndex();
+  glossIndex_ = std::make_unique<LazyGlossIndex>();
+
+  // Every case variant of a phrase lowers to the same phrase, so a fold class
+  // with more than one member has a member with an upper case letter.
+  std::map<std::string, std::vector<uint32_t>> variants;
+  for (size_t group : casedGroups) {
+    std::string lowered(keyAt(groupStarts_[group]));
+    KeyScan::toLower(lowered);
+    variants[lowered].push_back(static_cast<uint32_t>(group));
+  }
+  for (auto& [lowered, groups] : variants) {
+    auto [first, last] = searchEqualRange(lowered);
+    if (first != last) {
+      groups.push_back(static_cast<uint32_t>(groupOf(first)));
+    }
+    if (groups.size() < 2) {
+      continue;
+    }
+    if (foldClasses_.empty()) {
+      foldClasses_.assign(groupStarts_.size() - 1, kNoFoldClass);
+    }
+    uint32_t foldClass = *std::min_element(groups.begin(), groups.end());
+    for (uint32_t group : groups) {
+      foldClasses_[group] = foldClass;
+    }
+  }
+
+  // Tables are loaded off the input thread, so the first keystroke finds
+  // the index ready.
+  buildSearchIndex();
+}
+
+void InputTable::setSearchLayout(SearchLayout layout) {
+  if (layout == searchLayout_) {
+    return;
+  }
+  searchLayout_ = layout;
+  buildSearchIndex();
+}
+
+void InputTable::buildSearchIndex() {
+  prefixTrie_ = PrefixTrie();
+  eytzingerIndex_ = EytzingerIndex();
+  // Completion searches the dialect views of an archive, which build their
+  // own index, and never the whole family.
+  if (frontCodedKeys_ || !dialects_.empty()) {
+    return;
+  }
+  auto keyAt = [this](size_t index) { return this->keyAt(index); };
+  if (searchLayout_ == SearchLayout::kEytzinger) {
+    eytzingerIndex_.build(size_, keyAt);
+    return;
+  }
+  prefixTrie_.build(size_, keyAt);
+  rankPhrases();
+}
+
+void InputTable::rankPhrases() {
+  // The last node that listed each fold class, counted from 1.
+  std::vector<uint32_t> listedBy(foldClasses_.size(), 0);
+  uint32_t node = 0;
+  // The best phrases so far, by length and then by entry.
+  std::vector<std::pair<size_t, uint32_t>> ranked;
+  prefixTrie_.attachLists([&](size_t first, size_t last,
+                              std::vector<uint32_t>& list) {
+    ++node;
+    ranked.clear();
+    visitGroups(first, last, [&](std::string_view phrase, size_t begin,
+                                 size_t, uint32_t foldClass) {
+      if (foldClass != kNoFoldClass) {
+        if (listedBy[foldClass] == node) {
+          return;
         }
+        listedBy[foldClass] = node;
+      }
+      std::pair<size_t, uint32_t> item(phrase.size(),
+                                       static_cast<uint32_t>(begin));
+      if (ranked.size() == kRankedCount && !(item < ranked.back())) {
+        return;
       }
+      ranked.insert(std::upper_bound(ranked.begin(), ranked.end(), item),
+                    item);
+      if (ranked.size() > kRankedCount) {
+        ranked.pop_back();
+      }
+    });
+    for (const auto& [length, entry] : ranked) {
+      list.push_back(entry);
     }
-    FCITX_INFO() << "Loaded " << entries_.size() << " entries from " << path;
-  } catch (...) {
-    FCITX_INFO() << "Exception while loading " << path;
+  });
+}
+
+void InputTable::buildInfixIndex() {
+  infixGroups_.clear();
+  std::vector<std::pair<size_t, uint32_t>> ranked;
+  visitGroups(0, size_, [&](std::string_view phrase, size_t, size_t,
+                            uint32_t) {
+    ranked.emplace_back(phrase.size(), static_cast<uint32_t>(ranked.size()));
+  });
+  std::sort(ranked.begin(), ranked.end());
+  infixGroups_.reserve(ranked.size());
+  for (const auto& [length, group] : ranked) {
+    infixGroups_.push_back(group);
+  }
+
+  std::string buffer;
+  infixIndex_.build(infixGroups_.size(), [&](size_t rank) {
+    return phraseAt(groupStarts_[infixGroups_[rank]], buffer);
+  });
+}
+
+std::vector<uint32_t> InputTable::infixEntries(std::string_view infix,
+                                               size_t count) const {
+  std::vector<uint32_t> entries;
+  if (infix.empty() || count == 0) {
+    return entries;
+  }
+  if (!infixIndex_.empty()) {
+    for (uint32_t rank : infixIndex_.find(infix, count)) {
+      entries.push_back(groupStarts_[infixGroups_[rank]]);
+    }
+    return entries;
+  }
+
+  std::vector<std::pair<size_t, uint32_t>> found;
+  visitGroups(0, size_, [&](std::string_view phrase, size_t begin, size_t,
+                            uint32_t) {
+    if (phrase.find(infix) != std::string_view::npos) {
+      found.emplace_back(phrase.size(), static_cast<uint32_t>(begin));
+    }
+  });
+  size_t size = std::min(count, found.size());
+  std::partial_sort(found.begin(), found.begin() + size, found.end());
+  for (size_t i = 0; i < size; ++i) {
+    entries.push_back(found[i].second);
+  }
+  return entries;
+}
+
+bool InputTable::rankedEntries(std::string_view prefix,
+                               std::span<const uint32_t>& entries) const {
+  if (prefixTrie_.empty()) {
+    return false;
+  }
+  auto match = prefixTrie_.find(prefix);
+  if (match.depth != prefix.size()) {
     return false;
   }
+  entries = prefixTrie_.listAt(match.node);
+  return !entries.empty();
+}
+
+size_t InputTable::groupOf(size_t index) const {
+  auto next = std::upper_bound(groupStarts_.begin(), groupStarts_.end() - 1,
+                               static_cast<uint32_t>(index));
+  return static_cast<size_t>(next - groupStarts_.begin()) - 1;
+}
+
+void InputTable::buildGroupIndex() {
+  groupIndex_ = PerfectHash();
+  // Tables are loaded off the input thread, so the hash is built here rather
+  // than on the first exact lookup. An archive is only looked up through its
+  // dialect views, which hash their own groups.
+  if (!dialects_.empty()) {
+    return;
+  }
+  std::vector<uint64_t> hashes;
+  hashes.reserve(groupStarts_.size() - 1);
+  for (size_t group = 0; group + 1 < groupStarts_.size(); ++group) {
+    hashes.push_back(PerfectHash::hash(keyAt(groupStarts_[group])));
+  }
+  if (!groupIndex_.build(hashes) && !hashes.empty()) {
+    FCITX_INFO() << "Failed to hash the phrases of " << name_
+                 << ", exact lookups will search them";
+  }
+}
+
+bool InputTable::fuzzyEntries(const LevenshteinAutomaton& automaton,
+                              std::chrono::steady_clock::time_point deadline,
+                              std::vector<FuzzyMatch>& matches) const {
+  // The state after each character of the current phrase, valid up to
+  // depth `valid`, and the least distance of the phrase up to each depth.
+  size_t width = automaton.stateSize();
+  std::vector<uint8_t> states(width);
+  std::vector<uint32_t> distances(1);
+  automaton.start(states.data());
+  distances[0] = automaton.distance(states.data());
+  size_t valid = 0;
+  // The characters of the previous phrase and of the current one, and where
+  // the current ones end.
+  std::vector<uint32_t> previous;
+  std::vector<uint32_t> characters;
+  std::vector<size_t> ends;
+  std::string decoded;
+
+  size_t walked = 0;
+  for (size_t index = 0; index < size_;) {
+    // The clock is read once in a while, which costs less than a phrase.
+    if (++walked % 64 == 0 && std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::string_view phrase = phraseAt(index, decoded);
+    characters.clear();
+    ends.clear();
+    for (size_t pos = 0; pos < phrase.size();) {
+      characters.push_back(Utf8::nextCharacter(phrase, pos));
+      ends.push_back(pos);
+    }
+
+    // The states of the characters shared with the previous phrase are kept.
+    size_t depth = 0;
+    while (depth < valid && depth < characters.size() &&
+           characters[depth] == previous[depth]) {
+      ++depth;
+    }
+    states.resize(width * (characters.size() + 1));
+    distances.resize(characters.size() + 1);
+    bool pruned = false;
+    for (; depth < characters.size(); ++depth) {
+      const uint8_t* state = &states[width * depth];
+      uint8_t* next = &states[width * (depth + 1)];
+      bool alive = automaton.step(state, characters[depth], next);
+      distances[depth + 1] =
+          std::min(distances[depth], automaton.distance(next));
+      if (!alive) {
+        ++depth;
+        pruned = true;
+        break;
+      }
+    }
+    valid = depth;
+    previous.swap(characters);
+
+    // Every phrase that starts with the characters read has the distance
+    // of this one, so the automaton is done with all of them.
+    size_t last = groupEnd(index);
+    if (pruned) {
+      auto range = prefixRange(phrase.substr(0, ends[depth - 1]));
+      last = std::max(last, range.second);
+    }
+    if (distances[depth] <= automaton.maxDistance()) {
+      for (size_t entry = index; entry < last; entry = groupEnd(entry)) {
+        matches.push_back({static_cast<uint32_t>(entry), distances[depth]});
+      }
+    }
+    index = last;
+  }
   return true;
 }
 
-std::vector<InputTable::Entry> InputTable::getCandidates(
-    const std::string& key) const {
-  std::vector<InputTable::Entry> results;
+const GlossIndex& InputTable::glossIndex() const {
+  std::call_once(glossIndex_->built, [this]() {
+    glossIndex_->index.build(
+        size_, [this](size_t index) { return descriptionAt(index); });
+  });
+  return glossIndex_->index;
+}
 
-  // Binary search for the first element that is not less than key
-  auto it = std::lower_bound(
-      entries_.begin(), entries_.end(), key,
-      [](const Entry& e, const std::string& k) { return e.phrase < k; });
+std::vector<uint32_t> InputTable::glossEntries(std::string_view text) const {
+  std::vector<uint32_t> entries;
+  if (text.empty()) {
+    return entries;
+  }
+  // The index finds the entries with every bigram of the text, which
+  // usually, but not always, have the text itself.
+  for (uint32_t index : glossIndex().find(text)) {
+    if (descriptionAt(index).find(text) != std::string_view::npos) {
+      entries.push_back(index);
+    }
+  }
+  return entries;
+}
 
-  // Iterate while keys match
-  while (it != entries_.end() && it->phrase == key) {
-    results.push_back(*it);
-    ++it;
+size_t InputTable::memoryUsage() const {
+  size_t bytes = name_.capacity() + arenas_.keys.capacity() +
+                 arenas_.descriptions.capacity() +
+                 sizeof(uint32_t) * (arenas_.keyOffsets.capacity() +
+                                     arenas_.descriptionOffsets.capacity() +
+                                     arenas_.glossIds.capacity() +
+                                     groupStarts_.capacity() +
+                                     foldClasses_.capacity() +
+                                     viewEntries_.capacity());
+  bytes += groupIndex_.memoryUsage();
+  if (glossIndex_) {
+    bytes += glossIndex_->index.memoryUsage();
+  }
+  bytes += prefixTrie_.memoryUsage() + eytzingerIndex_.memoryUsage() +
+           infixIndex_.memoryUsage() +
+           sizeof(uint32_t) * infixGroups_.capacity();
+  bytes += compiledSize_ - discardedBytes_;
+  if (frontCodedKeys_) {
+    bytes += frontCodedKeys_->memoryUsage();
   }
+  for (const auto& member : members_) {
+    bytes += member.label.capacity() + member.table->memoryUsage();
+  }
+  return bytes;
+}
 
-  return results;
+void InputTable::compressKeys() {
+  if (frontCodedKeys_) {
+    return;
+  }
+  FrontCodedKeys keys;
+  for (size_t i = 0; i < size_; ++i) {
+    keys.append(keyAt(i));
+  }
+  keys.shrinkToFit();
+
+  if (compiled_) {
+    const auto* header =
+        reinterpret_cast<const TableFormat::Header*>(compiled_);
+    discardCompiled(header->keyOffsetsOffset, sizeof(uint32_t) * (size_ + 1));
+    discardCompiled(header->keyBlobOffset, header->keyBlobSize);
+  }
+  arenas_.keys = std::vector<char>();
+  arenas_.keyOffsets = std::vector<uint32_t>();
+  keys_ = nullptr;
+  keyOffsets_ = nullptr;
+  frontCodedKeys_ = std::move(keys);
+  buildSearchIndex();
+}
+
+std::pair<size_t, size_t> InputTable::prefixRange(
+    std::string_view prefix) const {
+  if (frontCodedKeys_) {
+    size_t first = frontCodedKeys_->partitionPoint(
+        [prefix](std::string_view key) { return key < prefix; });
+    size_t last = frontCodedKeys_->partitionPoint(
+        [prefix](std::string_view key) {
+          return key < prefix || key.starts_with(prefix);
+        });
+    return {first, last};
+  }
+
+  size_t left = 0;
+  size_t end = size_;
+  size_t depth = 0;
+  if (!prefixTrie_.empty()) {
+    // The rest of the prefix is below a node that was not expanded, or is
+    // not in the table; either way the answer is within the node.
+    auto match = prefixTrie_.find(prefix);
+    std::tie(left, end, depth) = std::tie(match.first, match.last, match.depth);
+  } else if (!eytzingerIndex_.empty()) {
+    auto match = eytzingerIndex_.find(prefix);
+    std::tie(left, end, depth) = std::tie(match.first, match.last, match.depth);
+  }
+  if (depth == prefix.size()) {
+    return {left, end};
+  }
+
+  size_t right = end;
+  while (left < right) {
+    size_t mid = left + (right - left) / 2;
+    if (keyAt(mid) < prefix) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+
+  size_t first = left;
+  right = end;
+  while (left < right) {
+    size_t mid = left + (right - left) / 2;
+    if (keyAt(mid).starts_with(prefix)) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return {first, left};
+}
+
+std::pair<size_t, size_t> InputTable::equalRange(std::string_view key) const {
+  if (groupIndex_.empty()) {
+    return searchEqualRange(key);
+  }
+  size_t group = groupIndex_.find(PerfectHash::hash(key));
+  size_t first = groupStarts_[group];
+  bool found = frontCodedKeys_ ? frontCodedKeys_->at(first) == key
+                               : keyAt(first) == key;
+  if (!found) {
+    return {0, 0};
+  }
+  return {first, groupStarts_[group + 1]};
+}
+
+std::pair<size_t, size_t> InputTable::searchEqualRange(
+    std::string_view key) const {
+  if (frontCodedKeys_) {
+    return {frontCodedKeys_->partitionPoint(
+                [key](std::string_view phrase) { return phrase < key; }),
+            frontCodedKeys_->partitionPoint(
+                [key](std::string_view phrase) { return phrase <= key; })};
+  }
+
+  auto [first, last] = prefixRange(key);
+  // Within the prefix range the exact matches come first.
+  size_t end = first;
+  while (end < last && keyAt(end).size() == key.size()) {
+    ++end;
+  }
+  return {first, end};
 }
 
 }  // namespace McFoxIM
@@ -24,26 +24,462 @@
 #ifndef INPUTTABLE_H_
 #define INPUTTABLE_H_
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "eytzingerindex.h"
+#include "frontcodedkeys.h"
+#include "glossdictionary.h"
+#include "glossindex.h"
+#include "levenshteinautomaton.h"
+#include "mappedfile.h"
+#include "perfecthash.h"
+#include "prefixtrie.h"
+#include "suffixarray.h"
+#include "tableformat.h"
+
 namespace McFoxIM {
 
+/**
+ * An input table: phrases sorted in byte order, each with a description.
+ *
+ * Entries are stored as two arenas, one holding every phrase back to back
+ * and one holding every description, plus uint32_t offset arrays into them.
+ * Searches only touch the phrase arena and its offsets; descriptions are read
+ * only for the entries that are displayed. JSON tables own their arenas,
+ * while compiled tables point them into the mapped file.
+ *
+ * JSON tables loaded with a GlossDictionary keep a gloss id per entry in place
+ * of the description arena, and share the descriptions with each other.
+ * Compiled tables read their descriptions from the mapping, which costs
+ * nothing until they are displayed, so they are never interned.
+ *
+ * Prefix searches follow a trie of the phrases (see PrefixTrie), built when
+ * the table is loaded, or a packed search array (see EytzingerIndex) if the
+ * table is set to use one. The phrases can instead be compressed with front
+ * coding (see FrontCodedKeys), trading a block decode per search for a
+ * smaller phrase arena.
+ *
+ * An archive of several dialects (see TableFormat) loads as a table of all
+ * their entries. dialectView() selects one dialect as a table that indexes
+ * into the archive's storage instead of copying it.
+ *
+ * unionOf() makes a table that stands for several tables at once, such as
+ * the dialects of a language, without copying them.
+ *
+ * Entries with equal phrases are grouped when the table is loaded, and groups
+ * whose phrases differ only in ASCII case share a fold class, so that
+ * completion can merge them without comparing phrases. A perfect hash of the
+ * distinct phrases, built along with the groups, answers exact lookups
+ * without a search. The trie also keeps the first phrases that completion
+ * shows for the prefixes of many phrases (see rankedEntries()).
+ *
+ * Phrases that contain a string anywhere are found with a suffix array of
+ * the phrases (see infixEntries()), built only on request. Entries whose
+ * description contains a string are found with an index of the descriptions
+ * (see glossEntries()), built on the first such search. Phrases that
+ * start with a near miss of a string are found by walking the sorted phrases
+ * with a Levenshtein automaton (see fuzzyEntries()).
+ */
 class InputTable {
  public:
+  /** The fold class of a phrase that has no case variants in the table. */
+  static constexpr uint32_t kNoFoldClass = UINT32_MAX;
+  /** The index behind prefix searches of phrases that are not compressed. */
+  enum class SearchLayout {
+    // A trie, which also keeps the ranked lists of rankedEntries().
+    kTrie,
+    // An array of packed phrases in Eytzinger order, which is smaller.
+    kEytzinger,
+  };
+
+  /** The most phrases rankedEntries() finds, a page of candidates. */
+  static constexpr size_t kRankedCount = 9;
+
   struct Entry {
     std::string phrase;
     std::string description;
   };
 
-  bool load(const std::string& path);
-  std::vector<Entry> getCandidates(const std::string& key) const;
+  /** A phrase found by fuzzyEntries(): its first entry, and how near it is. */
+  struct FuzzyMatch {
+    uint32_t entry;
+    uint32_t distance;
+  };
+
+  /** A table in a union, and the label that marks its descriptions. */
+  struct Member {
+    std::string label;
+    std::shared_ptr<const InputTable> table;
+  };
+
+  InputTable() = default;
+  InputTable(InputTable&&) = default;
+  InputTable& operator=(InputTable&&) = default;
+
+  /**
+   * Loads a table. Paths ending with TableFormat::kFileExtension or
+   * TableFormat::kArchiveExtension are memory-mapped as compiled tables,
+   * anything else is parsed as JSON.
+   *
+   * @param path The path of the table file.
+   * @param glosses The dictionary to intern the descriptions of a JSON table
+   * in, or nullptr to keep them in the table. Compiled tables ignore it.
+   * @returns true on success.
+   */
+  bool load(const std::string& path,
+            std::shared_ptr<GlossDictionary> glosses = nullptr);
+
+  /**
+   * Uses a compiled table that stays in memory for the lifetime of the
+   * program, such as one of the BuiltinTables. Nothing is copied.
+   *
+   * @param data The bytes of the compiled table, aligned to 4 bytes.
+   * @param size The number of bytes.
+   * @returns true on success.
+   */
+  bool loadBuiltin(const char* data, size_t size);
+  /**
+   * Makes a table of the given entries. Entries with equal phrases keep
+   * their order.
+   *
+   * @param name The name of the table.
+   * @param entries The entries, in any order.
+   */
+  void assign(std::string name, const std::vector<Entry>& entries);
+
   const std::string& name() const { return name_; }
-  const std::vector<Entry>& entries() const { return entries_; }
+
+  /**
+   * The bytes held by the table, including mapped file pages and the
+   * members of a union, but not the shared gloss dictionary or, for a dialect
+   * view, the archive.
+   */
+  size_t memoryUsage() const;
+
+  /**
+   * Makes a table of the entries of one dialect of an archive. The view
+   * keeps the archive alive and shares its storage, so it only holds the
+   * indices of its entries.
+   *
+   * @param archive A loaded archive whose keys are not compressed.
+   * @param dialect The index of the dialect in the archive.
+   * @returns The view, or nullptr if there is no such dialect.
+   */
+  static std::shared_ptr<InputTable> dialectView(
+      std::shared_ptr<const InputTable> archive, size_t dialect);
+
+  /**
+   * Makes a table of the union of other tables. It has no entries of its
+   * own: completion merges the entries of the members in sorted order, and
+   * marks each description with the label of its member.
+   *
+   * @param name The name of the union.
+   * @param members The tables, in the order their descriptions are listed.
+   */
+  static std::shared_ptr<InputTable> unionOf(std::string name,
+                                             std::vector<Member> members);
+
+  /** The members of a union, empty for any other table. */
+  const std::vector<Member>& members() const { return members_; }
+
+  /** The dialects of an archive, empty for any other table. */
+  const std::vector<TableFormat::Dialect>& dialects() const {
+    return dialects_;
+  }
+
+  /** The dialects of an archive that have the given entry, bit d for d. */
+  uint32_t dialectMaskAt(size_t index) const { return dialectMasks_[index]; }
+
+  /**
+   * Replaces the phrase arena with front-coded blocks. Lookups then decode
+   * the blocks they touch.
+   */
+  void compressKeys();
+  bool hasCompressedKeys() const { return frontCodedKeys_.has_value(); }
+
+  /**
+   * Rebuilds the prefix search index in the given layout. Tables are loaded
+   * with a trie, and keep the layout when they are loaded again.
+   */
+  void setSearchLayout(SearchLayout layout);
+  SearchLayout searchLayout() const { return searchLayout_; }
+
+  /** The number of entries, sorted by phrase. */
+  size_t size() const { return size_; }
+
+  /**
+   * The phrase of an entry. Uncompressed phrases are viewed where they are
+   * stored; compressed ones are decoded into buffer, which the view then
+   * points into.
+   */
+  std::string_view phraseAt(size_t index, std::string& buffer) const {
+    if (frontCodedKeys_) {
+      frontCodedKeys_->at(index, buffer);
+      return buffer;
+    }
+    return keyAt(index);
+  }
+
+  /** A copy of the phrase of an entry, for callers that keep it. */
+  std::string decodePhraseAt(size_t index) const {
+    std::string buffer;
+    return std::string(phraseAt(index, buffer));
+  }
+
+  /**
+   * Calls visit(index, phrase) for every entry in [first, last) in order.
+   * Compressed phrases are decoded once per block, and the phrase view is
+   * only valid during the call.
+   */
+  template <typename Visitor>
+  void visitPhrases(size_t first, size_t last, Visitor&& visit) const {
+    if (frontCodedKeys_) {
+      frontCodedKeys_->visit(first, last, visit);
+      return;
+    }
+    for (size_t i = first; i < last; ++i) {
+      visit(i, keyAt(i));
+    }
+  }
+
+  std::string_view descriptionAt(size_t index) const {
+    size_t entry = entryAt(index);
+    if (glosses_) {
+      return glosses_->at(glossIds_[entry]);
+    }
+    return {descriptions_ + descriptionOffsets_[entry],
+            descriptionOffsets_[entry + 1] - descriptionOffsets_[entry]};
+  }
+
+  /**
+   * Finds the entries whose phrase starts with the given prefix.
+   *
+   * @returns The half-open range of entry indices.
+   */
+  std::pair<size_t, size_t> prefixRange(std::string_view prefix) const;
+
+  /**
+   * Finds the entries whose phrase equals the given key in constant time.
+   * Nothing is copied: the entries are read with phraseAt() and
+   * descriptionAt(). Safe to call from several threads.
+   *
+   * @returns The half-open range of entry indices, empty if there are none.
+   */
+  std::pair<size_t, size_t> equalRange(std::string_view key) const;
+
+  /**
+   * Finds the first phrases that start with a prefix in the order
+   * completion shows them: shorter phrases first, and phrases of the same
+   * length in order. Of the phrases that differ only in ASCII case, only the
+   * first one is listed. Nothing is searched or sorted.
+   *
+   * @param prefix The prefix.
+   * @param entries Set to the first entry of each phrase, at most
+   * kRankedCount of them. Fewer mean that these are all the phrases.
+   * @returns false if the table keeps no list for the prefix, which is the
+   * case for prefixes of few phrases; prefixRange() finds those.
+   */
+  bool rankedEntries(std::string_view prefix,
+                     std::span<const uint32_t>& entries) const;
+
+  /**
+   * Builds the index of infixEntries(). Tables are loaded without it, since
+   * it takes a while to build and about as much memory as the phrases again;
+   * the build is not safe while other threads read the table, so it belongs
+   * where the table is loaded.
+   */
+  void buildInfixIndex();
+  bool hasInfixIndex() const { return !infixIndex_.empty(); }
+
+  /**
+   * Finds the phrases that contain an infix, in the order completion shows
+   * them: shorter phrases first, and phrases of the same length in order.
+   * A table without the index searches every phrase.
+   *
+   * @param infix The infix.
+   * @param count The most phrases to find.
+   * @returns The first entry of each phrase.
+   */
+  std::vector<uint32_t> infixEntries(std::string_view infix,
+                                     size_t count) const;
+
+  /**
+   * Finds the entries whose description contains the given text, such as
+   * the words for a Mandarin gloss. The first search indexes the
+   * descriptions (see GlossIndex). Safe to call from several threads.
+   *
+   * @returns The indices of the entries in order.
+   */
+  std::vector<uint32_t> glossEntries(std::string_view text) const;
+
+  /**
+   * Finds the phrases that start with a string the automaton accepts,
+   * walking the phrases in order and skipping every range of phrases that
+   * start with a string it cannot accept.
+   *
+   * @param automaton The automaton of the string the phrases should start
+   * with.
+   * @param deadline When to give up.
+   * @param matches Appended with the first entry of each phrase found, in
+   * order, and the least distance of a start of the phrase.
+   * @returns false if the deadline passed before every phrase was walked,
+   * in which case matches has the phrases found until then.
+   */
+  bool fuzzyEntries(const LevenshteinAutomaton& automaton,
+                    std::chrono::steady_clock::time_point deadline,
+                    std::vector<FuzzyMatch>& matches) const;
+
+  /** The fold class of the phrase of an entry (see visitGroups()). */
+  uint32_t foldClassAt(size_t index) const {
+    return foldClasses_.empty() ? kNoFoldClass : foldClasses_[groupOf(index)];
+  }
+
+  /** The end of the entries with the same phrase as the given entry. */
+  size_t groupEnd(size_t index) const {
+    return groupStarts_[groupOf(index) + 1];
+  }
+
+  /**
+   * Calls visit(phrase, begin, end, foldClass) for every distinct phrase in
+   * the entries [first, last), in order, where [begin, end) are the entries
+   * with that phrase within the range. Phrases that differ only in ASCII case
+   * have the same fold class; a phrase without such variants has
+   * kNoFoldClass.
+   */
+  template <typename Visitor>
+  void visitGroups(size_t first, size_t last, Visitor&& visit) const {
+    if (first >= last) {
+      return;
+    }
+    size_t group = groupOf(first);
+    visitPhrases(first, last, [&](size_t index, std::string_view phrase) {
+      if (index != first) {
+        if (index < groupStarts_[group + 1]) {
+          return;
+        }
+        ++group;
+      }
+      visit(phrase, index, std::min<size_t>(groupStarts_[group + 1], last),
+            foldClasses_.empty() ? kNoFoldClass : foldClasses_[group]);
+    });
+  }
 
  private:
+  class JsonHandler;
+
+  struct Arenas {
+    std::vector<char> keys;
+    std::vector<char> descriptions;
+    std::vector<uint32_t> keyOffsets{0};
+    std::vector<uint32_t> descriptionOffsets{0};
+    // Replaces the descriptions when they are interned.
+    std::vector<uint32_t> glossIds;
+  };
+
+  // The entry of the storage behind an index, which differs in views.
+  size_t entryAt(size_t index) const {
+    return entries_ ? entries_[index] : index;
+  }
+
+  std::string_view keyAt(size_t index) const {
+    size_t entry = entryAt(index);
+    return {keys_ + keyOffsets_[entry],
+            keyOffsets_[entry + 1] - keyOffsets_[entry]};
+  }
+
+  bool loadJson(const std::string& path,
+                std::shared_ptr<GlossDictionary> glosses);
+  bool loadCompiled(const std::string& path);
+  void adopt(Arenas arenas);
+  // Points the views into a validated compiled table, owned by file if it
+  // is mapped.
+  void adoptCompiled(const char* data, size_t size,
+                     std::unique_ptr<MappedFile> file);
+  // Drops the pages of a part of the compiled table that is no longer read.
+  void discardCompiled(size_t offset, size_t size);
+  static Arenas sortArenas(const Arenas& arenas);
+  // Groups equal phrases and finds their case variants. Called once the
+  // views are set.
+  void buildGroups();
+  // Builds the perfect hash of the groups.
+  void buildGroupIndex();
+  // Builds the prefix search index of the layout.
+  void buildSearchIndex();
+  // Attaches the lists of rankedEntries() to the trie.
+  void rankPhrases();
+  void resetView();
+  size_t groupOf(size_t index) const;
+  const GlossIndex& glossIndex() const;
+  // Finds the entries whose phrase equals the given key by binary search.
+  std::pair<size_t, size_t> searchEqualRange(std::string_view key) const;
+
   std::string name_;
-  std::vector<Entry> entries_;
+
+  // The views every accessor reads from.
+  size_t size_ = 0;
+  const char* keys_ = nullptr;
+  const uint32_t* keyOffsets_ = nullptr;
+  const char* descriptions_ = nullptr;
+  const uint32_t* descriptionOffsets_ = nullptr;
+  const uint32_t* glossIds_ = nullptr;
+  std::shared_ptr<GlossDictionary> glosses_;
+  // The storage entries of a dialect view, nullptr for other tables.
+  const uint32_t* entries_ = nullptr;
+
+  // Backing storage: owned arenas for JSON tables, a mapping for compiled
+  // tables, nothing for built-in tables.
+  Arenas arenas_;
+  std::unique_ptr<MappedFile> mappedFile_;
+  const char* compiled_ = nullptr;
+  size_t compiledSize_ = 0;
+  // Bytes of the mapping whose pages have been dropped.
+  size_t discardedBytes_ = 0;
+  std::optional<FrontCodedKeys> frontCodedKeys_;
+
+  // Archives.
+  std::vector<TableFormat::Dialect> dialects_;
+  const uint32_t* dialectMasks_ = nullptr;
+  // Dialect views: the archive and the entries of the dialect in it.
+  std::shared_ptr<const InputTable> archive_;
+  std::vector<uint32_t> viewEntries_;
+
+  // Unions.
+  std::vector<Member> members_;
+
+  // The first entry of each distinct phrase, followed by size_.
+  std::vector<uint32_t> groupStarts_;
+  // The fold class of each group, empty if no phrase has case variants.
+  std::vector<uint32_t> foldClasses_;
+  // Resolve prefixes; the one of the layout is built unless the phrases are
+  // front-coded, and the other is empty.
+  SearchLayout searchLayout_ = SearchLayout::kTrie;
+  PrefixTrie prefixTrie_;
+  EytzingerIndex eytzingerIndex_;
+  // Finds infixes, empty unless it was built. Indexes the phrases of the
+  // groups in infixGroups_, which are in the order of infixEntries().
+  SuffixArray infixIndex_;
+  std::vector<uint32_t> infixGroups_;
+  // Maps each distinct phrase to its group. Empty if it could not be built,
+  // in which case lookups search the phrases.
+  PerfectHash groupIndex_;
+  // Maps the bigrams of the descriptions to their entries, built on the
+  // first search of the descriptions.
+  struct LazyGlossIndex {
+    std::once_flag built;
+    GlossIndex index;
+  };
+  std::unique_ptr<LazyGlossIndex> glossIndex_ =
+      std::make_unique<LazyGlossIndex>();
 };
 
 }  // namespace McFoxIM
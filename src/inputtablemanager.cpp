@@ -1,61 +1,479 @@
 #include "inputtablemanager.h"
 
 #include <fcitx-utils/log.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
+#include <algorithm>
 #include <fstream>
-#include <iomanip>
-#include <iostream>
+#include <mutex>
 #include <nlohmann/json.hpp>
-#include <sstream>
+
+#include "builtintables.h"
+#include "indexcache.h"
+#include "mappedfile.h"
+#include "tableformat.h"
+#include "tablemanifest.h"
 
 namespace McFoxIM {
 
+namespace {
+
+// The JSON tables put "name" before "data", so the name is found in the first
+// few hundred bytes and the rest of the file never has to be read.
+constexpr size_t kNameProbeSize = 1024;
+
+std::string readJsonTableName(const std::filesystem::path& path) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f.is_open()) {
+    return "";
+  }
+  std::string head(kNameProbeSize, '\0');
+  f.read(head.data(), static_cast<std::streamsize>(head.size()));
+  head.resize(static_cast<size_t>(f.gcount()));
+
+  size_t key = head.find("\"name\"");
+  if (key == std::string::npos || head.find("\"data\"") < key) {
+    return "";
+  }
+  size_t colon = head.find_first_not_of(" \t\r\n", key + 6);
+  if (colon == std::string::npos || head[colon] != ':') {
+    return "";
+  }
+  size_t open = head.find_first_not_of(" \t\r\n", colon + 1);
+  if (open == std::string::npos || head[open] != '"') {
+    return "";
+  }
+  for (size_t i = open + 1; i < head.size(); ++i) {
+    if (head[i] == '\\') {
+      ++i;
+    } else if (head[i] == '"') {
+      try {
+        return nlohmann::json::parse(head.substr(open, i - open + 1))
+            .get<std::string>();
+      } catch (...) {
+        return "";
+      }
+    }
+  }
+  return "";
+}
+
+void readCompiledTableInfo(InputTableManager::TableInfo& info,
+                           const char* data, size_t size) {
+  const auto* header = TableFormat::validate(data, size);
+  if (!header) {
+    return;
+  }
+  info.name.assign(data + header->nameOffset, header->nameSize);
+  info.entryCount = header->entryCount;
+}
+
+void readCompiledTableInfo(InputTableManager::TableInfo& info) {
+  auto file = MappedFile::open(info.path);
+  if (file) {
+    readCompiledTableInfo(info, file->data(), file->size());
+  }
+}
+
+}  // namespace
+
+// An archive stays loaded while any of its dialects does, so loading a
+// second dialect only filters the entries of the archive.
+class InputTableManager::ArchiveCache {
+ public:
+  std::shared_ptr<const InputTable> load(
+      const std::string& path, std::shared_ptr<GlossDictionary> glosses) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto archive = archives_[path].lock()) {
+      return archive;
+    }
+    auto archive = std::make_shared<InputTable>();
+    if (!archive->load(path, std::move(glosses))) {
+      return nullptr;
+    }
+    archives_[path] = archive;
+    return archive;
+  }
+
+  size_t memoryUsage() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t bytes = 0;
+    for (const auto& [path, weak] : archives_) {
+      if (auto archive = weak.lock()) {
+        bytes += archive->memoryUsage();
+      }
+    }
+    return bytes;
+  }
+
+  // Makes the next load() read the file again.
+  void invalidate(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    archives_.erase(path);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<std::string, std::weak_ptr<const InputTable>> archives_;
+};
+
+namespace {
+
+// Hands the heap pages freed by evicted tables back to the system. Mapped
+// tables are unmapped when their last snapshot goes away.
+void releaseMemory() {
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+}
+
+// Loads a JSON table from its cached index, and caches the index if there
+// is none yet.
+bool loadJsonTable(InputTable& table, const std::string& path,
+                   std::shared_ptr<GlossDictionary> glosses,
+                   const std::string& indexCache) {
+  std::string index = IndexCache::pathFor(indexCache, path);
+  std::error_code ec;
+  if (!index.empty() && std::filesystem::exists(index, ec) &&
+      table.load(index, glosses)) {
+    return true;
+  }
+  if (!table.load(path, std::move(glosses))) {
+    return false;
+  }
+  if (!index.empty() && !IndexCache::store(indexCache, path, table)) {
+    FCITX_INFO() << "Failed to cache the index of " << path;
+  }
+  return true;
+}
+
+// Loads a table the way the manager is configured to keep it, and the tables
+// of a union that are not loaded yet. Safe to call from the worker.
+std::shared_ptr<InputTable> loadTable(
+    const InputTableManager::TableInfo& info,
+    const std::vector<InputTableManager::MemberTable>& members,
+    std::shared_ptr<GlossDictionary> glosses, bool compressKeys,
+    bool infixSearch, InputTableManager::ArchiveCache& archives,
+    const std::string& indexCache) {
+  const auto& path = info.path;
+  std::shared_ptr<InputTable> table;
+  if (!info.members.empty()) {
+    // Dialects of an archive share it with the tables loaded on their own.
+    std::vector<InputTable::Member> tables;
+    for (const auto& member : members) {
+      std::shared_ptr<const InputTable> memberTable = member.table;
+      if (!memberTable) {
+        memberTable = loadTable(member.info, {}, glosses, compressKeys,
+                                infixSearch, archives, indexCache);
+      }
+      if (!memberTable) {
+        FCITX_INFO() << "Failed to load " << member.info.id << " for union "
+                     << info.id;
+        continue;
+      }
+      tables.push_back({member.info.name, std::move(memberTable)});
+    }
+    if (tables.empty()) {
+      return nullptr;
+    }
+    return InputTable::unionOf(info.name, std::move(tables));
+  }
+  if (info.dialect >= 0) {
+    table = InputTable::dialectView(archives.load(path, std::move(glosses)),
+                                    static_cast<size_t>(info.dialect));
+    if (table && infixSearch) {
+      table->buildInfixIndex();
+    }
+    if (table && compressKeys) {
+      table->compressKeys();
+    }
+    return table;
+  }
+
+  table = std::make_shared<InputTable>();
+  std::string_view builtinId(path);
+  if (builtinId.starts_with(BuiltinTables::kPathPrefix)) {
+    builtinId.remove_prefix(BuiltinTables::kPathPrefix.size());
+    const auto* builtin = BuiltinTables::find(builtinId);
+    if (!builtin || !table->loadBuiltin(builtin->data, builtin->size)) {
+      return nullptr;
+    }
+  } else if (!indexCache.empty() &&
+             std::filesystem::path(path).extension() == ".json") {
+    if (!loadJsonTable(*table, path, std::move(glosses), indexCache)) {
+      return nullptr;
+    }
+  } else if (!table->load(path, std::move(glosses))) {
+    return nullptr;
+  }
+  // The index copies the phrases, so it is built before they are
+  // compressed.
+  if (infixSearch) {
+    table->buildInfixIndex();
+  }
+  if (compressKeys) {
+    table->compressKeys();
+  }
+  return table;
+}
+
+}  // namespace
+
 InputTableManager::InputTableManager(std::string dataPath)
-    : dataPath_(std::move(dataPath)) {
+    : InputTableManager(dataPath.empty()
+                            ? std::vector<std::string>()
+                            : std::vector<std::string>{std::move(dataPath)}) {}
+
+InputTableManager::InputTableManager(std::vector<std::string> dataPaths)
+    : dataPaths_(std::move(dataPaths)),
+      archives_(std::make_shared<ArchiveCache>()) {
   scanTables();
   // Ensure currentTable_ is never null
-  currentTable_ = std::make_unique<InputTable>();
+  emptyTable_ = std::make_shared<InputTable>();
+  currentTable_ = emptyTable_;
 }
 
 void InputTableManager::scanTables() {
   availableTables_.clear();
-  if (!std::filesystem::exists(dataPath_) ||
-      !std::filesystem::is_directory(dataPath_)) {
-    FCITX_INFO() << "Data path does not exist or is not a directory: "
-                 << dataPath_;
-    return;
+  for (const auto& dataPath : dataPaths_) {
+    std::filesystem::path dir(dataPath);
+    std::error_code ec;
+    if (!std::filesystem::is_directory(dir, ec)) {
+      FCITX_INFO() << "Data path does not exist or is not a directory: "
+                   << dataPath;
+      continue;
+    }
+    FCITX_INFO() << "Scanning tables in: " << dataPath;
+    std::vector<TableInfo> tables;
+    if (!readManifest(dir, tables)) {
+      FCITX_INFO() << "No usable table manifest, probing table files";
+      probeTables(dir, tables);
+    }
+    scanArchives(dir, tables);
+    scanUnions(dir, tables);
+    // Tables in the directories before take precedence.
+    for (auto& info : tables) {
+      if (!findTable(info.id)) {
+        availableTables_.push_back(std::move(info));
+      }
+    }
+  }
+  addBuiltinTables();
+  std::stable_sort(availableTables_.begin(), availableTables_.end(),
+                   [](const TableInfo& a, const TableInfo& b) {
+                     return a.id < b.id;
+                   });
+  for (auto& info : availableTables_) {
+    if (info.members.empty()) {
+      continue;
+    }
+    // Unknown if the count of any member is.
+    info.entryCount = 0;
+    for (const auto& member : memberTables(info)) {
+      if (member.info.entryCount == 0) {
+        info.entryCount = 0;
+        break;
+      }
+      info.entryCount += member.info.entryCount;
+    }
   }
-  FCITX_INFO() << "Scanning tables in: " << dataPath_;
+}
 
-  for (int i = 0; i <= 43; ++i) {
-    std::stringstream ss;
-    ss << "TW_" << std::setw(2) << std::setfill('0') << i << ".json";
-    std::string filename = ss.str();
-    std::filesystem::path filePath =
-        std::filesystem::path(dataPath_) / filename;
+void InputTableManager::scanArchives(const std::filesystem::path& dir,
+                                     std::vector<TableInfo>& tables) {
+  std::error_code ec;
+  std::vector<std::filesystem::path> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+    if (entry.path().extension() == TableFormat::kArchiveExtension) {
+      paths.push_back(entry.path());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
 
-    if (std::filesystem::exists(filePath)) {
-      // FCITX_INFO() << "Found JSON file: " << filePath;
+  for (const auto& path : paths) {
+    auto file = MappedFile::open(path.string());
+    const auto* header =
+        file ? TableFormat::validate(file->data(), file->size()) : nullptr;
+    const auto* archive =
+        header ? TableFormat::archiveHeaderOf(header) : nullptr;
+    if (!archive) {
+      FCITX_INFO() << "Ignoring invalid archive: " << path;
+      continue;
+    }
+    auto archiveTime = std::filesystem::last_write_time(path, ec);
+    const auto* masks = reinterpret_cast<const uint32_t*>(
+        file->data() + archive->dialectMasksOffset);
+    auto dialects = TableFormat::readDialects(header);
+    for (size_t d = 0; d < dialects.size(); ++d) {
       TableInfo info;
-      info.id = filePath.stem().string();
-      info.path = filePath.string();
-
-      std::ifstream f(filePath);
-      if (f.is_open()) {
-        try {
-          nlohmann::json j;
-          f >> j;
-          info.name = j.value("name", info.id);
-        } catch (...) {
-          info.name = info.id;
-        }
+      info.id = std::move(dialects[d].id);
+      info.name = std::move(dialects[d].name);
+      info.path = path.string();
+      info.dialect = static_cast<int>(d);
+      for (uint32_t i = 0; i < header->entryCount; ++i) {
+        info.entryCount += (masks[i] >> d) & 1;
+      }
+
+      auto existing = std::find_if(
+          tables.begin(), tables.end(),
+          [&info](const TableInfo& table) { return table.id == info.id; });
+      if (existing == tables.end()) {
+        tables.push_back(std::move(info));
+        continue;
+      }
+      // A table file that has been updated since the archive was built is
+      // still used on its own.
+      auto tableTime = std::filesystem::last_write_time(existing->path, ec);
+      if (ec || tableTime <= archiveTime) {
+        *existing = std::move(info);
+      }
+    }
+  }
+}
+
+void InputTableManager::scanUnions(const std::filesystem::path& dir,
+                                   std::vector<TableInfo>& tables) {
+  std::error_code ec;
+  std::vector<std::filesystem::path> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+    if (entry.path().extension() == kUnionExtension) {
+      paths.push_back(entry.path());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+
+  for (const auto& path : paths) {
+    TableInfo info;
+    info.id = path.stem().string();
+    info.path = path.string();
+    try {
+      std::ifstream f(path);
+      auto json = nlohmann::json::parse(f);
+      info.name = json.value("name", info.id);
+      info.members = json.at("tables").get<std::vector<std::string>>();
+    } catch (const std::exception& e) {
+      FCITX_INFO() << "Ignoring invalid union " << path << ": " << e.what();
+      continue;
+    }
+    if (info.members.empty()) {
+      FCITX_INFO() << "Ignoring empty union: " << path;
+      continue;
+    }
+    // A union replaces a table file with the same id.
+    auto existing = std::find_if(
+        tables.begin(), tables.end(),
+        [&info](const TableInfo& table) { return table.id == info.id; });
+    if (existing != tables.end()) {
+      *existing = std::move(info);
+    } else {
+      tables.push_back(std::move(info));
+    }
+  }
+}
+
+void InputTableManager::addBuiltinTables() {
+  // Tables in the data directories take precedence, so that installed tables
+  // can update the built-in ones.
+  for (const auto& builtin : BuiltinTables::tables()) {
+    if (findTable(builtin.id)) {
+      continue;
+    }
+    TableInfo info;
+    info.id = builtin.id;
+    info.path = std::string(BuiltinTables::kPathPrefix) + builtin.id;
+    readCompiledTableInfo(info, builtin.data, builtin.size);
+    if (info.name.empty()) {
+      info.name = info.id;
+    }
+    availableTables_.push_back(std::move(info));
+  }
+}
+
+bool InputTableManager::readManifest(const std::filesystem::path& dir,
+                                     std::vector<TableInfo>& tables) {
+  auto records = TableManifest::read((dir / TableManifest::kFileName).string());
+  if (!records) {
+    return false;
+  }
+
+  for (auto& record : *records) {
+    TableInfo info;
+    info.id = std::move(record.id);
+    info.name = std::move(record.name);
+    info.path = (dir / record.path).string();
+    info.entryCount = record.entryCount;
+    if (!TableManifest::matches(info.path, record)) {
+      // The table has changed since the manifest was generated, so what the
+      // manifest says about it is read from the file instead.
+      FCITX_INFO() << "Table " << info.path << " does not match the manifest";
+      info.name.clear();
+      info.entryCount = 0;
+      if (std::filesystem::path(info.path).extension() ==
+          TableFormat::kFileExtension) {
+        readCompiledTableInfo(info);
       } else {
+        info.name = readJsonTableName(info.path);
+      }
+      if (info.name.empty()) {
         info.name = info.id;
       }
+    }
+    tables.push_back(std::move(info));
+  }
+  return true;
+}
 
-      availableTables_.push_back(info);
+void InputTableManager::probeTables(const std::filesystem::path& dir,
+                                    std::vector<TableInfo>& tables) {
+  std::set<std::string> ids;
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+    auto extension = entry.path().extension();
+    if (extension == ".json" || extension == TableFormat::kFileExtension) {
+      ids.insert(entry.path().stem().string());
     }
   }
+
+  for (const auto& id : ids) {
+    TableInfo info;
+    info.id = id;
+
+    // Prefer the compiled table installed next to the JSON one, unless the
+    // JSON table has been updated since.
+    std::filesystem::path compiledPath =
+        dir / (info.id + TableFormat::kFileExtension);
+    std::filesystem::path jsonPath = dir / (info.id + ".json");
+    auto compiledTime = std::filesystem::last_write_time(compiledPath, ec);
+    bool hasCompiled = !ec;
+    auto jsonTime = std::filesystem::last_write_time(jsonPath, ec);
+    if (hasCompiled && (ec || compiledTime >= jsonTime)) {
+      info.path = compiledPath.string();
+      readCompiledTableInfo(info);
+    } else if (std::filesystem::exists(jsonPath)) {
+      info.path = jsonPath.string();
+      info.name = readJsonTableName(jsonPath);
+    } else {
+      continue;
+    }
+
+    if (info.name.empty()) {
+      info.name = info.id;
+    }
+    tables.push_back(std::move(info));
+  }
+}
+
+size_t InputTableManager::directoryRank(const std::string& path) const {
+  auto dir = std::filesystem::path(path).parent_path();
+  for (size_t i = 0; i < dataPaths_.size(); ++i) {
+    // Appending a name drops a trailing separator of the data path.
+    if ((std::filesystem::path(dataPaths_[i]) / "x").parent_path() == dir) {
+      return i;
+    }
+  }
+  return dataPaths_.size();
 }
 
 bool InputTableManager::setTable(int index) {
@@ -63,10 +481,21 @@ bool InputTableManager::setTable(int index) {
     const auto& info = availableTables_[index];
     FCITX_INFO() << "Setting table to index: " << index << ", id: " << info.id;
 
-    auto newTable = std::make_unique<InputTable>();
+    requestedId_.clear();
+    if (useCachedTable(info.id)) {
+      ++cacheStats_.hits;
+      return true;
+    }
+
     FCITX_INFO() << "Attempting to load table from path: " << info.path;
-    if (newTable->load(info.path)) {
+    auto newTable =
+        loadTable(info, memberTables(info), glosses_, compressKeys_,
+                  infixSearch_, *archives_, indexCacheDirectory_);
+    if (newTable) {
+      ++cacheStats_.misses;
+      cache_.push_front({info.id, newTable});
       currentTable_ = std::move(newTable);
+      trimCache();
       FCITX_INFO() << "Successfully loaded table: " << info.name;
       return true;
     } else {
@@ -93,7 +522,167 @@ const InputTable& InputTableManager::currentTable() const {
   if (currentTable_) {
     return *currentTable_;
   }
-  return emptyTable_;
+  return *emptyTable_;
+}
+
+std::shared_ptr<const InputTable> InputTableManager::currentTableSnapshot()
+    const {
+  return currentTable_ ? currentTable_ : emptyTable_;
+}
+
+void InputTableManager::setScheduler(Scheduler scheduler) {
+  scheduler_ = std::move(scheduler);
+}
+
+void InputTableManager::setTableReadyCallback(TableReadyCallback callback) {
+  tableReadyCallback_ = std::move(callback);
+}
+
+bool InputTableManager::requestTable(const std::string& id) {
+  if (!scheduler_) {
+    return setTable(id);
+  }
+
+  const auto* info = findTable(id);
+  if (!info) {
+    FCITX_INFO() << "Table with id: " << id << " not found.";
+    return false;
+  }
+
+  requestedId_.clear();
+  if (useCachedTable(id)) {
+    ++cacheStats_.hits;
+    return true;
+  }
+
+  // Keystrokes are taken as plain composition until the table arrives.
+  requestedId_ = id;
+  currentTable_ = emptyTable_;
+  loadInBackground(*info);
+  return true;
+}
+
+void InputTableManager::preloadTables(const std::vector<std::string>& ids) {
+  if (!scheduler_) {
+    return;
+  }
+  for (const auto& id : ids) {
+    const auto* info = findTable(id);
+    if (info) {
+      loadInBackground(*info);
+    }
+  }
+}
+
+const InputTableManager::TableInfo* InputTableManager::findTable(
+    const std::string& id) const {
+  for (const auto& info : availableTables_) {
+    if (info.id == id) {
+      return &info;
+    }
+  }
+  return nullptr;
+}
+
+std::vector<InputTableManager::MemberTable> InputTableManager::memberTables(
+    const TableInfo& info) const {
+  std::vector<MemberTable> members;
+  for (const auto& id : info.members) {
+    const auto* member = findTable(id);
+    if (!member || !member->members.empty()) {
+      FCITX_INFO() << "Union " << info.id << " has no table " << id;
+      continue;
+    }
+    auto cached = std::find_if(
+        cache_.begin(), cache_.end(),
+        [&id](const CachedTable& entry) { return entry.id == id; });
+    members.push_back(
+        {*member, cached != cache_.end() ? cached->table : nullptr});
+  }
+  return members;
+}
+
+bool InputTableManager::isCached(const std::string& id) const {
+  return std::any_of(
+      cache_.begin(), cache_.end(),
+      [&id](const CachedTable& entry) { return entry.id == id; });
+}
+
+bool InputTableManager::useCachedTable(const std::string& id) {
+  auto cached =
+      std::find_if(cache_.begin(), cache_.end(),
+                   [&id](const CachedTable& entry) { return entry.id == id; });
+  if (cached == cache_.end()) {
+    return false;
+  }
+  cache_.splice(cache_.begin(), cache_, cached);
+  cached->lastUsed = Clock::now();
+  currentTable_ = cache_.front().table;
+  FCITX_DEBUG() << "Using cached table: " << id << ", hits: "
+                << cacheStats_.hits << ", misses: " << cacheStats_.misses;
+  return true;
+}
+
+void InputTableManager::loadInBackground(const TableInfo& info) {
+  if (!pendingIds_.insert(info.id).second) {
+    return;
+  }
+  loadOnWorker(info,
+               [this, id = info.id](std::shared_ptr<const InputTable> table) {
+                 onTableLoaded(id, std::move(table));
+               });
+}
+
+void InputTableManager::loadOnWorker(const TableInfo& info,
+                                     LoadCallback callback) {
+  // The job only touches its own copies and the archive cache, which locks,
+  // so it does not race with the manager. The result is handed back through
+  // the scheduler.
+  worker_.post([info, members = memberTables(info),
+                callback = std::move(callback), scheduler = scheduler_,
+                glosses = glosses_, compressKeys = compressKeys_,
+                infixSearch = infixSearch_, archives = archives_,
+                indexCache = indexCacheDirectory_,
+                lifetime = std::weak_ptr<int>(lifetime_)]() {
+    std::shared_ptr<const InputTable> result =
+        loadTable(info, members, glosses, compressKeys, infixSearch,
+                  *archives, indexCache);
+    scheduler([callback, lifetime, result]() {
+      if (!lifetime.expired()) {
+        callback(result);
+      }
+    });
+  });
+}
+
+void InputTableManager::onTableLoaded(const std::string& id,
+                                      std::shared_ptr<const InputTable> table) {
+  pendingIds_.erase(id);
+  bool requested = requestedId_ == id;
+  if (requested) {
+    requestedId_.clear();
+  }
+  if (!table) {
+    FCITX_INFO() << "Failed to load table: " << id;
+    return;
+  }
+
+  bool cached = isCached(id);
+  if (requested) {
+    ++cacheStats_.misses;
+    if (!cached) {
+      cache_.push_front({id, table});
+    }
+    useCachedTable(id);
+    trimCache();
+    FCITX_INFO() << "Loaded table in background: " << id;
+    if (tableReadyCallback_) {
+      tableReadyCallback_(id);
+    }
+  } else if (!cached && cache_.size() < maxCachedTables_) {
+    cache_.push_back({id, std::move(table)});
+    trimCache();
+  }
 }
 
 const std::vector<InputTableManager::TableInfo>&
@@ -101,4 +690,210 @@ InputTableManager::availableTables() const {
   return availableTables_;
 }
 
+void InputTableManager::setCompressKeys(bool compress) {
+  compressKeys_ = compress;
+}
+
+void InputTableManager::setInfixSearch(bool enabled) {
+  infixSearch_ = enabled;
+}
+
+void InputTableManager::setIndexCacheDirectory(std::string directory) {
+  indexCacheDirectory_ = std::move(directory);
+}
+
+void InputTableManager::setCacheLimits(size_t maxTables, size_t maxBytes) {
+  maxCachedTables_ = std::max<size_t>(maxTables, 1);
+  maxCacheBytes_ = maxBytes;
+  trimCache();
+}
+
+size_t InputTableManager::memoryUsage() const {
+  size_t bytes = archives_->memoryUsage();
+  // The members of a union may be loaded on their own or be shared with
+  // another union, and are counted once.
+  std::set<const InputTable*> counted;
+  for (const auto& entry : cache_) {
+    counted.insert(entry.table.get());
+  }
+  for (const auto& entry : cache_) {
+    bytes += entry.table->memoryUsage();
+    for (const auto& member : entry.table->members()) {
+      if (!counted.insert(member.table.get()).second) {
+        bytes -= member.table->memoryUsage();
+      }
+    }
+  }
+  return bytes;
+}
+
+void InputTableManager::trimCache() {
+  size_t evicted = 0;
+  while (cache_.size() > 1 &&
+         (cache_.size() > maxCachedTables_ ||
+          (maxCacheBytes_ > 0 && memoryUsage() > maxCacheBytes_))) {
+    FCITX_DEBUG() << "Evicting table from cache: " << cache_.back().id;
+    cache_.pop_back();
+    ++cacheStats_.evictions;
+    ++evicted;
+  }
+  if (evicted > 0) {
+    releaseMemory();
+  }
+}
+
+size_t InputTableManager::evictIdleTables(Clock::duration idleTime,
+                                          Clock::time_point now) {
+  if (idleTime <= Clock::duration::zero()) {
+    return 0;
+  }
+  size_t evicted = 0;
+  for (auto entry = cache_.begin(); entry != cache_.end();) {
+    if (entry->table == currentTable_ || now - entry->lastUsed < idleTime) {
+      ++entry;
+      continue;
+    }
+    FCITX_INFO() << "Evicting idle table: " << entry->id;
+    entry = cache_.erase(entry);
+    ++cacheStats_.evictions;
+    ++evicted;
+  }
+  if (evicted > 0) {
+    releaseMemory();
+  }
+  return evicted;
+}
+
+void InputTableManager::touchCurrentTable() {
+  if (!cache_.empty() && cache_.front().table == currentTable_) {
+    cache_.front().lastUsed = Clock::now();
+  }
+}
+
+void InputTableManager::reloadFile(const std::string& fileName) {
+  if (!dataPaths_.empty()) {
+    reloadFile(dataPaths_.front(), fileName);
+  }
+}
+
+void InputTableManager::reloadFile(const std::string& dataPath,
+                                   const std::string& fileName) {
+  if (fileName == TableManifest::kFileName) {
+    FCITX_INFO() << "Table manifest changed, rescanning tables";
+    scanTables();
+    return;
+  }
+
+  std::filesystem::path path = std::filesystem::path(dataPath) / fileName;
+  if (path.extension() == TableFormat::kArchiveExtension) {
+    FCITX_INFO() << "Archive " << fileName << " changed, rescanning tables";
+    archives_->invalidate(path.string());
+    scanTables();
+    for (const auto& info : availableTables_) {
+      if (info.dialect >= 0 && info.path == path.string()) {
+        // The unions of a loaded dialect follow once it is reloaded.
+        if (isCached(info.id)) {
+          reloadTable(info);
+        } else {
+          reloadUnionsOf(info.id);
+        }
+      }
+    }
+    return;
+  }
+  if (path.extension() == kUnionExtension) {
+    FCITX_INFO() << "Union " << fileName << " changed, rescanning tables";
+    scanTables();
+    const auto* info = findTable(path.stem().string());
+    if (info && info->path == path.string() && isCached(info->id)) {
+      reloadTable(*info);
+    }
+    return;
+  }
+  if (path.extension() != ".json" &&
+      path.extension() != TableFormat::kFileExtension) {
+    return;
+  }
+  std::string id = path.stem().string();
+  if (!findTable(id)) {
+    scanTables();
+  }
+  auto info = std::find_if(
+      availableTables_.begin(), availableTables_.end(),
+      [&id](const TableInfo& table) { return table.id == id; });
+  if (info == availableTables_.end() || !info->members.empty() ||
+      directoryRank(info->path) < directoryRank(path.string())) {
+    return;
+  }
+  // The file that changed last is the one to use.
+  info->path = path.string();
+  info->dialect = -1;
+  if (!isCached(id)) {
+    // The new file is read the next time the table is used.
+    reloadUnionsOf(id);
+    return;
+  }
+  reloadTable(*info);
+}
+
+void InputTableManager::reloadTable(const TableInfo& info) {
+  FCITX_INFO() << "Reloading table " << info.id << " from " << info.path;
+  uint64_t generation = ++reloadGenerations_[info.id];
+  if (!scheduler_) {
+    onTableReloaded(info.id, generation,
+                    loadTable(info, memberTables(info), glosses_,
+                              compressKeys_, infixSearch_, *archives_,
+                              indexCacheDirectory_));
+    return;
+  }
+  loadOnWorker(info, [this, id = info.id,
+                      generation](std::shared_ptr<const InputTable> table) {
+    onTableReloaded(id, generation, std::move(table));
+  });
+}
+
+void InputTableManager::reloadUnionsOf(const std::string& id) {
+  for (const auto& info : availableTables_) {
+    if (isCached(info.id) && std::find(info.members.begin(), info.members.end(),
+                                       id) != info.members.end()) {
+      reloadTable(info);
+    }
+  }
+}
+
+void InputTableManager::onTableReloaded(
+    const std::string& id, uint64_t generation,
+    std::shared_ptr<const InputTable> table) {
+  if (reloadGenerations_[id] != generation) {
+    return;
+  }
+  if (!table) {
+    FCITX_INFO() << "Failed to reload table " << id << ", keeping the old one";
+    return;
+  }
+
+  auto cached =
+      std::find_if(cache_.begin(), cache_.end(),
+                   [&id](const CachedTable& entry) { return entry.id == id; });
+  bool current = false;
+  if (cached != cache_.end()) {
+    current = cached->table == currentTable_;
+    cached->table = std::move(table);
+    if (current) {
+      currentTable_ = cached->table;
+    }
+    trimCache();
+    FCITX_INFO() << "Reloaded table " << id;
+  }
+  // The unions that have the table as a member pick up the new one, or
+  // read the file again if it has been evicted meanwhile.
+  const auto* info = findTable(id);
+  if (info && info->members.empty()) {
+    reloadUnionsOf(id);
+  }
+  if (current && tableReadyCallback_) {
+    tableReadyCallback_(id);
+  }
+}
+
 }  // namespace McFoxIM
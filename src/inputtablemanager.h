@@ -24,12 +24,19 @@
 #ifndef INPUTTABLEMANAGER_H_
 #define INPUTTABLEMANAGER_H_
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <list>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
 #include "inputtable.h"
+#include "worker.h"
 
 namespace McFoxIM {
 
@@ -39,22 +46,244 @@ class InputTableManager {
     std::string id;
     std::string name;
     std::string path;
+    uint32_t entryCount = 0;  // 0 when unknown
+    // The dialect of the archive at path, or -1 if path is a single table.
+    int dialect = -1;
+    // The ids of the tables a union at path merges, empty for other tables.
+    std::vector<std::string> members;
   };
 
+  struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+  };
+
+  // The archives that back loaded dialects.
+  class ArchiveCache;
+
+  // A member of a union, with its table if that is loaded already.
+  struct MemberTable {
+    TableInfo info;
+    std::shared_ptr<const InputTable> table;
+  };
+
+  using Clock = std::chrono::steady_clock;
+  using Scheduler = std::function<void(std::function<void()>)>;
+  using TableReadyCallback = std::function<void(const std::string& id)>;
+
+  static constexpr size_t kDefaultMaxCachedTables = 3;
+  // A union of tables, a JSON object such as
+  // {"name": "阿美語", "tables": ["TW_00", "TW_01"]}.
+  static constexpr const char* kUnionExtension = ".union";
+
+  /**
+   * Every JSON table, compiled table, archive and union in the data
+   * directories is used, and its file name without the extension is its id.
+   * A directory with a table manifest uses the tables listed in it instead,
+   * along with its archives and unions.
+   *
+   * @param dataPaths The directories of the table files, from the one that
+   * takes precedence for a table id, which is normally the user's. Empty to
+   * use only the tables built into the addon.
+   */
+  InputTableManager(std::vector<std::string> dataPaths);
+  /**
+   * @param dataPath The directory of the table files, or empty to use only
+   * the tables built into the addon.
+   */
   InputTableManager(std::string dataPath);
 
   bool setTable(int index);
   bool setTable(const std::string& id);
   const InputTable& currentTable() const;
+  /**
+   * Returns the current table as an immutable snapshot, which stays valid
+   * after the manager publishes another table.
+   */
+  std::shared_ptr<const InputTable> currentTableSnapshot() const;
   const std::vector<TableInfo>& availableTables() const;
 
+  /**
+   * Enables background loading. Tables are then loaded on a worker thread,
+   * and the scheduler hands every loaded table back to the thread that owns
+   * the manager, where it is published.
+   *
+   * @param scheduler Runs a function on the thread that owns the manager. It
+   * must be safe to call from any thread.
+   */
+  void setScheduler(Scheduler scheduler);
+  void setTableReadyCallback(TableReadyCallback callback);
+
+  /**
+   * Switches to the table with the given id. A cached table is used at once.
+   * With a scheduler, a table that is not cached is loaded in the background:
+   * until it is ready the current table is empty, and the ready callback runs
+   * once it has been published. Without a scheduler this is setTable(id).
+   *
+   * @param id The table id.
+   * @returns false if the table is unknown or could not be loaded.
+   */
+  bool requestTable(const std::string& id);
+
+  /**
+   * Loads the given tables in the background so that switching to them later
+   * is a cache hit. Tables that do not fit in the cache are dropped.
+   *
+   * @param ids The table ids.
+   */
+  void preloadTables(const std::vector<std::string>& ids);
+
+  /**
+   * Handles a changed file in a data directory. If the file backs a loaded
+   * table, the table is rebuilt (in the background when a scheduler is set)
+   * and its snapshot is replaced once the new one is complete; until then,
+   * and if the new file fails to load, the old snapshot stays in use. A
+   * changed manifest or archive, or an unknown table file, rescans the
+   * directories. A file is ignored while a directory that takes precedence
+   * has a table with the same id.
+   *
+   * @param dataPath The data directory of the file.
+   * @param fileName The name of the file, relative to the data directory.
+   */
+  void reloadFile(const std::string& dataPath, const std::string& fileName);
+  /** reloadFile() for a file in the first data directory. */
+  void reloadFile(const std::string& fileName);
+
+  /** Whether the requested table is still being loaded. */
+  bool isLoading() const { return !requestedId_.empty(); }
+
+  /**
+   * Sets the budget of the table cache. Recently used tables stay loaded, so
+   * switching back to one of them does not read the table again. The current
+   * table is never evicted.
+   *
+   * @param maxTables The maximum number of loaded tables, at least 1.
+   * @param maxBytes The maximum memory used by loaded tables, 0 for no limit.
+   */
+  void setCacheLimits(size_t maxTables, size_t maxBytes);
+  const CacheStats& cacheStats() const { return cacheStats_; }
+
+  /**
+   * The bytes held by the loaded tables and the archives behind them, which
+   * is what the memory limit of the cache applies to. The shared gloss
+   * dictionary is not included.
+   */
+  size_t memoryUsage() const;
+
+  /**
+   * Evicts the tables that have not been used for the given time and
+   * returns their memory to the system. The current table is kept, since
+   * typing goes on with it without requesting it again.
+   *
+   * @param idleTime How long a table has to be unused, 0 to keep them all.
+   * @param now The time to measure against.
+   * @returns The number of evicted tables.
+   */
+  size_t evictIdleTables(Clock::duration idleTime,
+                         Clock::time_point now = Clock::now());
+
+  /** Marks the current table as used, so that it is not idle. */
+  void touchCurrentTable();
+
+  /** Whether the table with the given id is loaded. */
+  bool isCached(const std::string& id) const;
+
+  /**
+   * Whether tables loaded from now on keep their phrases front-coded, which
+   * makes them smaller and their lookups slower. Tables that are already
+   * loaded keep their layout.
+   */
+  void setCompressKeys(bool compress);
+
+  /**
+   * Whether tables loaded from now on are indexed for infix searches (see
+   * InputTable::buildInfixIndex()). The index is built with the table, on
+   * the worker if there is one. Tables that are already loaded search their
+   * phrases without it.
+   */
+  void setInfixSearch(bool enabled);
+
+  /**
+   * Sets the directory where the indices of JSON tables are cached (see
+   * IndexCache), or an empty string not to cache them.
+   */
+  void setIndexCacheDirectory(std::string directory);
+  size_t cachedTableCount() const { return cache_.size(); }
+
+  /** The descriptions shared by the JSON tables the manager parses. */
+  const GlossDictionary& glossDictionary() const { return *glosses_; }
+
  private:
+  struct CachedTable {
+    std::string id;
+    std::shared_ptr<const InputTable> table;
+    Clock::time_point lastUsed = Clock::now();
+  };
+
   void scanTables();
+  bool readManifest(const std::filesystem::path& dir,
+                    std::vector<TableInfo>& tables);
+  void probeTables(const std::filesystem::path& dir,
+                   std::vector<TableInfo>& tables);
+  void scanArchives(const std::filesystem::path& dir,
+                    std::vector<TableInfo>& tables);
+  void scanUnions(const std::filesystem::path& dir,
+                  std::vector<TableInfo>& tables);
+  void addBuiltinTables();
+  // The position of the data directory of a table file, which is the number
+  // of data directories for built-in tables.
+  size_t directoryRank(const std::string& path) const;
+  const TableInfo* findTable(const std::string& id) const;
+  // The tables a union merges that are available, empty for other tables.
+  // Members in the cache come with their table, which the union shares.
+  std::vector<MemberTable> memberTables(const TableInfo& info) const;
+  bool useCachedTable(const std::string& id);
+  void trimCache();
+  using LoadCallback =
+      std::function<void(std::shared_ptr<const InputTable> table)>;
 
-  std::string dataPath_;
-  std::unique_ptr<InputTable> currentTable_;
+  void loadInBackground(const TableInfo& info);
+  // Loads a table on the worker and passes it, or nullptr if it fails to
+  // load, to the callback on the thread that owns the manager.
+  void loadOnWorker(const TableInfo& info, LoadCallback callback);
+  void reloadTable(const TableInfo& info);
+  // Reloads the loaded unions that have the given table as a member.
+  void reloadUnionsOf(const std::string& id);
+  void onTableLoaded(const std::string& id,
+                     std::shared_ptr<const InputTable> table);
+  void onTableReloaded(const std::string& id, uint64_t generation,
+                       std::shared_ptr<const InputTable> table);
+
+  std::vector<std::string> dataPaths_;
+  std::shared_ptr<const InputTable> currentTable_;
   std::vector<TableInfo> availableTables_;
-  InputTable emptyTable_;  // Fallback empty table
+  std::shared_ptr<const InputTable> emptyTable_;  // Fallback empty table
+  std::shared_ptr<GlossDictionary> glosses_ =
+      std::make_shared<GlossDictionary>();
+  // Shared with the worker, so that the dialects of an archive share it.
+  std::shared_ptr<ArchiveCache> archives_;
+
+  // Most recently used first. The current table, unless it is still being
+  // loaded, is the front.
+  std::list<CachedTable> cache_;
+  size_t maxCachedTables_ = kDefaultMaxCachedTables;
+  size_t maxCacheBytes_ = 0;
+  bool compressKeys_ = false;
+  bool infixSearch_ = false;
+  std::string indexCacheDirectory_;
+  CacheStats cacheStats_;
+
+  // Background loading.
+  Scheduler scheduler_;
+  TableReadyCallback tableReadyCallback_;
+  std::string requestedId_;
+  std::set<std::string> pendingIds_;
+  // The latest reload of each table. Older reloads are discarded.
+  std::map<std::string, uint64_t> reloadGenerations_;
+  // Lets scheduled callbacks detect that the manager is gone.
+  std::shared_ptr<int> lifetime_ = std::make_shared<int>(0);
+  Worker worker_;
 };
 
 }  // namespace McFoxIM
@@ -33,6 +33,18 @@ KeyHandler::KeyHandler(Completer& completer) : completer_(completer) {
   inputKeys_ = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz'^";
 }
 
+Completer::Completion KeyHandler::complete(
+    const std::string& composingBuffer) {
+  size_t count = InputState::InputtingState::CANDIDATES_PER_PAGE;
+  if (glossLookup_ && composingBuffer[0] == kGlossMarker) {
+    return {completer_.completeGloss(composingBuffer.substr(1)), nullptr};
+  }
+  if (infixSearch_ && composingBuffer[0] == kInfixMarker) {
+    return completer_.completeInfix(composingBuffer.substr(1), count);
+  }
+  return completer_.completeFirst(composingBuffer, count);
+}
+
 bool KeyHandler::handle(const fcitx::KeyEvent& keyEvent,
                         const InputState::InputState& state,
                         StateCallback stateCallback,
@@ -49,6 +61,33 @@ bool KeyHandler::handle(const fcitx::KeyEvent& keyEvent,
 
   // Check if state is EmptyState
   if (dynamic_cast<const InputState::EmptyState*>(&state)) {
+    if (infixSearch_ && ascii.length() == 1 && ascii[0] == kInfixMarker) {
+      // The candidates come with the keys typed after the marker.
+      InputState::InputtingState::Args args;
+      args.cursorIndex = ascii.length();
+      args.composingBuffer = ascii;
+      stateCallback(std::make_unique<InputState::InputtingState>(args));
+      return true;
+    }
+    if (glossLookup_ && ascii.length() == 1 && ascii[0] == kGlossMarker) {
+      // A selected gloss is looked up at once; the words replace it when
+      // they are committed.
+      std::string newComposingBuffer = ascii;
+      if (selectionProvider_) {
+        newComposingBuffer += selectionProvider_();
+      }
+      auto completion = complete(newComposingBuffer);
+
+      InputState::InputtingState::Args args;
+      args.cursorIndex = newComposingBuffer.length();
+      args.composingBuffer = newComposingBuffer;
+      args.candidates = std::move(completion.candidates);
+      if (!args.candidates.empty()) {
+        args.selectedCandidateIndex = 0;
+      }
+      stateCallback(std::make_unique<InputState::InputtingState>(args));
+      return true;
+    }
     if (ascii.length() == 1 && inputKeys_.find(ascii) == std::string::npos) {
       return false;
     }
@@ -62,13 +101,14 @@ bool KeyHandler::handle(const fcitx::KeyEvent& keyEvent,
 
     if (dynamic_cast<const InputState::EmptyState*>(&state)) {
       std::string newComposingBuffer = chr;
-      auto candidates = completer_.complete(newComposingBuffer);
+      auto completion = complete(newComposingBuffer);
 
       InputState::InputtingState::Args args;
       args.cursorIndex = newComposingBuffer.length();
       args.composingBuffer = newComposingBuffer;
-      args.candidates = candidates;
-      if (!candidates.empty()) {
+      args.candidates = std::move(completion.candidates);
+      args.completeAll = std::move(completion.completeAll);
+      if (!args.candidates.empty()) {
         args.selectedCandidateIndex = 0;
       }
 
@@ -80,13 +120,14 @@ bool KeyHandler::handle(const fcitx::KeyEvent& keyEvent,
       newComposingBuffer.insert(inputState->cursorIndex(), chr);
 
       size_t newCursorIndex = inputState->cursorIndex() + 1;
-      auto candidates = completer_.complete(newComposingBuffer);
+      auto completion = complete(newComposingBuffer);
 
       InputState::InputtingState::Args args;
       args.cursorIndex = newCursorIndex;
       args.composingBuffer = newComposingBuffer;
-      args.candidates = candidates;
-      if (!candidates.empty()) {
+      args.candidates = std::move(completion.candidates);
+      args.completeAll = std::move(completion.completeAll);
+      if (!args.candidates.empty()) {
         args.selectedCandidateIndex = 0;
       }
 
@@ -100,10 +141,14 @@ bool KeyHandler::handle(const fcitx::KeyEvent& keyEvent,
     // Tab or Return to commit
     if (key.check(fcitx::Key(FcitxKey_Tab)) ||
         key.check(fcitx::Key(FcitxKey_Return))) {
-      if (!inputState->candidates().empty()) {
-        size_t index = inputState->selectedCandidateIndex().value_or(0);
-        if (index < inputState->candidates().size()) {
-          const auto& selectedCandidate = inputState->candidates()[index];
+      // The selected candidate is on the current page, which does not need
+      // the rest of the candidates to be completed.
+      const auto& candidates = inputState->candidatesInCurrentPage();
+      if (!candidates.empty()) {
+        size_t index =
+            inputState->selectedCandidateIndexInCurrentPage().value_or(0);
+        if (index < candidates.size()) {
+          const auto& selectedCandidate = candidates[index];
           stateCallback(std::make_unique<InputState::CommittingState>(
               selectedCandidate.displayText() + " "));
         }
@@ -150,13 +195,14 @@ bool KeyHandler::handle(const fcitx::KeyEvent& keyEvent,
       newComposingBuffer.insert(inputState->cursorIndex(), " ");
 
       size_t newCursorIndex = inputState->cursorIndex() + 1;
-      auto candidates = completer_.complete(newComposingBuffer);
+      auto completion = complete(newComposingBuffer);
 
       InputState::InputtingState::Args args;
       args.cursorIndex = newCursorIndex;
       args.composingBuffer = newComposingBuffer;
-      args.candidates = candidates;
-      if (!candidates.empty()) {
+      args.candidates = std::move(completion.candidates);
+      args.completeAll = std::move(completion.completeAll);
+      if (!args.candidates.empty()) {
         args.selectedCandidateIndex = 0;
       }
 
@@ -188,12 +234,13 @@ bool KeyHandler::handle(const fcitx::KeyEvent& keyEvent,
             }
           }
 
-          auto candidates = completer_.complete(newComposingBuffer);
+          auto completion = complete(newComposingBuffer);
           InputState::InputtingState::Args args;
           args.cursorIndex = newCursorIndex;
           args.composingBuffer = newComposingBuffer;
-          args.candidates = candidates;
-          if (!candidates.empty()) {
+          args.candidates = std::move(completion.candidates);
+          args.completeAll = std::move(completion.completeAll);
+          if (!args.candidates.empty()) {
             args.selectedCandidateIndex = 0;
           }
           stateCallback(std::make_unique<InputState::InputtingState>(args));
@@ -202,6 +249,29 @@ bool KeyHandler::handle(const fcitx::KeyEvent& keyEvent,
       }
     }
 
+    if (key.check(fcitx::Key(FcitxKey_Delete, fcitx::KeyState::Shift))) {
+      // Forgets the selected candidate if it is a learned word, and lists
+      // the candidates again without it.
+      const auto& candidates = inputState->candidatesInCurrentPage();
+      auto index = inputState->selectedCandidateIndexInCurrentPage();
+      if (!wordRemover_ || !index || *index >= candidates.size() ||
+          !wordRemover_(candidates[*index].displayText())) {
+        errorCallback();
+        return true;
+      }
+      auto completion = complete(inputState->composingBuffer());
+      InputState::InputtingState::Args args;
+      args.cursorIndex = inputState->cursorIndex();
+      args.composingBuffer = inputState->composingBuffer();
+      args.candidates = std::move(completion.candidates);
+      args.completeAll = std::move(completion.completeAll);
+      if (!args.candidates.empty()) {
+        args.selectedCandidateIndex = 0;
+      }
+      stateCallback(std::make_unique<InputState::InputtingState>(args));
+      return true;
+    }
+
     if (key.check(fcitx::Key(FcitxKey_Delete))) {
       if (inputState->cursorIndex() < inputState->composingBuffer().length()) {
         std::string newComposingBuffer = inputState->composingBuffer();
@@ -222,12 +292,13 @@ bool KeyHandler::handle(const fcitx::KeyEvent& keyEvent,
             }
           }
 
-          auto candidates = completer_.complete(newComposingBuffer);
+          auto completion = complete(newComposingBuffer);
           InputState::InputtingState::Args args;
           args.cursorIndex = newCursorIndex;
           args.composingBuffer = newComposingBuffer;
-          args.candidates = candidates;
-          if (!candidates.empty()) {
+          args.candidates = std::move(completion.candidates);
+          args.completeAll = std::move(completion.completeAll);
+          if (!args.candidates.empty()) {
             args.selectedCandidateIndex = 0;
           }
           stateCallback(std::make_unique<InputState::InputtingState>(args));
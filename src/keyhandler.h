@@ -29,6 +29,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "completer.h"
@@ -38,19 +39,52 @@ namespace McFoxIM {
 
 class KeyHandler {
  public:
+  /** Starts a search of the phrases that contain what is typed after it. */
+  static constexpr char kInfixMarker = '*';
+  /**
+   * Starts a search of the words whose description contains the selected
+   * text, or what is typed after it.
+   */
+  static constexpr char kGlossMarker = '=';
+
   explicit KeyHandler(Completer& completer);
 
   using StateCallback =
       std::function<void(std::unique_ptr<InputState::InputState>)>;
   using ErrorCallback = std::function<void()>;
+  /** Returns the text selected in the application, or an empty string. */
+  using SelectionProvider = std::function<std::string()>;
+  /** Removes a learned word, and returns false if it was not one. */
+  using WordRemover = std::function<bool(const std::string&)>;
 
   bool handle(const fcitx::KeyEvent& keyEvent,
               const InputState::InputState& state, StateCallback stateCallback,
               ErrorCallback errorCallback);
 
+  /** Accepts kInfixMarker as the first key of the composing buffer. */
+  void setInfixSearch(bool enabled) { infixSearch_ = enabled; }
+
+  /** Accepts kGlossMarker as the first key of the composing buffer. */
+  void setGlossLookup(bool enabled) { glossLookup_ = enabled; }
+  void setSelectionProvider(SelectionProvider provider) {
+    selectionProvider_ = std::move(provider);
+  }
+
+  /** Shift+Delete removes the selected candidate with the remover. */
+  void setWordRemover(WordRemover remover) {
+    wordRemover_ = std::move(remover);
+  }
+
  private:
+  // The first page of candidates of a composing buffer.
+  Completer::Completion complete(const std::string& composingBuffer);
+
   Completer& completer_;
   std::string inputKeys_;
+  bool infixSearch_ = false;
+  bool glossLookup_ = false;
+  SelectionProvider selectionProvider_;
+  WordRemover wordRemover_;
 };
 
 }  // namespace McFoxIM
@@ -0,0 +1,305 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+#include "keyscan.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KEYSCAN_X86 1
+#endif
+
+namespace McFoxIM {
+namespace KeyScan {
+
+namespace {
+
+// The scalar kernels work on 8 bytes at a time in a 64-bit word.
+constexpr uint64_t kOnes = 0x0101010101010101;
+constexpr uint64_t kHighBits = 0x8080808080808080;
+
+uint64_t loadWord(const char* data, size_t size) {
+  uint64_t word = 0;
+  std::memcpy(&word, data, std::min<size_t>(size, 8));
+  return word;
+}
+
+// The high bit of every byte of the word that is an ASCII upper case
+// letter. Bytes from 0x80 have it set already and are left out.
+uint64_t upperBits(uint64_t word) {
+  uint64_t low = word & ~kHighBits;
+  uint64_t fromA = low + kOnes * (0x80 - 'A');
+  uint64_t pastZ = low + kOnes * (0x80 - 'Z' - 1);
+  return fromA & ~pastZ & ~word & kHighBits;
+}
+
+// The bytes of the first count bytes of a word.
+uint64_t headMask(size_t count) {
+  unsigned char bytes[8] = {};
+  std::memset(bytes, 0xff, std::min<size_t>(count, 8));
+  uint64_t mask;
+  std::memcpy(&mask, bytes, 8);
+  return mask;
+}
+
+// Whether the key at offset starts with the prefix, given that it is long
+// enough; the first width bytes have been compared already.
+bool tailMatches(const char* keys, size_t offset, std::string_view prefix,
+                 size_t width) {
+  return prefix.size() <= width ||
+         std::memcmp(keys + offset + width, prefix.data() + width,
+                     prefix.size() - width) == 0;
+}
+
+size_t prefixRunEndScalar(const char* keys, size_t size,
+                          const uint32_t* offsets, size_t first, size_t last,
+                          std::string_view prefix) {
+  uint64_t pattern = loadWord(prefix.data(), prefix.size());
+  uint64_t mask = headMask(prefix.size());
+  for (size_t i = first; i < last; ++i) {
+    size_t offset = offsets[i];
+    if (offsets[i + 1] - offset < prefix.size()) {
+      return i;
+    }
+    if (offset + 8 > size) {
+      if (std::memcmp(keys + offset, prefix.data(), prefix.size()) != 0) {
+        return i;
+      }
+      continue;
+    }
+    if (((loadWord(keys + offset, 8) ^ pattern) & mask) != 0 ||
+        !tailMatches(keys, offset, prefix, 8)) {
+      return i;
+    }
+  }
+  return last;
+}
+
+bool hasUpperScalar(const char* data, size_t size) {
+  for (size_t i = 0; i < size; i += 8) {
+    if (upperBits(loadWord(data + i, size - i)) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void toLowerScalar(char* data, size_t size) {
+  for (size_t i = 0; i < size; i += 8) {
+    size_t count = std::min<size_t>(size - i, 8);
+    uint64_t word = loadWord(data + i, count);
+    uint64_t upper = upperBits(word);
+    if (upper != 0) {
+      // The high bit moved to the bit of 0x20, which lowers the letter.
+      word += upper >> 2;
+      std::memcpy(data + i, &word, count);
+    }
+  }
+}
+
+#ifdef KEYSCAN_X86
+
+// The vector kernels leave what is shorter than a vector to the scalar
+// ones, and never load a vector that would pass the end of the arena.
+
+__attribute__((target("sse4.2"))) size_t prefixRunEndSse42(
+    const char* keys, size_t size, const uint32_t* offsets, size_t first,
+    size_t last, std::string_view prefix) {
+  if (prefix.size() <= 8) {
+    return prefixRunEndScalar(keys, size, offsets, first, last, prefix);
+  }
+  char padded[16] = {};
+  std::memcpy(padded, prefix.data(), std::min<size_t>(prefix.size(), 16));
+  __m128i pattern =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(padded));
+  uint32_t mask =
+      prefix.size() >= 16 ? 0xffff : (1u << prefix.size()) - 1;
+  for (size_t i = first; i < last; ++i) {
+    size_t offset = offsets[i];
+    if (offsets[i + 1] - offset < prefix.size()) {
+      return i;
+    }
+    if (offset + 16 > size) {
+      return prefixRunEndScalar(keys, size, offsets, i, last, prefix);
+    }
+    __m128i key =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + offset));
+    auto equal = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(key, pattern)));
+    if ((equal & mask) != mask || !tailMatches(keys, offset, prefix, 16)) {
+      return i;
+    }
+  }
+  return last;
+}
+
+__attribute__((target("sse4.2"))) bool hasUpperSse42(const char* data,
+                                                     size_t size) {
+  const __m128i range = _mm_setr_epi8('A', 'Z', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                      0, 0, 0, 0);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    // Carry is set if a byte is in the range.
+    if (_mm_cmpestrc(range, 2, bytes, 16,
+                     _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES)) {
+      return true;
+    }
+  }
+  return hasUpperScalar(data + i, size - i);
+}
+
+__attribute__((target("sse4.2"))) void toLowerSse42(char* data, size_t size) {
+  // Bytes from 0x80 are negative, so they are never in the range.
+  const __m128i belowA = _mm_set1_epi8('A' - 1);
+  const __m128i aboveZ = _mm_set1_epi8('Z' + 1);
+  const __m128i offset = _mm_set1_epi8('a' - 'A');
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    auto* at = reinterpret_cast<__m128i*>(data + i);
+    __m128i bytes = _mm_loadu_si128(at);
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, belowA),
+                                  _mm_cmplt_epi8(bytes, aboveZ));
+    _mm_storeu_si128(at,
+                     _mm_add_epi8(bytes, _mm_and_si128(upper, offset)));
+  }
+  toLowerScalar(data + i, size - i);
+}
+
+__attribute__((target("avx2"))) size_t prefixRunEndAvx2(
+    const char* keys, size_t size, const uint32_t* offsets, size_t first,
+    size_t last, std::string_view prefix) {
+  if (prefix.size() <= 16) {
+    return prefixRunEndSse42(keys, size, offsets, first, last, prefix);
+  }
+  char padded[32] = {};
+  std::memcpy(padded, prefix.data(), std::min<size_t>(prefix.size(), 32));
+  __m256i pattern =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(padded));
+  uint32_t mask =
+      prefix.size() >= 32 ? UINT32_MAX : (1u << prefix.size()) - 1;
+  for (size_t i = first; i < last; ++i) {
+    size_t offset = offsets[i];
+    if (offsets[i + 1] - offset < prefix.size()) {
+      return i;
+    }
+    if (offset + 32 > size) {
+      return prefixRunEndScalar(keys, size, offsets, i, last, prefix);
+    }
+    __m256i key =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + offset));
+    auto equal = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(key, pattern)));
+    if ((equal & mask) != mask || !tailMatches(keys, offset, prefix, 32)) {
+      return i;
+    }
+  }
+  return last;
+}
+
+__attribute__((target("avx2"))) bool hasUpperAvx2(const char* data,
+                                                  size_t size) {
+  const __m256i belowA = _mm256_set1_epi8('A' - 1);
+  const __m256i aboveZ = _mm256_set1_epi8('Z' + 1);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i bytes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, belowA),
+                                     _mm256_cmpgt_epi8(aboveZ, bytes));
+    if (!_mm256_testz_si256(upper, upper)) {
+      return true;
+    }
+  }
+  return hasUpperSse42(data + i, size - i);
+}
+
+__attribute__((target("avx2"))) void toLowerAvx2(char* data, size_t size) {
+  const __m256i belowA = _mm256_set1_epi8('A' - 1);
+  const __m256i aboveZ = _mm256_set1_epi8('Z' + 1);
+  const __m256i offset = _mm256_set1_epi8('a' - 'A');
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    auto* at = reinterpret_cast<__m256i*>(data + i);
+    __m256i bytes = _mm256_loadu_si256(at);
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, belowA),
+                                     _mm256_cmpgt_epi8(aboveZ, bytes));
+    _mm256_storeu_si256(
+        at, _mm256_add_epi8(bytes, _mm256_and_si256(upper, offset)));
+  }
+  toLowerSse42(data + i, size - i);
+}
+
+#endif  // KEYSCAN_X86
+
+constexpr Kernels kScalarKernels = {prefixRunEndScalar, hasUpperScalar,
+                                    toLowerScalar};
+#ifdef KEYSCAN_X86
+constexpr Kernels kSse42Kernels = {prefixRunEndSse42, hasUpperSse42,
+                                   toLowerSse42};
+constexpr Kernels kAvx2Kernels = {prefixRunEndAvx2, hasUpperAvx2,
+                                  toLowerAvx2};
+#endif
+
+}  // namespace
+
+Level supportedLevel() {
+#ifdef KEYSCAN_X86
+  static const Level level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      return Level::kAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+      return Level::kSse42;
+    }
+    return Level::kScalar;
+  }();
+  return level;
+#else
+  return Level::kScalar;
+#endif
+}
+
+const Kernels& kernels(Level level) {
+  level = std::min(level, supportedLevel());
+#ifdef KEYSCAN_X86
+  if (level == Level::kAvx2) {
+    return kAvx2Kernels;
+  }
+  if (level == Level::kSse42) {
+    return kSse42Kernels;
+  }
+#endif
+  return kScalarKernels;
+}
+
+const Kernels& kernels() {
+  static const Kernels& best = kernels(supportedLevel());
+  return best;
+}
+
+}  // namespace KeyScan
+}  // namespace McFoxIM
@@ -0,0 +1,80 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+#ifndef KEYSCAN_H_
+#define KEYSCAN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace McFoxIM {
+
+/**
+ * Vectorized scans of phrases: the end of a run of phrases that start with
+ * a prefix, and ASCII case folding. Each scan has a scalar version and, on
+ * x86-64, SSE4.2 and AVX2 versions; the best one the CPU supports is chosen
+ * when it is first used.
+ */
+namespace KeyScan {
+
+enum class Level { kScalar, kSse42, kAvx2 };
+
+struct Kernels {
+  /**
+   * Finds the first key in [first, last) that does not start with the
+   * prefix, or last.
+   *
+   * @param keys The key arena; key i is [offsets[i], offsets[i + 1]).
+   * @param size The bytes in the arena, which the scan never reads past.
+   */
+  size_t (*prefixRunEnd)(const char* keys, size_t size,
+                         const uint32_t* offsets, size_t first, size_t last,
+                         std::string_view prefix);
+  /** Whether the bytes have an ASCII upper case letter. */
+  bool (*hasUpper)(const char* data, size_t size);
+  /** Lowers the ASCII upper case letters of the bytes in place. */
+  void (*toLower)(char* data, size_t size);
+};
+
+/** The best level of the CPU. */
+Level supportedLevel();
+
+/** The kernels of a level, or of the best one the CPU supports below it. */
+const Kernels& kernels(Level level);
+
+/** The kernels of supportedLevel(). */
+const Kernels& kernels();
+
+inline bool hasUpper(std::string_view text) {
+  return kernels().hasUpper(text.data(), text.size());
+}
+
+inline void toLower(std::string& text) {
+  kernels().toLower(text.data(), text.size());
+}
+
+}  // namespace KeyScan
+}  // namespace McFoxIM
+
+#endif  // KEYSCAN_H_
@@ -0,0 +1,76 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+#include "levenshteinautomaton.h"
+
+#include <algorithm>
+
+#include "utf8.h"
+
+namespace McFoxIM {
+
+LevenshteinAutomaton::LevenshteinAutomaton(std::string_view pattern,
+                                           uint32_t maxDistance)
+    : maxDistance_(std::min<uint32_t>(maxDistance, 254)) {
+  for (size_t pos = 0; pos < pattern.size();) {
+    pattern_.push_back(fold(Utf8::nextCharacter(pattern, pos)));
+  }
+}
+
+uint32_t LevenshteinAutomaton::fold(uint32_t character) {
+  if (character >= 'A' && character <= 'Z') {
+    return character - 'A' + 'a';
+  }
+  switch (character) {
+    case 0x2018:  // ‘
+    case 0x2019:  // ’
+    case 0x02bc:  // ʼ
+      return '\'';
+    default:
+      return character;
+  }
+}
+
+void LevenshteinAutomaton::start(uint8_t* state) const {
+  uint32_t limit = maxDistance_ + 1;
+  for (size_t i = 0; i <= pattern_.size(); ++i) {
+    state[i] = static_cast<uint8_t>(std::min<size_t>(i, limit));
+  }
+}
+
+bool LevenshteinAutomaton::step(const uint8_t* state, uint32_t character,
+                                uint8_t* next) const {
+  uint32_t limit = maxDistance_ + 1;
+  character = fold(character);
+  next[0] = static_cast<uint8_t>(std::min<uint32_t>(state[0] + 1, limit));
+  uint32_t least = next[0];
+  for (size_t i = 1; i <= pattern_.size(); ++i) {
+    uint32_t cost = state[i - 1] + (pattern_[i - 1] == character ? 0 : 1);
+    cost = std::min<uint32_t>(cost, state[i] + 1);
+    cost = std::min<uint32_t>(cost, next[i - 1] + 1);
+    next[i] = static_cast<uint8_t>(std::min(cost, limit));
+    least = std::min<uint32_t>(least, next[i]);
+  }
+  return least <= maxDistance_;
+}
+
+}  // namespace McFoxIM
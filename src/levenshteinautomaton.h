@@ -0,0 +1,87 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+#ifndef LEVENSHTEINAUTOMATON_H_
+#define LEVENSHTEINAUTOMATON_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace McFoxIM {
+
+/**
+ * An automaton that accepts the texts that start with a string within a
+ * given edit distance of a pattern, counting insertions, deletions and
+ * substitutions of characters.
+ *
+ * A state is a column of the edit distance table: the distance from each
+ * prefix of the pattern to the text read so far, capped at maxDistance() + 1.
+ * States are kept by the caller in arrays of stateSize() bytes, so that a
+ * walk of sorted phrases can keep one per character of the current phrase
+ * and share them with the next one.
+ *
+ * ASCII letters match regardless of case, and the apostrophes that the
+ * tables write the glottal stop with (', ’, ‘ and ʼ) match each other.
+ */
+class LevenshteinAutomaton {
+ public:
+  /**
+   * @param pattern The pattern, in UTF-8.
+   * @param maxDistance The greatest distance accepted, below 255.
+   */
+  LevenshteinAutomaton(std::string_view pattern, uint32_t maxDistance);
+
+  uint32_t maxDistance() const { return maxDistance_; }
+  size_t stateSize() const { return pattern_.size() + 1; }
+
+  /** Writes the state before any character is read. */
+  void start(uint8_t* state) const;
+
+  /**
+   * Writes the state after reading a character in a state.
+   *
+   * @returns false if no text that continues from the next state is
+   * accepted.
+   */
+  bool step(const uint8_t* state, uint32_t character, uint8_t* next) const;
+
+  /**
+   * The distance from the pattern to the text read so far, above
+   * maxDistance() if it is too far.
+   */
+  uint32_t distance(const uint8_t* state) const {
+    return state[pattern_.size()];
+  }
+
+  /** Maps the characters that match each other to one of them. */
+  static uint32_t fold(uint32_t character);
+
+ private:
+  std::vector<uint32_t> pattern_;
+  uint32_t maxDistance_;
+};
+
+}  // namespace McFoxIM
+
+#endif  // LEVENSHTEINAUTOMATON_H_
@@ -0,0 +1,156 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "perfecthash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace McFoxIM {
+
+namespace {
+
+// Seeds tried before giving up. A seed fails only when a bucket finds no
+// pilot, which is rare, so the first seed nearly always works.
+constexpr uint64_t kMaxSeeds = 8;
+
+}  // namespace
+
+uint64_t PerfectHash::hash(std::string_view key) {
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ key.size();
+  size_t i = 0;
+  for (; i + 8 <= key.size(); i += 8) {
+    uint64_t word;
+    std::memcpy(&word, key.data() + i, 8);
+    h = mix(h ^ word);
+  }
+  uint64_t tail = 0;
+  std::memcpy(&tail, key.data() + i, key.size() - i);
+  return mix(h ^ tail);
+}
+
+bool PerfectHash::build(const std::vector<uint64_t>& hashes) {
+  seed_ = 0;
+  pilots_.clear();
+  indices_.clear();
+  if (hashes.empty() ||
+      hashes.size() > std::numeric_limits<uint32_t>::max()) {
+    return false;
+  }
+  // Keys with the same hash can never be told apart.
+  std::vector<uint64_t> sorted = hashes;
+  std::sort(sorted.begin(), sorted.end());
+  if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+    return false;
+  }
+
+  for (uint64_t seed = 0; seed < kMaxSeeds; ++seed) {
+    if (tryBuild(hashes, mix(seed + 1))) {
+      pilots_.shrink_to_fit();
+      indices_.shrink_to_fit();
+      return true;
+    }
+  }
+  pilots_.clear();
+  indices_.clear();
+  return false;
+}
+
+bool PerfectHash::tryBuild(const std::vector<uint64_t>& hashes,
+                           uint64_t seed) {
+  size_t n = hashes.size();
+  size_t bucketCount = (n + kBucketLoad - 1) / kBucketLoad;
+  seed_ = seed;
+  pilots_.assign(bucketCount, 0);
+  indices_.assign(n + n / kSlack, 0);
+
+  // The keys of each bucket, as one array sorted by bucket.
+  std::vector<uint32_t> bucketStarts(bucketCount + 1, 0);
+  std::vector<uint32_t> bucketOf(n);
+  for (size_t i = 0; i < n; ++i) {
+    bucketOf[i] = static_cast<uint32_t>(reduce(mix(hashes[i] ^ seed_),
+                                               bucketCount));
+    ++bucketStarts[bucketOf[i] + 1];
+  }
+  std::partial_sum(bucketStarts.begin(), bucketStarts.end(),
+                   bucketStarts.begin());
+  std::vector<uint32_t> keys(n);
+  std::vector<uint32_t> next(bucketStarts.begin(), bucketStarts.end() - 1);
+  for (size_t i = 0; i < n; ++i) {
+    keys[next[bucketOf[i]]++] = static_cast<uint32_t>(i);
+  }
+
+  // Larger buckets are harder to place, so they go first, while most slots
+  // are free.
+  std::vector<uint32_t> order(bucketCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return bucketStarts[a + 1] - bucketStarts[a] >
+           bucketStarts[b + 1] - bucketStarts[b];
+  });
+
+  std::vector<bool> taken(indices_.size(), false);
+  std::vector<size_t> slots;
+  for (uint32_t bucket : order) {
+    uint32_t first = bucketStarts[bucket];
+    uint32_t last = bucketStarts[bucket + 1];
+    if (first == last) {
+      break;
+    }
+    bool placed = false;
+    for (uint32_t pilot = 0;
+         !placed && pilot <= std::numeric_limits<uint16_t>::max(); ++pilot) {
+      slots.clear();
+      placed = true;
+      for (uint32_t k = first; k < last; ++k) {
+        size_t slot = slotOf(hashes[keys[k]], static_cast<uint16_t>(pilot));
+        if (taken[slot] ||
+            std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+          placed = false;
+          break;
+        }
+        slots.push_back(slot);
+      }
+      if (placed) {
+        pilots_[bucket] = static_cast<uint16_t>(pilot);
+        for (size_t k = 0; k < slots.size(); ++k) {
+          taken[slots[k]] = true;
+          indices_[slots[k]] = keys[first + k];
+        }
+      }
+    }
+    if (!placed) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t PerfectHash::memoryUsage() const {
+  return pilots_.capacity() * sizeof(uint16_t) +
+         indices_.capacity() * sizeof(uint32_t);
+}
+
+}  // namespace McFoxIM
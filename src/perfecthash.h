@@ -0,0 +1,110 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef PERFECTHASH_H_
+#define PERFECTHASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace McFoxIM {
+
+/**
+ * A perfect hash of a set of distinct keys. It maps each of its n keys to
+ * the index the key was given at build time, without collisions, so an exact
+ * lookup costs two hashes, a table read and one comparison of the key it
+ * finds. A key outside the set maps to some index as well, which is why the
+ * comparison is needed.
+ *
+ * The keys are spread over buckets of about kBucketLoad keys each. Buckets
+ * are placed largest first, and each one is given the first pilot value
+ * that sends all of its keys to free slots. There are 1/kSlack more slots
+ * than keys, which makes the last buckets much quicker to place than in a
+ * minimal hash. Only the pilots and the index of the key in each slot are
+ * stored, under 5 bytes per key.
+ */
+class PerfectHash {
+ public:
+  static constexpr size_t kBucketLoad = 3;
+  static constexpr size_t kSlack = 32;
+
+  /** Hashes a key; build() takes the hashes of its keys. */
+  static uint64_t hash(std::string_view key);
+
+  /**
+   * Builds the hash of the keys with the given hashes. The index of a key is
+   * its position in the list.
+   *
+   * @returns false, leaving the hash empty, if two keys share a hash or no
+   * placement is found.
+   */
+  bool build(const std::vector<uint64_t>& hashes);
+
+  bool empty() const { return indices_.empty(); }
+
+  /**
+   * The index of the key with the given hash if it is in the set. The hash
+   * must not be empty.
+   */
+  size_t find(uint64_t hash) const {
+    uint64_t bucket = reduce(mix(hash ^ seed_), pilots_.size());
+    return indices_[slotOf(hash, pilots_[bucket])];
+  }
+
+  /** The bytes held by the pilots and the slots. */
+  size_t memoryUsage() const;
+
+ private:
+  static uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+  }
+
+  // Maps a hash to [0, n) without a division.
+  static uint64_t reduce(uint64_t x, size_t n) {
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(x) * n) >>
+                                 64);
+  }
+
+  size_t slotOf(uint64_t hash, uint16_t pilot) const {
+    return reduce(mix(hash + 0x9e3779b97f4a7c15ULL * (pilot + 1ULL)),
+                  indices_.size());
+  }
+
+  bool tryBuild(const std::vector<uint64_t>& hashes, uint64_t seed);
+
+  uint64_t seed_ = 0;
+  std::vector<uint16_t> pilots_;
+  // The index of the key in each slot.
+  std::vector<uint32_t> indices_;
+};
+
+}  // namespace McFoxIM
+
+#endif  // PERFECTHASH_H_
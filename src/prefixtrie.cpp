@@ -0,0 +1,173 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "prefixtrie.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace McFoxIM {
+
+void PrefixTrie::build(size_t size, const KeyAt& keyAt) {
+  base_.clear();
+  check_.clear();
+  first_.clear();
+  last_.clear();
+  listStarts_.clear();
+  lists_.clear();
+  nodeCount_ = 0;
+  firstFree_ = 1;
+  usedEnd_ = 1;
+  if (size == 0 || size > std::numeric_limits<uint32_t>::max()) {
+    return;
+  }
+
+  reserveSlots(256);
+  check_[0] = 0;
+  first_[0] = 0;
+  last_[0] = static_cast<uint32_t>(size);
+  ++nodeCount_;
+
+  // Nodes to expand, with the length of their path.
+  struct Pending {
+    uint32_t node;
+    uint32_t depth;
+  };
+  std::vector<Pending> pending = {{0, 0}};
+  std::vector<uint8_t> labels;
+  std::vector<uint32_t> starts;
+  while (!pending.empty()) {
+    auto [node, depth] = pending.back();
+    pending.pop_back();
+    uint32_t first = first_[node];
+    uint32_t last = last_[node];
+    if (last - first <= kLeafSize) {
+      base_[node] = kLeaf;
+      continue;
+    }
+
+    // Keys that end here sort first; the rest are grouped by their next
+    // byte.
+    labels.clear();
+    starts.clear();
+    for (uint32_t i = first; i < last; ++i) {
+      std::string_view key = keyAt(i);
+      if (key.size() <= depth) {
+        continue;
+      }
+      auto label = static_cast<uint8_t>(key[depth]);
+      if (labels.empty() || labels.back() != label) {
+        labels.push_back(label);
+        starts.push_back(i);
+      }
+    }
+    if (labels.empty()) {
+      base_[node] = kLeaf;
+      continue;
+    }
+    starts.push_back(last);
+
+    uint32_t base = findBase(labels);
+    base_[node] = base;
+    for (size_t c = 0; c < labels.size(); ++c) {
+      uint32_t child = base + labels[c];
+      check_[child] = node;
+      usedEnd_ = std::max<size_t>(usedEnd_, child + 1);
+      first_[child] = starts[c];
+      last_[child] = starts[c + 1];
+      ++nodeCount_;
+      pending.push_back({child, depth + 1});
+    }
+  }
+
+  // Drop the unused tail of the arrays.
+  size_t used = check_.size();
+  while (used > 1 && check_[used - 1] == kFree) {
+    --used;
+  }
+  for (auto* array : {&base_, &check_, &first_, &last_}) {
+    array->resize(used);
+    array->shrink_to_fit();
+  }
+}
+
+uint32_t PrefixTrie::findBase(const std::vector<uint8_t>& labels) {
+  // Slots that are still free far behind the end of the used ones are
+  // unlikely to fit a node, and scanning them over and over makes large
+  // builds quadratic, so they are given up on.
+  firstFree_ = std::max(firstFree_, usedEnd_ - std::min(usedEnd_, kScanWindow));
+  while (firstFree_ < check_.size() && check_[firstFree_] != kFree) {
+    ++firstFree_;
+  }
+  // The first label goes to a free slot, starting at the first free one.
+  for (size_t slot = std::max<size_t>(firstFree_, labels.front() + 1);;
+       ++slot) {
+    uint32_t base = static_cast<uint32_t>(slot - labels.front());
+    reserveSlots(base + labels.back() + 1);
+    if (check_[slot] != kFree) {
+      continue;
+    }
+    bool fits = std::all_of(labels.begin(), labels.end(), [&](uint8_t label) {
+      return check_[base + label] == kFree;
+    });
+    if (fits) {
+      return base;
+    }
+  }
+}
+
+void PrefixTrie::attachLists(const ListOf& listOf) {
+  listStarts_.clear();
+  lists_.clear();
+  if (empty()) {
+    return;
+  }
+  listStarts_.reserve(check_.size() + 1);
+  listStarts_.push_back(0);
+  for (size_t slot = 0; slot < check_.size(); ++slot) {
+    if (check_[slot] != kFree && base_[slot] != kLeaf) {
+      listOf(first_[slot], last_[slot], lists_);
+    }
+    listStarts_.push_back(static_cast<uint32_t>(lists_.size()));
+  }
+  lists_.shrink_to_fit();
+}
+
+void PrefixTrie::reserveSlots(size_t size) {
+  if (size <= check_.size()) {
+    return;
+  }
+  size = std::max(size, check_.size() * 2);
+  base_.resize(size, 0);
+  check_.resize(size, kFree);
+  first_.resize(size, 0);
+  last_.resize(size, 0);
+}
+
+size_t PrefixTrie::memoryUsage() const {
+  return sizeof(uint32_t) *
+         (base_.capacity() + check_.capacity() + first_.capacity() +
+          last_.capacity() + listStarts_.capacity() + lists_.capacity());
+}
+
+}  // namespace McFoxIM
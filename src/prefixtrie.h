@@ -0,0 +1,144 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef PREFIXTRIE_H_
+#define PREFIXTRIE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace McFoxIM {
+
+/**
+ * A trie of sorted keys, stored as a double array. Every node holds the
+ * range of keys that start with its path, so a prefix resolves to a range
+ * of keys in one step per byte, without comparing keys.
+ *
+ * A node with at most kLeafSize keys is not expanded further; the rest of a
+ * prefix that ends below it is found by searching its few keys. This keeps
+ * the trie small on long keys and large tables.
+ *
+ * The double array packs the children of every node into the same arrays:
+ * the child of node s for byte c is slot base[s] + c, which is valid if
+ * check[slot] is s.
+ *
+ * Expanded nodes can carry a short list of values, such as the best keys
+ * under them, so that a prefix finds them without visiting its keys.
+ */
+class PrefixTrie {
+ public:
+  static constexpr size_t kLeafSize = 8;
+
+  using KeyAt = std::function<std::string_view(size_t index)>;
+  using ListOf = std::function<void(size_t first, size_t last,
+                                    std::vector<uint32_t>& list)>;
+
+  /** The part of a prefix that the trie resolves. */
+  struct Match {
+    // The keys of the deepest node on the path of the prefix.
+    size_t first = 0;
+    size_t last = 0;
+    // The bytes of the prefix that lead to the node. If this is the whole
+    // prefix, [first, last) are the keys that start with it.
+    size_t depth = 0;
+    uint32_t node = 0;
+  };
+
+  /**
+   * Builds the trie of the given keys.
+   *
+   * @param size The number of keys.
+   * @param keyAt Returns a key, in byte order by index. Only called during
+   * the build.
+   */
+  void build(size_t size, const KeyAt& keyAt);
+
+  bool empty() const { return base_.empty(); }
+
+  /** Follows a prefix from the root as far as the trie goes. */
+  Match find(std::string_view prefix) const {
+    uint32_t node = 0;
+    size_t depth = 0;
+    for (; depth < prefix.size() && base_[node] != kLeaf; ++depth) {
+      uint32_t child = base_[node] + static_cast<uint8_t>(prefix[depth]);
+      if (child >= check_.size() || check_[child] != node) {
+        break;
+      }
+      node = child;
+    }
+    return {first_[node], last_[node], depth, node};
+  }
+
+  /**
+   * Attaches a list to every expanded node, replacing the previous lists.
+   *
+   * @param listOf Appends the list of the node with the keys [first, last).
+   */
+  void attachLists(const ListOf& listOf);
+
+  /** The list of the node of a match, empty if it has none. */
+  std::span<const uint32_t> listAt(uint32_t node) const {
+    if (listStarts_.empty()) {
+      return {};
+    }
+    return std::span<const uint32_t>(lists_).subspan(
+        listStarts_[node], listStarts_[node + 1] - listStarts_[node]);
+  }
+
+  /** The number of nodes, including unexpanded ones. */
+  size_t nodeCount() const { return nodeCount_; }
+
+  /** The bytes held by the arrays. */
+  size_t memoryUsage() const;
+
+ private:
+  static constexpr uint32_t kLeaf = UINT32_MAX;
+  static constexpr uint32_t kFree = UINT32_MAX;
+  // How far behind the last used slot a free slot is still considered.
+  static constexpr size_t kScanWindow = 256;
+
+  // Finds a base at which every label has a free slot.
+  uint32_t findBase(const std::vector<uint8_t>& labels);
+  void reserveSlots(size_t size);
+
+  std::vector<uint32_t> base_;
+  std::vector<uint32_t> check_;
+  std::vector<uint32_t> first_;
+  std::vector<uint32_t> last_;
+  // The list of slot s is lists_[listStarts_[s], listStarts_[s + 1]).
+  std::vector<uint32_t> listStarts_;
+  std::vector<uint32_t> lists_;
+  size_t nodeCount_ = 0;
+  // Build state: no slot before firstFree_ gets used any more, and none
+  // after usedEnd_ is used yet.
+  size_t firstFree_ = 0;
+  size_t usedEnd_ = 0;
+};
+
+}  // namespace McFoxIM
+
+#endif  // PREFIXTRIE_H_
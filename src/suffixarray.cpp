@@ -0,0 +1,120 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+#include "suffixarray.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace McFoxIM {
+
+void SuffixArray::build(size_t size, const KeyAt& keyAt) {
+  text_.clear();
+  starts_.clear();
+  suffixes_.clear();
+  if (size == 0) {
+    return;
+  }
+  for (size_t i = 0; i < size; ++i) {
+    starts_.push_back(static_cast<uint32_t>(text_.size()));
+    text_.append(keyAt(i));
+    text_.push_back('\0');
+  }
+  starts_.push_back(static_cast<uint32_t>(text_.size()));
+  for (size_t i = 0; i < text_.size(); ++i) {
+    uint8_t byte = static_cast<uint8_t>(text_[i]);
+    if (byte != 0 && (byte & 0xc0) != 0x80) {
+      suffixes_.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  // A suffix ends at the NUL of its key, so comparing two of them never
+  // reads past it.
+  const char* text = text_.data();
+  std::sort(suffixes_.begin(), suffixes_.end(),
+            [text](uint32_t a, uint32_t b) {
+              return std::strcmp(text + a, text + b) < 0;
+            });
+  text_.shrink_to_fit();
+  starts_.shrink_to_fit();
+  suffixes_.shrink_to_fit();
+}
+
+uint32_t SuffixArray::keyAt(uint32_t position) const {
+  auto next = std::upper_bound(starts_.begin(), starts_.end(), position);
+  return static_cast<uint32_t>(next - starts_.begin() - 1);
+}
+
+std::vector<uint32_t> SuffixArray::find(std::string_view pattern,
+                                        size_t count) const {
+  std::vector<uint32_t> keys;
+  if (empty() || pattern.empty() || count == 0 ||
+      pattern.find('\0') != std::string_view::npos) {
+    return keys;
+  }
+
+  // The pattern has no NUL, so strncmp stops at the end of the key.
+  const char* text = text_.data();
+  auto compare = [&](uint32_t position) {
+    return std::strncmp(text + position, pattern.data(), pattern.size());
+  };
+  auto first = std::partition_point(
+      suffixes_.begin(), suffixes_.end(),
+      [&](uint32_t position) { return compare(position) < 0; });
+  auto last = std::partition_point(
+      first, suffixes_.end(),
+      [&](uint32_t position) { return compare(position) == 0; });
+
+  if (static_cast<size_t>(last - first) <= count) {
+    for (auto it = first; it != last; ++it) {
+      keys.push_back(keyAt(*it));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+  }
+
+  // The keys found so far, in order. A match at or after the start of the
+  // last one cannot displace it, so most matches are skipped without
+  // finding their key.
+  for (auto it = first; it != last; ++it) {
+    if (keys.size() == count && *it >= starts_[keys.back()]) {
+      continue;
+    }
+    uint32_t key = keyAt(*it);
+    auto slot = std::lower_bound(keys.begin(), keys.end(), key);
+    if (slot != keys.end() && *slot == key) {
+      continue;
+    }
+    keys.insert(slot, key);
+    if (keys.size() > count) {
+      keys.pop_back();
+    }
+  }
+  return keys;
+}
+
+size_t SuffixArray::memoryUsage() const {
+  return text_.capacity() +
+         sizeof(uint32_t) * (starts_.capacity() + suffixes_.capacity());
+}
+
+}  // namespace McFoxIM
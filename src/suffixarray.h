@@ -0,0 +1,90 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+#ifndef SUFFIXARRAY_H_
+#define SUFFIXARRAY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace McFoxIM {
+
+/**
+ * A suffix array of a list of keys, which finds the keys that contain a
+ * pattern anywhere with a binary search of O(|pattern| log n) steps.
+ *
+ * The keys are copied back to back into a text, each ended by a NUL byte so
+ * that no match runs into the next key. Only the suffixes that start a UTF-8
+ * character are indexed. The keys are kept in the order they are given, so
+ * that of the keys found, the ones given first are the ones whose matches
+ * are earliest in the text; find() uses this to produce the first few keys
+ * without sorting all the matches.
+ *
+ * The index holds the text, one uint32_t per key and one per indexed
+ * suffix, so at most nine bytes per byte of the keys and four per key.
+ */
+class SuffixArray {
+ public:
+  using KeyAt = std::function<std::string_view(size_t index)>;
+
+  /**
+   * Builds the suffix array of the given keys.
+   *
+   * @param size The number of keys.
+   * @param keyAt Returns a key by index, in the order find() ranks them.
+   * Only called during the build.
+   */
+  void build(size_t size, const KeyAt& keyAt);
+
+  bool empty() const { return starts_.empty(); }
+
+  /**
+   * Finds the keys that contain a pattern.
+   *
+   * @param pattern The pattern, which must not be empty.
+   * @param count The most keys to find.
+   * @returns The indices of the first count keys that contain the pattern,
+   * in order.
+   */
+  std::vector<uint32_t> find(std::string_view pattern, size_t count) const;
+
+  /** The bytes held by the index. */
+  size_t memoryUsage() const;
+
+ private:
+  // The key whose text contains a position.
+  uint32_t keyAt(uint32_t position) const;
+
+  std::string text_;
+  // The start of each key in the text, followed by the size of the text.
+  std::vector<uint32_t> starts_;
+  // The indexed positions of the text, in order of their suffixes.
+  std::vector<uint32_t> suffixes_;
+};
+
+}  // namespace McFoxIM
+
+#endif  // SUFFIXARRAY_H_
@@ -0,0 +1,225 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+// fox-tablec compiles a JSON input table into the compiled table format
+// described in tableformat.h, writes the table manifest described in
+// tablemanifest.h, generates the C++ source of the built-in tables
+// described in builtintables.h, and packs the dialects of a language family
+// into an archive.
+//
+// Usage: fox-tablec <input.json> <output.table>
+//        fox-tablec --manifest <output> <table>...
+//        fox-tablec --embed <output.cpp> <table>...
+//        fox-tablec --archive <output.archive> <table>...
+//
+// Tables and archives are written to a temporary file that is renamed over
+// the output, so a running input method that maps the old file keeps
+// reading it intact. Install them the same way (install(1), mv), never by
+// copying over the installed file.
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "inputtable.h"
+#include "tableformat.h"
+#include "tablemanifest.h"
+
+namespace {
+
+int compileTable(const std::string& input, const std::string& output) {
+  McFoxIM::InputTable table;
+  if (!table.load(input)) {
+    std::cerr << "Failed to load " << input << std::endl;
+    return 1;
+  }
+  if (!McFoxIM::TableFormat::write(table, output)) {
+    std::cerr << "Failed to write " << output << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int writeManifest(const std::string& output,
+                  const std::vector<std::string>& tables) {
+  std::vector<McFoxIM::TableManifest::Record> records;
+  for (const auto& path : tables) {
+    McFoxIM::InputTable table;
+    McFoxIM::TableManifest::Record record;
+    if (!McFoxIM::TableManifest::stat(path, record) || !table.load(path)) {
+      std::cerr << "Failed to load " << path << std::endl;
+      return 1;
+    }
+
+    record.id = std::filesystem::path(path).stem().string();
+    record.name = table.name().empty() ? record.id : table.name();
+    record.entryCount = static_cast<uint32_t>(table.size());
+    record.path = std::filesystem::path(path).filename().string();
+    records.push_back(std::move(record));
+  }
+
+  if (!McFoxIM::TableManifest::write(output, records)) {
+    std::cerr << "Failed to write " << output << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Every table becomes a dialect named after its table and identified by its
+// file name, and the archive is named after its own file name.
+int writeArchive(const std::string& output,
+                 const std::vector<std::string>& tables) {
+  std::vector<McFoxIM::InputTable> loaded(tables.size());
+  std::vector<std::pair<McFoxIM::TableFormat::Dialect,
+                        const McFoxIM::InputTable*>>
+      dialects;
+  for (size_t i = 0; i < tables.size(); ++i) {
+    if (!loaded[i].load(tables[i])) {
+      std::cerr << "Failed to load " << tables[i] << std::endl;
+      return 1;
+    }
+    McFoxIM::TableFormat::Dialect dialect;
+    dialect.id = std::filesystem::path(tables[i]).stem().string();
+    dialect.name = loaded[i].name().empty() ? dialect.id : loaded[i].name();
+    dialects.emplace_back(std::move(dialect), &loaded[i]);
+  }
+
+  std::string name = std::filesystem::path(output).stem().string();
+  if (!McFoxIM::TableFormat::writeArchive(name, dialects, output)) {
+    std::cerr << "Failed to write " << output << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+// Appends the bytes as C++ string literals, using octal escapes of three
+// digits so that no escape runs into the next character.
+void appendStringLiterals(std::string& out, const std::string& bytes) {
+  constexpr size_t kLineWidth = 76;
+  std::string line = "\"";
+  for (unsigned char c : bytes) {
+    if (c >= 0x20 && c < 0x7f && c != '"' && c != '\\' && c != '?') {
+      line.push_back(static_cast<char>(c));
+    } else {
+      char escape[5];
+      std::snprintf(escape, sizeof(escape), "\\%03o", c);
+      line += escape;
+    }
+    if (line.size() >= kLineWidth) {
+      out += "    " + line + "\"\n";
+      line = "\"";
+    }
+  }
+  out += "    " + line + "\"";
+}
+
+int writeBuiltinTables(const std::string& output,
+                       std::vector<std::string> tables) {
+  std::sort(tables.begin(), tables.end(),
+            [](const std::string& a, const std::string& b) {
+              return std::filesystem::path(a).stem() <
+                     std::filesystem::path(b).stem();
+            });
+
+  std::string out =
+      "// Generated by fox-tablec --embed. Do not edit.\n\n"
+      "#include \"builtintables.h\"\n\n"
+      "namespace McFoxIM {\n"
+      "namespace BuiltinTables {\n\n"
+      "namespace {\n\n";
+  std::string entries;
+  for (size_t i = 0; i < tables.size(); ++i) {
+    McFoxIM::InputTable table;
+    if (!table.load(tables[i])) {
+      std::cerr << "Failed to load " << tables[i] << std::endl;
+      return 1;
+    }
+    auto bytes = McFoxIM::TableFormat::serialize(table);
+    if (!bytes) {
+      std::cerr << "Failed to compile " << tables[i] << std::endl;
+      return 1;
+    }
+
+    std::string symbol = "kTable" + std::to_string(i);
+    std::string id = std::filesystem::path(tables[i]).stem().string();
+    // The offset arrays are read in place.
+    out += "alignas(8) constexpr char " + symbol + "[] =\n";
+    appendStringLiterals(out, *bytes);
+    out += ";\n\n";
+    entries += "    {\"" + id + "\", " + symbol + ", " +
+               std::to_string(bytes->size()) + "},\n";
+  }
+  out += "}  // namespace\n\n";
+  if (tables.empty()) {
+    out += "extern const Table kTables[] = {{nullptr, nullptr, 0}};\n";
+  } else {
+    out += "extern const Table kTables[] = {\n" + entries + "};\n";
+  }
+  out += "extern const size_t kTableCount = " + std::to_string(tables.size()) +
+         ";\n\n"
+         "}  // namespace BuiltinTables\n"
+         "}  // namespace McFoxIM\n";
+
+  std::ofstream f(output, std::ios::binary | std::ios::trunc);
+  f << out;
+  if (!f.good()) {
+    std::cerr << "Failed to write " << output << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc >= 3 && std::string(argv[1]) == "--manifest") {
+    std::vector<std::string> tables(argv + 3, argv + argc);
+    return writeManifest(argv[2], tables);
+  }
+  if (argc >= 3 && std::string(argv[1]) == "--embed") {
+    std::vector<std::string> tables(argv + 3, argv + argc);
+    return writeBuiltinTables(argv[2], std::move(tables));
+  }
+  if (argc >= 3 && std::string(argv[1]) == "--archive") {
+    std::vector<std::string> tables(argv + 3, argv + argc);
+    return writeArchive(argv[2], tables);
+  }
+  if (argc == 3) {
+    return compileTable(argv[1], argv[2]);
+  }
+
+  std::cerr << "Usage: " << argv[0] << " <input.json> <output"
+            << McFoxIM::TableFormat::kFileExtension << ">" << std::endl;
+  std::cerr << "       " << argv[0] << " --manifest <output> <table>..."
+            << std::endl;
+  std::cerr << "       " << argv[0] << " --embed <output.cpp> <table>..."
+            << std::endl;
+  std::cerr << "       " << argv[0] << " --archive <output"
+            << McFoxIM::TableFormat::kArchiveExtension << "> <table>..."
+            << std::endl;
+  return 1;
+}
@@ -0,0 +1,347 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "tableformat.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <vector>
+
+#include "inputtable.h"
+
+namespace McFoxIM {
+namespace TableFormat {
+
+namespace {
+
+void appendU32(std::string& out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+bool offsetsAreValid(const uint32_t* offsets, uint32_t count,
+                     uint32_t blobSize) {
+  if (offsets[0] != 0 || offsets[count] != blobSize) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    if (offsets[i] > offsets[i + 1]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+namespace {
+
+// The entries of a table or an archive, sorted by phrase.
+struct Entries {
+  std::string keys;
+  std::string descriptions;
+  std::vector<uint32_t> keyOffsets{0};
+  std::vector<uint32_t> descriptionOffsets{0};
+  std::vector<uint32_t> dialectMasks;
+
+  size_t size() const { return keyOffsets.size() - 1; }
+
+  void add(std::string_view phrase, std::string_view description) {
+    keys += phrase;
+    descriptions += description;
+    keyOffsets.push_back(static_cast<uint32_t>(keys.size()));
+    descriptionOffsets.push_back(static_cast<uint32_t>(descriptions.size()));
+  }
+};
+
+// Encodes a table, or an archive when dialects is not empty.
+std::optional<std::string> encode(const std::string& name,
+                                  const Entries& entries,
+                                  const std::vector<Dialect>& dialects) {
+  bool archive = !dialects.empty();
+  std::string dialectList;
+  for (const auto& dialect : dialects) {
+    dialectList += dialect.id + "\t" + dialect.name + "\n";
+  }
+
+  auto count = static_cast<uint64_t>(entries.size());
+  uint64_t total = sizeof(Header) + 8 * (count + 1) + name.size() +
+                   entries.keys.size() + entries.descriptions.size();
+  if (archive) {
+    total += sizeof(ArchiveHeader) + 4 * count + dialectList.size();
+  }
+  if (total > std::numeric_limits<uint32_t>::max()) {
+    return std::nullopt;
+  }
+
+  uint32_t keyOffsetsOffset =
+      sizeof(Header) + (archive ? sizeof(ArchiveHeader) : 0);
+  uint32_t descriptionOffsetsOffset =
+      keyOffsetsOffset + 4 * static_cast<uint32_t>(count + 1);
+  uint32_t dialectMasksOffset =
+      descriptionOffsetsOffset + 4 * static_cast<uint32_t>(count + 1);
+  uint32_t nameOffset =
+      dialectMasksOffset + (archive ? 4 * static_cast<uint32_t>(count) : 0);
+  uint32_t dialectsOffset = nameOffset + static_cast<uint32_t>(name.size());
+  uint32_t keyBlobOffset =
+      dialectsOffset + static_cast<uint32_t>(dialectList.size());
+  uint32_t descriptionBlobOffset =
+      keyBlobOffset + static_cast<uint32_t>(entries.keys.size());
+
+  std::string out;
+  out.reserve(total);
+  out.append(kMagic, sizeof(kMagic));
+  appendU32(out, archive ? kArchiveVersion : kVersion);
+  appendU32(out, static_cast<uint32_t>(count));
+  appendU32(out, keyOffsetsOffset);
+  appendU32(out, descriptionOffsetsOffset);
+  appendU32(out, nameOffset);
+  appendU32(out, static_cast<uint32_t>(name.size()));
+  appendU32(out, keyBlobOffset);
+  appendU32(out, static_cast<uint32_t>(entries.keys.size()));
+  appendU32(out, descriptionBlobOffset);
+  appendU32(out, static_cast<uint32_t>(entries.descriptions.size()));
+  if (archive) {
+    appendU32(out, static_cast<uint32_t>(dialects.size()));
+    appendU32(out, dialectsOffset);
+    appendU32(out, static_cast<uint32_t>(dialectList.size()));
+    appendU32(out, dialectMasksOffset);
+  }
+  for (uint32_t offset : entries.keyOffsets) {
+    appendU32(out, offset);
+  }
+  for (uint32_t offset : entries.descriptionOffsets) {
+    appendU32(out, offset);
+  }
+  if (archive) {
+    for (uint32_t mask : entries.dialectMasks) {
+      appendU32(out, mask);
+    }
+  }
+  out += name;
+  out += dialectList;
+  out += entries.keys;
+  out += entries.descriptions;
+  return out;
+}
+
+bool writeFile(const std::optional<std::string>& out,
+               const std::string& path) {
+  if (!out) {
+    return false;
+  }
+
+  std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream f(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!f.is_open()) {
+      return false;
+    }
+    f.write(out->data(), static_cast<std::streamsize>(out->size()));
+    if (!f.good()) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmpPath, path, ec);
+  return !ec;
+}
+
+}  // namespace
+
+std::optional<std::string> serialize(const InputTable& table) {
+  // InputTable keeps its entries sorted by phrase, equal phrases in source
+  // order.
+  Entries entries;
+  entries.keyOffsets.reserve(table.size() + 1);
+  entries.descriptionOffsets.reserve(table.size() + 1);
+  table.visitPhrases(0, table.size(),
+                     [&](size_t index, std::string_view phrase) {
+                       entries.add(phrase, table.descriptionAt(index));
+                     });
+  return encode(table.name(), entries, {});
+}
+
+bool write(const InputTable& table, const std::string& path) {
+  return writeFile(serialize(table), path);
+}
+
+std::optional<std::string> serializeArchive(
+    const std::string& name,
+    const std::vector<std::pair<Dialect, const InputTable*>>& dialects) {
+  if (dialects.empty() || dialects.size() > kMaxDialects) {
+    return std::nullopt;
+  }
+
+  // The descriptions of each phrase in archive order, with the dialects
+  // that have them. Every dialect must see its own descriptions of a phrase
+  // in its own order, so a dialect's descriptions are merged in as a
+  // subsequence: a description is shared with the first equal one after the
+  // previous match, or else inserted there.
+  struct Item {
+    std::string description;
+    uint32_t mask;
+  };
+  std::map<std::string, std::vector<Item>> phrases;
+  for (size_t d = 0; d < dialects.size(); ++d) {
+    const auto& table = *dialects[d].second;
+    uint32_t bit = 1u << d;
+    table.visitGroups(0, table.size(), [&](std::string_view phrase,
+                                           size_t begin, size_t end,
+                                           uint32_t /* Unused */) {
+      auto& items = phrases[std::string(phrase)];
+      size_t position = 0;
+      for (size_t i = begin; i < end; ++i) {
+        auto description = table.descriptionAt(i);
+        auto match = std::find_if(
+            items.begin() + position, items.end(), [&](const Item& item) {
+              return item.description == description && !(item.mask & bit);
+            });
+        if (match == items.end()) {
+          match = items.insert(items.begin() + position,
+                               {std::string(description), 0});
+        }
+        match->mask |= bit;
+        position = match - items.begin() + 1;
+      }
+    });
+  }
+
+  Entries entries;
+  for (const auto& [phrase, items] : phrases) {
+    for (const auto& item : items) {
+      entries.add(phrase, item.description);
+      entries.dialectMasks.push_back(item.mask);
+    }
+  }
+  std::vector<Dialect> list;
+  for (const auto& [dialect, table] : dialects) {
+    list.push_back(dialect);
+  }
+  return encode(name, entries, list);
+}
+
+bool writeArchive(
+    const std::string& name,
+    const std::vector<std::pair<Dialect, const InputTable*>>& dialects,
+    const std::string& path) {
+  return writeFile(serializeArchive(name, dialects), path);
+}
+
+const Header* validate(const char* data, size_t size) {
+  // The offset arrays are used in place, so the host must be little-endian.
+  if constexpr (std::endian::native != std::endian::little) {
+    return nullptr;
+  }
+  if (data == nullptr || size < sizeof(Header) ||
+      reinterpret_cast<uintptr_t>(data) % alignof(uint32_t) != 0) {
+    return nullptr;
+  }
+
+  const auto* header = reinterpret_cast<const Header*>(data);
+  if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      (header->version != kVersion && header->version != kArchiveVersion)) {
+    return nullptr;
+  }
+  if (header->version == kArchiveVersion &&
+      size < sizeof(Header) + sizeof(ArchiveHeader)) {
+    return nullptr;
+  }
+
+  auto inBounds = [size](uint64_t offset, uint64_t length) {
+    return offset + length <= size;
+  };
+  uint64_t offsetsSize = 4 * (static_cast<uint64_t>(header->entryCount) + 1);
+  if (header->keyOffsetsOffset % 4 != 0 ||
+      header->descriptionOffsetsOffset % 4 != 0 ||
+      !inBounds(header->keyOffsetsOffset, offsetsSize) ||
+      !inBounds(header->descriptionOffsetsOffset, offsetsSize) ||
+      !inBounds(header->nameOffset, header->nameSize) ||
+      !inBounds(header->keyBlobOffset, header->keyBlobSize) ||
+      !inBounds(header->descriptionBlobOffset,
+                header->descriptionBlobSize)) {
+    return nullptr;
+  }
+
+  const auto* keyOffsets =
+      reinterpret_cast<const uint32_t*>(data + header->keyOffsetsOffset);
+  const auto* descriptionOffsets = reinterpret_cast<const uint32_t*>(
+      data + header->descriptionOffsetsOffset);
+  if (!offsetsAreValid(keyOffsets, header->entryCount, header->keyBlobSize) ||
+      !offsetsAreValid(descriptionOffsets, header->entryCount,
+                       header->descriptionBlobSize)) {
+    return nullptr;
+  }
+
+  if (const auto* archive = archiveHeaderOf(header)) {
+    if (archive->dialectCount == 0 || archive->dialectCount > kMaxDialects ||
+        archive->dialectMasksOffset % 4 != 0 ||
+        !inBounds(archive->dialectMasksOffset,
+                  4 * static_cast<uint64_t>(header->entryCount)) ||
+        !inBounds(archive->dialectsOffset, archive->dialectsSize) ||
+        readDialects(header).size() != archive->dialectCount) {
+      return nullptr;
+    }
+  }
+  return header;
+}
+
+const ArchiveHeader* archiveHeaderOf(const Header* header) {
+  if (header->version != kArchiveVersion) {
+    return nullptr;
+  }
+  return reinterpret_cast<const ArchiveHeader*>(header + 1);
+}
+
+std::vector<Dialect> readDialects(const Header* header) {
+  std::vector<Dialect> dialects;
+  const auto* archive = archiveHeaderOf(header);
+  if (!archive) {
+    return dialects;
+  }
+  std::string_view list(
+      reinterpret_cast<const char*>(header) + archive->dialectsOffset,
+      archive->dialectsSize);
+  while (!list.empty()) {
+    size_t tab = list.find('\t');
+    size_t newline = list.find('\n');
+    if (tab == std::string_view::npos || newline == std::string_view::npos ||
+        tab > newline) {
+      return {};
+    }
+    dialects.push_back({std::string(list.substr(0, tab)),
+                        std::string(list.substr(tab + 1, newline - tab - 1))});
+    list.remove_prefix(newline + 1);
+  }
+  return dialects;
+}
+
+}  // namespace TableFormat
+}  // namespace McFoxIM
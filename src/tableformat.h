@@ -0,0 +1,163 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef TABLEFORMAT_H_
+#define TABLEFORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace McFoxIM {
+
+class InputTable;
+
+/**
+ * The compiled input table format. A compiled table is produced from a JSON
+ * table by fox-tablec at build time and is memory-mapped at runtime, so that
+ * loading it needs neither parsing nor allocation.
+ *
+ * Layout (every integer is a little-endian uint32_t):
+ *
+ *   Header
+ *   keyOffsets[entryCount + 1]          offsets into the key blob
+ *   descriptionOffsets[entryCount + 1]  offsets into the description blob
+ *   name                                UTF-8, not NUL-terminated
+ *   key blob
+ *   description blob
+ *
+ * Entries are sorted by key in byte order. Entries with equal keys keep the
+ * order they had in the source table.
+ *
+ * An archive (version 2) holds the union of several dialect tables of a
+ * language family, with every shared entry stored once. An ArchiveHeader
+ * follows the header, and two more sections are added:
+ *
+ *   dialectMasks[entryCount]            after the description offsets, bit d
+ *                                       set if dialect d has the entry
+ *   dialects                            after the name, "id\tname\n" for
+ *                                       every dialect
+ *
+ * Each dialect sees its entries with equal keys in its own source order.
+ */
+namespace TableFormat {
+
+constexpr char kMagic[8] = {'F', 'O', 'X', 'T', 'A', 'B', 'L', 'E'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kArchiveVersion = 2;
+constexpr const char* kFileExtension = ".table";
+constexpr const char* kArchiveExtension = ".archive";
+constexpr size_t kMaxDialects = 32;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t entryCount;
+  uint32_t keyOffsetsOffset;
+  uint32_t descriptionOffsetsOffset;
+  uint32_t nameOffset;
+  uint32_t nameSize;
+  uint32_t keyBlobOffset;
+  uint32_t keyBlobSize;
+  uint32_t descriptionBlobOffset;
+  uint32_t descriptionBlobSize;
+};
+
+static_assert(sizeof(Header) == 48, "Header must not contain padding");
+
+struct ArchiveHeader {
+  uint32_t dialectCount;
+  uint32_t dialectsOffset;
+  uint32_t dialectsSize;
+  uint32_t dialectMasksOffset;
+};
+
+struct Dialect {
+  std::string id;
+  std::string name;
+};
+
+/**
+ * Encodes the given table as a compiled table.
+ *
+ * @param table The table to encode.
+ * @returns The bytes of the compiled table, or std::nullopt if the table is
+ * too large for the format.
+ */
+std::optional<std::string> serialize(const InputTable& table);
+
+/**
+ * Writes the given table as a compiled table.
+ *
+ * @param table The table to write.
+ * @param path The output path. The file is replaced atomically.
+ * @returns true on success.
+ */
+bool write(const InputTable& table, const std::string& path);
+
+/**
+ * Encodes the given dialect tables of a language family as an archive.
+ *
+ * @param name The name of the archive.
+ * @param dialects The dialects and their tables, at most kMaxDialects.
+ * @returns The bytes of the archive, or std::nullopt if there are too many
+ * dialects or entries.
+ */
+std::optional<std::string> serializeArchive(
+    const std::string& name,
+    const std::vector<std::pair<Dialect, const InputTable*>>& dialects);
+
+/**
+ * Writes the given dialect tables as an archive, see serializeArchive().
+ *
+ * @param path The output path. The file is replaced atomically.
+ * @returns true on success.
+ */
+bool writeArchive(
+    const std::string& name,
+    const std::vector<std::pair<Dialect, const InputTable*>>& dialects,
+    const std::string& path);
+
+/**
+ * Checks that the given bytes hold a well-formed compiled table or archive
+ * that can be used in place on this host.
+ *
+ * @param data The bytes of the compiled table.
+ * @param size The number of bytes.
+ * @returns The header, or nullptr if the bytes are not usable.
+ */
+const Header* validate(const char* data, size_t size);
+
+/** The archive header of a validated archive, or nullptr for a table. */
+const ArchiveHeader* archiveHeaderOf(const Header* header);
+
+/** The dialects of a validated archive, empty for a table. */
+std::vector<Dialect> readDialects(const Header* header);
+
+}  // namespace TableFormat
+}  // namespace McFoxIM
+
+#endif  // TABLEFORMAT_H_
@@ -0,0 +1,140 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "tablemanifest.h"
+
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace McFoxIM {
+namespace TableManifest {
+
+namespace {
+
+std::vector<std::string> splitFields(const std::string& line) {
+  std::vector<std::string> fields;
+  std::string field;
+  std::istringstream ss(line);
+  while (std::getline(ss, field, '\t')) {
+    fields.push_back(field);
+  }
+  return fields;
+}
+
+template <typename T>
+bool parseNumber(const std::string& text, T& value, int base) {
+  const char* end = text.data() + text.size();
+  auto [ptr, ec] = std::from_chars(text.data(), end, value, base);
+  return ec == std::errc() && ptr == end;
+}
+
+}  // namespace
+
+std::optional<std::vector<Record>> read(const std::string& path) {
+  std::ifstream f(path);
+  if (!f.is_open()) {
+    return std::nullopt;
+  }
+
+  std::string line;
+  if (!std::getline(f, line) || line != kSignature) {
+    return std::nullopt;
+  }
+
+  std::vector<Record> records;
+  while (std::getline(f, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    auto fields = splitFields(line);
+    if (fields.size() != 6) {
+      return std::nullopt;
+    }
+    Record record;
+    record.id = fields[0];
+    record.name = fields[1];
+    record.path = fields[5];
+    if (record.id.empty() || record.path.empty() ||
+        !parseNumber(fields[2], record.entryCount, 10) ||
+        !parseNumber(fields[3], record.size, 10) ||
+        !parseNumber(fields[4], record.modificationTime, 10)) {
+      return std::nullopt;
+    }
+    records.push_back(std::move(record));
+  }
+  return records;
+}
+
+bool write(const std::string& path, const std::vector<Record>& records) {
+  std::ofstream f(path, std::ios::trunc);
+  if (!f.is_open()) {
+    return false;
+  }
+  f << kSignature << "\n";
+  f << "# id\tname\tentries\tsize\tmtime\tpath\n";
+  for (const auto& record : records) {
+    f << record.id << "\t" << record.name << "\t" << record.entryCount << "\t"
+      << record.size << "\t" << record.modificationTime << "\t" << record.path
+      << "\n";
+  }
+  return f.good();
+}
+
+bool stat(const std::string& path, Record& record) {
+  std::error_code ec;
+  auto size = std::filesystem::file_size(path, ec);
+  if (ec) {
+    return false;
+  }
+  auto time = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return false;
+  }
+  record.size = size;
+  record.modificationTime =
+      std::chrono::duration_cast<std::chrono::seconds>(
+          std::chrono::file_clock::to_sys(time).time_since_epoch())
+          .count();
+  return true;
+}
+
+bool matches(const std::string& path, const Record& record) {
+  Record current;
+  return stat(path, current) && current.size == record.size &&
+         current.modificationTime == record.modificationTime;
+}
+
+uint64_t checksum(const char* data, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+}  // namespace TableManifest
+}  // namespace McFoxIM
@@ -0,0 +1,102 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef TABLEMANIFEST_H_
+#define TABLEMANIFEST_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace McFoxIM {
+
+/**
+ * The table manifest lists every table installed in a data directory, so the
+ * tables can be enumerated without opening them. It is generated by
+ * fox-tablec at build time. A table whose size or modification time no
+ * longer matches is probed as if it were not listed.
+ *
+ * The manifest is a UTF-8 text file. Lines starting with '#' are comments,
+ * and the first line must be the signature below. Every other line is a
+ * record of tab-separated fields:
+ *
+ *   id  name  entry count  size  modification time  path relative to the
+ *   manifest
+ *
+ * The modification time is in seconds since the Unix epoch.
+ */
+namespace TableManifest {
+
+constexpr const char* kFileName = "tables.manifest";
+constexpr const char* kSignature = "# McFoxIM table manifest 2";
+
+struct Record {
+  std::string id;
+  std::string name;
+  uint32_t entryCount = 0;
+  uint64_t size = 0;
+  int64_t modificationTime = 0;
+  std::string path;
+};
+
+/**
+ * Reads a manifest.
+ *
+ * @param path The path of the manifest.
+ * @returns The records, or std::nullopt if the manifest is missing or
+ * malformed.
+ */
+std::optional<std::vector<Record>> read(const std::string& path);
+
+/**
+ * Writes a manifest.
+ *
+ * @param path The path of the manifest.
+ * @param records The records to write.
+ * @returns true on success.
+ */
+bool write(const std::string& path, const std::vector<Record>& records);
+
+/**
+ * Reads the size and modification time of a table file into a record.
+ *
+ * @returns false if the file cannot be read.
+ */
+bool stat(const std::string& path, Record& record);
+
+/**
+ * Whether a table file still has the size and modification time recorded in
+ * the manifest. Only the file's metadata is read.
+ */
+bool matches(const std::string& path, const Record& record);
+
+/**
+ * Computes a 64-bit FNV-1a hash, which names the files of the index cache.
+ */
+uint64_t checksum(const char* data, size_t size);
+
+}  // namespace TableManifest
+}  // namespace McFoxIM
+
+#endif  // TABLEMANIFEST_H_
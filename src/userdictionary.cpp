@@ -0,0 +1,374 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#include "userdictionary.h"
+
+#include <fcitx-utils/log.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include "tableformat.h"
+
+namespace McFoxIM {
+
+namespace {
+
+constexpr std::string_view kJournalExtension = ".journal";
+constexpr std::string_view kCompactingExtension = ".journal.compacting";
+// Named so that it loads as a compiled table.
+constexpr std::string_view kMergingExtension = ".merging.table";
+
+// Journal lines are "phrase\tdescription\n".
+bool isValidField(std::string_view field) {
+  return field.find_first_of("\t\n") == std::string_view::npos;
+}
+
+// Calls visit(phrase, description) for every word in a journal. A last line
+// without a line break was cut short by a crash and is skipped.
+template <typename Visitor>
+void readJournal(const std::string& path, Visitor&& visit) {
+  std::ifstream f(path, std::ios::binary);
+  std::string line;
+  while (std::getline(f, line) && !f.eof()) {
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos || tab == 0) {
+      continue;
+    }
+    std::string_view view(line);
+    visit(view.substr(0, tab), view.substr(tab + 1));
+  }
+}
+
+}  // namespace
+
+UserDictionary::UserDictionary(std::string directory, std::string id)
+    : directory_(std::move(directory)), id_(std::move(id)) {
+  std::string runPath = path(TableFormat::kFileExtension);
+  std::error_code ec;
+  if (std::filesystem::exists(runPath, ec)) {
+    auto run = std::make_shared<InputTable>();
+    if (run->load(runPath)) {
+      run_ = std::move(run);
+    }
+  }
+  recoverJournal();
+  replayJournal();
+}
+
+UserDictionary::~UserDictionary() {
+  if (journal_ >= 0) {
+    close(journal_);
+  }
+}
+
+void UserDictionary::setScheduler(Scheduler scheduler) {
+  scheduler_ = std::move(scheduler);
+}
+
+std::string UserDictionary::path(std::string_view extension) const {
+  return (std::filesystem::path(directory_) / (id_ + std::string(extension)))
+      .string();
+}
+
+void UserDictionary::recoverJournal() {
+  // A merge that did not finish leaves the journal of its words behind. They
+  // are older than the words in the journal, so they go in front of them.
+  std::string compactingPath = path(kCompactingExtension);
+  std::error_code ec;
+  if (!std::filesystem::exists(compactingPath, ec)) {
+    return;
+  }
+  std::string journalPath = path(kJournalExtension);
+  std::string recoveredPath = journalPath + ".tmp";
+  {
+    std::ofstream out(recoveredPath, std::ios::binary | std::ios::trunc);
+    for (const auto& input : {compactingPath, journalPath}) {
+      std::ifstream in(input, std::ios::binary);
+      if (in.is_open()) {
+        out << in.rdbuf();
+      }
+    }
+    if (!out.good()) {
+      FCITX_WARN() << "Failed to recover the journal of " << id_;
+      return;
+    }
+  }
+  std::filesystem::rename(recoveredPath, journalPath, ec);
+  if (!ec) {
+    std::filesystem::remove(compactingPath, ec);
+  }
+}
+
+void UserDictionary::replayJournal() {
+  // Words of an interrupted merge may already be in the run.
+  readJournal(path(kJournalExtension),
+              [this](std::string_view phrase, std::string_view description) {
+                if (!contains(phrase, description)) {
+                  memtable_.emplace(phrase, description);
+                }
+              });
+}
+
+bool UserDictionary::appendToJournal(std::string_view phrase,
+                                     std::string_view description) {
+  if (journal_ < 0) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+    journal_ = open(path(kJournalExtension).c_str(),
+                    O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (journal_ < 0) {
+      FCITX_WARN() << "Failed to open the journal of " << id_;
+      return false;
+    }
+  }
+  // One write per word, so that a crash cuts off at most the last line. The
+  // page cache is not flushed, which would stall typing.
+  std::string line;
+  line.reserve(phrase.size() + description.size() + 2);
+  line.append(phrase).append(1, '\t').append(description).append(1, '\n');
+  return write(journal_, line.data(), line.size()) ==
+         static_cast<ssize_t>(line.size());
+}
+
+bool UserDictionary::add(std::string_view phrase,
+                         std::string_view description) {
+  if (phrase.empty() || !isValidField(phrase) || !isValidField(description)) {
+    return false;
+  }
+  if (contains(phrase, description)) {
+    return true;
+  }
+  if (!appendToJournal(phrase, description)) {
+    return false;
+  }
+  memtable_.emplace(phrase, description);
+  if (memtable_.size() >= kCompactionThreshold) {
+    compact();
+  }
+  return true;
+}
+
+bool UserDictionary::remove(std::string_view phrase) {
+  bool found =
+      memtable_.contains(phrase) || (frozen_ && frozen_->contains(phrase));
+  if (!found && run_) {
+    auto [first, last] = run_->equalRange(phrase);
+    found = first < last;
+  }
+  if (!found) {
+    return false;
+  }
+
+  std::vector<InputTable::Entry> entries;
+  if (run_) {
+    std::string buffer;
+    for (size_t i = 0; i < run_->size(); ++i) {
+      std::string_view runPhrase = run_->phraseAt(i, buffer);
+      if (runPhrase != phrase) {
+        entries.push_back({std::string(runPhrase),
+                           std::string(run_->descriptionAt(i))});
+      }
+    }
+  }
+  for (const Memtable* memtable : {frozen_.get(), &std::as_const(memtable_)}) {
+    if (!memtable) {
+      continue;
+    }
+    for (const auto& [wordPhrase, description] : *memtable) {
+      if (wordPhrase != phrase) {
+        entries.push_back({wordPhrase, description});
+      }
+    }
+  }
+
+  std::string runPath = path(TableFormat::kFileExtension);
+  std::shared_ptr<InputTable> run;
+  std::error_code ec;
+  bool written = true;
+  if (entries.empty()) {
+    written = !std::filesystem::exists(runPath, ec) ||
+              std::filesystem::remove(runPath, ec);
+  } else {
+    InputTable merged;
+    merged.assign(id_, entries);
+    run = std::make_shared<InputTable>();
+    written = TableFormat::write(merged, runPath) && run->load(runPath);
+  }
+  if (!written) {
+    FCITX_WARN() << "Failed to remove a word from the user dictionary of "
+                 << id_;
+    return false;
+  }
+
+  // Every word left is in the new run. A crash before the journals are gone
+  // only brings back the removed word, if it was in them.
+  if (journal_ >= 0) {
+    close(journal_);
+    journal_ = -1;
+  }
+  std::filesystem::remove(path(kJournalExtension), ec);
+  std::filesystem::remove(path(kCompactingExtension), ec);
+  run_ = std::move(run);
+  frozen_.reset();
+  memtable_.clear();
+  ++generation_;
+  return true;
+}
+
+bool UserDictionary::contains(std::string_view phrase,
+                              std::string_view description) const {
+  if (run_) {
+    auto [first, last] = run_->equalRange(phrase);
+    for (size_t i = first; i < last; ++i) {
+      if (run_->descriptionAt(i) == description) {
+        return true;
+      }
+    }
+  }
+  for (const auto* memtable : {frozen_.get(), &memtable_}) {
+    if (!memtable) {
+      continue;
+    }
+    auto [first, last] = memtable->equal_range(phrase);
+    for (auto word = first; word != last; ++word) {
+      if (word->second == description) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+size_t UserDictionary::size() const {
+  return (run_ ? run_->size() : 0) + (frozen_ ? frozen_->size() : 0) +
+         memtable_.size();
+}
+
+void UserDictionary::compact() {
+  if (frozen_ || memtable_.empty()) {
+    return;
+  }
+
+  // The journal of the frozen words is kept until their run is written.
+  if (journal_ >= 0) {
+    close(journal_);
+    journal_ = -1;
+  }
+  std::string compactingPath = path(kCompactingExtension);
+  std::error_code ec;
+  std::filesystem::rename(path(kJournalExtension), compactingPath, ec);
+  if (ec) {
+    FCITX_WARN() << "Failed to start merging the user dictionary of " << id_;
+    return;
+  }
+  frozen_ = std::make_shared<const Memtable>(std::move(memtable_));
+  memtable_.clear();
+
+  // The run is written next to the current one, which is put in its place
+  // on the thread that uses the dictionary.
+  auto merge = [run = run_, frozen = frozen_, name = id_,
+                mergingPath = path(kMergingExtension)]()
+      -> std::shared_ptr<const InputTable> {
+    // The older words come first, and the table keeps the order of equal
+    // phrases.
+    std::vector<InputTable::Entry> entries;
+    entries.reserve((run ? run->size() : 0) + frozen->size());
+    if (run) {
+      for (size_t i = 0; i < run->size(); ++i) {
+        entries.push_back(
+            {run->decodePhraseAt(i), std::string(run->descriptionAt(i))});
+      }
+    }
+    for (const auto& [phrase, description] : *frozen) {
+      entries.push_back({phrase, description});
+    }
+    InputTable merged;
+    merged.assign(name, entries);
+
+    auto table = std::make_shared<InputTable>();
+    if (!TableFormat::write(merged, mergingPath) || !table->load(mergingPath)) {
+      return nullptr;
+    }
+    return table;
+  };
+
+  if (!scheduler_) {
+    onCompacted(merge(), generation_);
+    return;
+  }
+  worker_.post([this, merge, scheduler = scheduler_, generation = generation_,
+                lifetime = std::weak_ptr<int>(lifetime_)]() {
+    std::shared_ptr<const InputTable> run = merge();
+    scheduler([this, lifetime, run, generation]() {
+      if (!lifetime.expired()) {
+        onCompacted(run, generation);
+      }
+    });
+  });
+}
+
+void UserDictionary::onCompacted(std::shared_ptr<const InputTable> run,
+                                 uint64_t generation) {
+  std::error_code ec;
+  if (generation != generation_) {
+    // remove() rewrote the dictionary while the merge ran, so its run is out
+    // of date. A merge started since then writes the same file.
+    if (!frozen_) {
+      std::filesystem::remove(path(kMergingExtension), ec);
+    }
+    return;
+  }
+  if (run) {
+    std::filesystem::rename(path(kMergingExtension),
+                            path(TableFormat::kFileExtension), ec);
+    if (!ec) {
+      std::filesystem::remove(path(kCompactingExtension), ec);
+      run_ = std::move(run);
+      frozen_.reset();
+      return;
+    }
+    run.reset();
+  }
+
+  FCITX_WARN() << "Failed to merge the user dictionary of " << id_;
+  // Keep the frozen words in front of the newer ones, in memory and in the
+  // journal.
+  Memtable memtable = *frozen_;
+  for (auto& word : memtable_) {
+    memtable.insert(std::move(word));
+  }
+  memtable_ = std::move(memtable);
+  frozen_.reset();
+  if (journal_ >= 0) {
+    close(journal_);
+    journal_ = -1;
+  }
+  recoverJournal();
+}
+
+}  // namespace McFoxIM
@@ -0,0 +1,140 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+
+#ifndef USERDICTIONARY_H_
+#define USERDICTIONARY_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "inputtable.h"
+#include "worker.h"
+
+namespace McFoxIM {
+
+/**
+ * The words a user adds to the table of one dialect, kept apart from the
+ * table so that adding a word never rebuilds it.
+ *
+ * New words go into a sorted in-memory memtable and are appended to a
+ * journal file, so they survive a restart. Once enough words have been
+ * added, or when compact() is called, the memtable is frozen and merged with
+ * the sorted run of older words on a background thread, and the new run is
+ * written as a compiled table. Until the merge is done, the frozen memtable
+ * is still read.
+ *
+ * The files of a dictionary are <id>.journal, <id>.table (the run) and,
+ * while a merge is running, <id>.journal.compacting, which holds the journal
+ * of the frozen memtable, and <id>.merging.table, the new run.
+ *
+ * A dictionary is used on one thread; only the merge runs elsewhere.
+ */
+class UserDictionary {
+ public:
+  // Equal phrases keep the order they were added in.
+  using Memtable = std::multimap<std::string, std::string, std::less<>>;
+  using Scheduler = std::function<void(std::function<void()>)>;
+
+  // Memtable size that triggers a merge.
+  static constexpr size_t kCompactionThreshold = 256;
+
+  /**
+   * Opens the dictionary and replays its journal.
+   *
+   * @param directory The directory of the files, created on the first add.
+   * @param id The id of the table, which names the files.
+   */
+  UserDictionary(std::string directory, std::string id);
+  ~UserDictionary();
+  UserDictionary(const UserDictionary&) = delete;
+  UserDictionary& operator=(const UserDictionary&) = delete;
+
+  /**
+   * Runs merges on a background thread. The scheduler hands the new run back
+   * to the thread that uses the dictionary. Without one, merges run on the
+   * calling thread.
+   */
+  void setScheduler(Scheduler scheduler);
+
+  /**
+   * Adds a word. Words that are already in the dictionary are ignored.
+   *
+   * @param phrase The phrase, without tabs or line breaks.
+   * @param description The description, without tabs or line breaks.
+   * @returns false if the word cannot be added.
+   */
+  bool add(std::string_view phrase, std::string_view description = {});
+  bool contains(std::string_view phrase, std::string_view description) const;
+
+  /**
+   * Removes the words with the given phrase. Words are removed rarely, so
+   * the dictionary is rewritten without them at once rather than keeping
+   * tombstones that every lookup would have to skip. A running merge is
+   * dropped, since its words are in the new run.
+   *
+   * @returns false if no word has the phrase or the dictionary cannot be
+   * rewritten.
+   */
+  bool remove(std::string_view phrase);
+
+  /** Starts a merge, unless the memtable is empty or a merge is running. */
+  void compact();
+  bool isCompacting() const { return frozen_ != nullptr; }
+
+  /** The number of words. */
+  size_t size() const;
+
+  // The parts to read, from the oldest words to the newest. run() and
+  // frozen() may be nullptr.
+  const InputTable* run() const { return run_.get(); }
+  const Memtable* frozen() const { return frozen_.get(); }
+  const Memtable& memtable() const { return memtable_; }
+
+ private:
+  std::string path(std::string_view extension) const;
+  void recoverJournal();
+  void replayJournal();
+  bool appendToJournal(std::string_view phrase, std::string_view description);
+  void onCompacted(std::shared_ptr<const InputTable> run, uint64_t generation);
+
+  std::string directory_;
+  std::string id_;
+  std::shared_ptr<const InputTable> run_;
+  std::shared_ptr<const Memtable> frozen_;
+  Memtable memtable_;
+  // Counts the rewrites by remove(), which outdate a running merge.
+  uint64_t generation_ = 0;
+  int journal_ = -1;
+  Scheduler scheduler_;
+  // Lets scheduled callbacks detect that the dictionary is gone.
+  std::shared_ptr<int> lifetime_ = std::make_shared<int>(0);
+  Worker worker_;
+};
+
+}  // namespace McFoxIM
+
+#endif  // USERDICTIONARY_H_
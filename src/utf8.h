@@ -0,0 +1,65 @@
+// Copyright (c) 2025 and onwards The McFoxxIM Authors.
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+#ifndef UTF8_H_
+#define UTF8_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace McFoxIM {
+
+/** Decoding of the UTF-8 phrases and descriptions of the tables. */
+namespace Utf8 {
+
+/** Whether a byte starts a character, rather than continuing one. */
+inline bool startsCharacter(char byte) {
+  return (static_cast<uint8_t>(byte) & 0xc0) != 0x80;
+}
+
+/**
+ * Decodes the character at text[pos] and moves pos past it. A byte that
+ * does not start a valid character stands for itself.
+ */
+inline uint32_t nextCharacter(std::string_view text, size_t& pos) {
+  auto byte = static_cast<uint8_t>(text[pos++]);
+  size_t length = byte >= 0xf0 ? 3 : byte >= 0xe0 ? 2 : byte >= 0xc0 ? 1 : 0;
+  if (length == 0 || pos + length > text.size()) {
+    return byte;
+  }
+  uint32_t character = byte & (0x3f >> length);
+  for (size_t i = 0; i < length; ++i) {
+    auto next = static_cast<uint8_t>(text[pos + i]);
+    if ((next & 0xc0) != 0x80) {
+      return byte;
+    }
+    character = (character << 6) | (next & 0x3f);
+  }
+  pos += length;
+  return character;
+}
+
+}  // namespace Utf8
+}  // namespace McFoxIM
+
+#endif  // UTF8_H_
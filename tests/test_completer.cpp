@@ -2,11 +2,18 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <span>
 
 #include "../src/completer.h"
 #include "../src/inputtable.h"
+#include "../src/userdictionary.h"
 
 using namespace McFoxIM;
 
@@ -33,11 +40,11 @@ void testCompleter() {
   std::string testFile = "test_data.json";
   createTestFile(testFile);
 
-  InputTable table;
-  bool loaded = table.load(testFile);
+  auto table = std::make_shared<InputTable>();
+  bool loaded = table->load(testFile);
   assert(loaded && "Failed to load test data");
 
-  Completer completer([&table]() -> const InputTable& { return table; });
+  Completer completer([table]() { return table; });
 
   // Test exact match and sorting by length
   auto results = completer.complete("a");
@@ -77,7 +84,438 @@ void testCompleter() {
   std::cout << "All tests passed!" << std::endl;
 }
 
+void testCaseVariants() {
+  std::string testFile = "test_case_variants.json";
+  {
+    std::ofstream out(testFile);
+    out << R"({
+        "name": "CaseVariants",
+        "data": [
+            ["ana", "Y"],
+            ["aNa", "X"],
+            ["anb", "W"],
+            ["ana", "Z"],
+            ["aNA", "V"]
+        ]
+    })";
+  }
+
+  auto table = std::make_shared<InputTable>();
+  assert(table->load(testFile));
+  auto compressed = std::make_shared<InputTable>();
+  assert(compressed->load(testFile));
+  compressed->compressKeys();
+
+  for (const auto& source : {table, compressed}) {
+    Completer completer([source]() { return source; });
+    // Phrases that differ only in case join the first of them in byte order.
+    auto results = completer.complete("a");
+    assert(results.size() == 2);
+    assert(results[0].displayText() == "aNA");
+    assert(results[0].description() == "V/X/Y/Z");
+    assert(results[1].displayText() == "anb");
+    assert(results[1].description() == "W");
+
+    results = completer.complete("an");
+    assert(results.size() == 2);
+    assert(results[0].displayText() == "ana");
+    assert(results[0].description() == "Y/Z");
+  }
+
+  std::filesystem::remove(testFile);
+  std::cout << "Case variants test passed" << std::endl;
+}
+
+void testUserDictionary() {
+  auto dir = std::filesystem::temp_directory_path() / "fox_test_user";
+  std::filesystem::remove_all(dir);
+
+  {
+    UserDictionary dictionary(dir.string(), "TW_Test");
+    assert(dictionary.size() == 0);
+    assert(dictionary.add("kakay", "N1"));
+    assert(dictionary.add("kakay", "N1"));  // already there
+    assert(dictionary.add("kakay", "N2"));
+    assert(dictionary.add("nanay"));
+    assert(dictionary.size() == 3);
+    assert(dictionary.contains("kakay", "N2"));
+  }
+
+  // The journal is replayed on open, and a torn last line is dropped.
+  {
+    std::ofstream(dir / "TW_Test.journal", std::ios::app) << "torn";
+    UserDictionary dictionary(dir.string(), "TW_Test");
+    assert(dictionary.size() == 3);
+    assert(dictionary.memtable().size() == 3);
+    assert(!dictionary.run());
+
+    // Without a scheduler, a merge finishes at once.
+    dictionary.compact();
+    assert(!dictionary.isCompacting());
+    assert(dictionary.memtable().empty());
+    assert(dictionary.run() && dictionary.run()->size() == 3);
+    assert(!std::filesystem::exists(dir / "TW_Test.journal"));
+    assert(dictionary.add("kakay", "N3"));
+    assert(!dictionary.add("", "N4"));
+  }
+
+  // The run and the journal are both read back.
+  {
+    UserDictionary dictionary(dir.string(), "TW_Test");
+    assert(dictionary.size() == 4);
+    assert(dictionary.run()->size() == 3);
+    assert(dictionary.contains("kakay", "N3"));
+  }
+
+  // Removing a word rewrites the run without it, whichever part it was in.
+  {
+    UserDictionary dictionary(dir.string(), "TW_Test");
+    assert(!dictionary.remove("mama"));
+    assert(dictionary.remove("kakay"));
+    assert(dictionary.size() == 1);
+    assert(dictionary.memtable().empty());
+    assert(dictionary.contains("nanay", ""));
+    assert(!std::filesystem::exists(dir / "TW_Test.journal"));
+    assert(dictionary.add("kakay", "N5"));
+    assert(dictionary.add("kakay", "N6"));
+  }
+  {
+    UserDictionary dictionary(dir.string(), "TW_Test");
+    assert(dictionary.size() == 3);
+    assert(!dictionary.contains("kakay", "N1"));
+    assert(dictionary.contains("kakay", "N6"));
+  }
+
+  // A merge that did not finish is done again from its journal.
+  std::filesystem::rename(dir / "TW_Test.journal",
+                          dir / "TW_Test.journal.compacting");
+  std::ofstream(dir / "TW_Test.journal") << "mama\tM\n";
+  {
+    UserDictionary dictionary(dir.string(), "TW_Test");
+    assert(dictionary.size() == 4);
+    assert(dictionary.contains("kakay", "N6"));
+    assert(dictionary.contains("mama", "M"));
+  }
+
+  std::filesystem::remove_all(dir);
+  std::cout << "User dictionary test passed" << std::endl;
+}
+
+void testUserDictionaryMerge() {
+  auto dir = std::filesystem::temp_directory_path() / "fox_test_user_merge";
+  std::filesystem::remove_all(dir);
+
+  std::vector<InputTable::Entry> system = {
+      {"a", "A"},     {"ab", "AB"},  {"dup", "D1"}, {"dup", "D2"},
+      {"ana", "Y"},   {"aNa", "X"},  {"long", "L"},
+  };
+  std::vector<InputTable::Entry> words = {
+      {"dup", "D3"}, {"abd", "ABD"}, {"ANA", "U"},
+      {"ab", "AB2"}, {"lo", "LO"},   {"anc", "C"},
+  };
+
+  auto table = std::make_shared<InputTable>();
+  table->assign("System", system);
+  UserDictionary dictionary(dir.string(), "TW_Test");
+
+  // The merged candidates are those of a table with the user's words added
+  // at its end, whether the words are in the run, frozen, or new.
+  auto check = [&](size_t added) {
+    std::vector<InputTable::Entry> all = system;
+    all.insert(all.end(), words.begin(), words.begin() + added);
+    auto expected = std::make_shared<InputTable>();
+    expected->assign("Union", all);
+    Completer reference([expected]() { return expected; });
+    Completer completer([table]() { return table; });
+    completer.setUserDictionaryProvider([&]() { return &dictionary; });
+    for (const char* prefix : {"a", "A", "an", "d", "l", "lo", "x"}) {
+      auto results = completer.complete(prefix);
+      auto want = reference.complete(prefix);
+      assert(results.size() == want.size());
+      for (size_t i = 0; i < want.size(); ++i) {
+        assert(results[i].displayText() == want[i].displayText());
+        assert(results[i].description() == want[i].description());
+      }
+    }
+  };
+
+  check(0);
+  for (size_t i = 0; i < words.size(); ++i) {
+    assert(dictionary.add(words[i].phrase, words[i].description));
+    if (i == 2) {
+      dictionary.compact();
+    }
+    check(i + 1);
+  }
+
+  // A merge that has not been handed back yet still reads the frozen words.
+  std::mutex mutex;
+  std::vector<std::function<void()>> pending;
+  dictionary.setScheduler([&](std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(callback);
+  });
+  auto runPending = [&]() {
+    std::vector<std::function<void()>> callbacks;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      callbacks.swap(pending);
+    }
+    for (auto& callback : callbacks) {
+      callback();
+    }
+    return !callbacks.empty();
+  };
+  dictionary.compact();
+  while (dictionary.isCompacting()) {
+    check(words.size());
+    runPending();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  check(words.size());
+  assert(dictionary.memtable().empty());
+
+  // A word removed while a merge runs stays removed when the merge is
+  // handed back.
+  assert(dictionary.add("gone", "G"));
+  dictionary.compact();
+  assert(dictionary.remove("gone"));
+  assert(!dictionary.isCompacting());
+  while (!runPending()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  assert(!dictionary.contains("gone", "G"));
+  check(words.size());
+  assert(!std::filesystem::exists(dir / "TW_Test.merging.table"));
+
+  std::filesystem::remove_all(dir);
+  std::cout << "User dictionary merge test passed" << std::endl;
+}
+
+void testUnion() {
+  auto first = std::make_shared<InputTable>();
+  first->assign("First", {{"adada", "痛"}, {"aca", "僅僅"}});
+  auto second = std::make_shared<InputTable>();
+  second->assign("Second",
+                 {{"adada", "痛"}, {"adada", "生病"}, {"aa", "鴨"}, {"b", "B"}});
+  auto table = InputTable::unionOf(
+      "Union", {{"南勢", first}, {"秀姑巒", second}});
+
+  // The members are merged in phrase order, and equal phrases list the
+  // descriptions of the members in order.
+  Completer completer([table]() { return table; });
+  auto results = completer.complete("a");
+  assert(results.size() == 3);
+  assert(results[0].displayText() == "aa");
+  assert(results[0].description() == "鴨（秀姑巒）");
+  assert(results[1].displayText() == "aca");
+  assert(results[1].description() == "僅僅（南勢）");
+  assert(results[2].displayText() == "adada");
+  assert(results[2].description() == "痛（南勢）/痛（秀姑巒）/生病（秀姑巒）");
+  assert(completer.complete("c").empty());
+
+  results = completer.complete("B");
+  assert(results.size() == 1);
+  assert(results[0].displayText() == "B");
+  assert(results[0].description() == "B（秀姑巒）");
+
+  std::cout << "Union test passed" << std::endl;
+}
+
+void testCompleteFirst() {
+  // Many phrases under short prefixes, with duplicates and case variants.
+  std::vector<InputTable::Entry> entries;
+  for (int i = 0; i < 400; ++i) {
+    std::string phrase = "a" + std::to_string(i * 13 % 97);
+    if (i % 3 == 0) {
+      phrase = "ba" + phrase;
+    }
+    entries.push_back({phrase, std::to_string(i)});
+  }
+  for (const char* phrase : {"aNa", "ana", "ANA", "ba", "Ba", "bana"}) {
+    entries.push_back({phrase, phrase});
+  }
+  auto table = std::make_shared<InputTable>();
+  table->assign("Ranked", entries);
+  std::span<const uint32_t> ranked;
+  assert(table->rankedEntries("a", ranked));
+  assert(ranked.size() == InputTable::kRankedCount);
+  assert(!table->rankedEntries("a12", ranked));
+
+  // The first candidates are those of a full completion, and so are the
+  // rest.
+  Completer completer([table]() { return table; });
+  auto check = [&](const std::string& prefix) {
+    auto all = completer.complete(prefix);
+    auto first = completer.completeFirst(prefix, 9);
+    assert(first.candidates.size() >= std::min<size_t>(9, all.size()));
+    for (size_t i = 0; i < first.candidates.size(); ++i) {
+      assert(first.candidates[i].displayText() == all[i].displayText());
+      assert(first.candidates[i].description() == all[i].description());
+    }
+    auto rest = first.completeAll ? first.completeAll() : first.candidates;
+    assert(rest.size() == all.size());
+    for (size_t i = 0; i < all.size(); ++i) {
+      assert(rest[i].displayText() == all[i].displayText());
+      assert(rest[i].description() == all[i].description());
+    }
+  };
+  for (const auto& entry : entries) {
+    for (size_t length = 1; length <= entry.phrase.size(); ++length) {
+      check(entry.phrase.substr(0, length));
+    }
+  }
+  check("x");
+
+  std::cout << "Complete first test passed" << std::endl;
+}
+
+void testCompleteInfix() {
+  std::vector<InputTable::Entry> entries = {
+      {"abura’", "油"}, {"Bura", "B"},   {"bura", "b1"},
+      {"bura", "b2"},   {"taburak", "X"}, {"xyz", "Y"}};
+  for (int i = 0; i < 200; ++i) {
+    entries.push_back({"ka" + std::to_string(i * 7 % 200), std::to_string(i)});
+  }
+  auto table = std::make_shared<InputTable>();
+  table->assign("Infix", entries);
+  Completer completer([table]() { return table; });
+
+  // Shorter phrases first, with case variants merged, with or without the
+  // index.
+  for (bool indexed : {false, true}) {
+    if (indexed) {
+      table->buildInfixIndex();
+    }
+    auto completion = completer.completeInfix("ura", 9);
+    assert(!completion.completeAll);
+    const auto& results = completion.candidates;
+    assert(results.size() == 3);
+    assert(results[0].displayText() == "Bura");
+    assert(results[0].description() == "B/b1/b2");
+    assert(results[1].displayText() == "taburak");
+    assert(results[2].displayText() == "abura’");
+    assert(completer.completeInfix("q", 9).candidates.empty());
+    assert(completer.completeInfix("", 9).candidates.empty());
+
+    // The first page is the start of all of them.
+    completion = completer.completeInfix("a1", 9);
+    assert(completion.candidates.size() == 9);
+    assert(completion.completeAll);
+    auto all = completion.completeAll();
+    assert(all.size() == 111);
+    for (size_t i = 0; i < completion.candidates.size(); ++i) {
+      assert(completion.candidates[i].displayText() == all[i].displayText());
+      assert(completion.candidates[i].description() == all[i].description());
+    }
+    assert(all[0].displayText() == "ka1");
+    assert(all[1].displayText() == "ka10");
+  }
+
+  // The members of a union are searched in order.
+  auto other = std::make_shared<InputTable>();
+  other->assign("Other", {{"bura", "b3"}, {"burak", "Z"}});
+  other->buildInfixIndex();
+  auto both = InputTable::unionOf("Union", {{"甲", table}, {"乙", other}});
+  Completer unionCompleter([both]() { return both; });
+  auto results = unionCompleter.completeInfix("ura", 9).candidates;
+  assert(results.size() == 4);
+  assert(results[0].displayText() == "Bura");
+  assert(results[0].description() == "B（甲）/b1（甲）/b2（甲）/b3（乙）");
+  assert(results[1].displayText() == "burak");
+  assert(results[1].description() == "Z（乙）");
+
+  std::cout << "Complete infix test passed" << std::endl;
+}
+
+void testCompleteGloss() {
+  auto first = std::make_shared<InputTable>();
+  first->assign("First", {{"icing", "冰箱"},
+                          {"ising", "電冰箱"},
+                          {"ising", "冰箱"},
+                          {"tatiih", "壞"}});
+  auto second = std::make_shared<InputTable>();
+  second->assign("Second", {{"pala", "電冰箱的門"}, {"sadak", "出來"}});
+  Completer completer([first]() { return first; });
+
+  // Words with shorter glosses first, each with the glosses that matched.
+  auto results = completer.completeGloss("冰箱");
+  assert(results.size() == 2);
+  assert(results[0].displayText() == "icing");
+  assert(results[0].description() == "冰箱");
+  assert(results[1].displayText() == "ising");
+  assert(results[1].description() == "電冰箱/冰箱");
+  results = completer.completeGloss("電");
+  assert(results.size() == 1);
+  assert(results[0].displayText() == "ising");
+  assert(completer.completeGloss("箱電").empty());
+  assert(completer.completeGloss("").empty());
+
+  // The members of a union mark their glosses.
+  auto table = InputTable::unionOf("Union", {{"甲", first}, {"乙", second}});
+  Completer unionCompleter([table]() { return table; });
+  results = unionCompleter.completeGloss("電冰箱");
+  assert(results.size() == 2);
+  assert(results[0].displayText() == "ising");
+  assert(results[0].description() == "電冰箱（甲）");
+  assert(results[1].displayText() == "pala");
+  assert(results[1].description() == "電冰箱的門（乙）");
+
+  std::cout << "Complete gloss test passed" << std::endl;
+}
+
+void testCompleteFuzzy() {
+  auto table = std::make_shared<InputTable>();
+  table->assign("Fuzzy", {{"abura’", "油"},
+                          {"aburaan", "油的"},
+                          {"Abura’", "人名"},
+                          {"kaaw", "白"},
+                          {"kaawan", "白的"},
+                          {"malikaka", "兄弟姊妹"}});
+  Completer completer([table]() { return table; });
+
+  // Nothing is suggested unless the fallback is on.
+  assert(completer.complete("abora").empty());
+  assert(completer.completeFirst("abora", 9).candidates.empty());
+  completer.setFuzzyBudget(std::chrono::seconds(1));
+
+  // Apostrophes and case are not typos, and nearer phrases come first,
+  // then shorter ones.
+  auto results = completer.complete("abura'");
+  assert(results.size() == 2);
+  assert(results[0].displayText() == "Abura’");
+  assert(results[0].description() == "人名/油");
+  assert(results[1].displayText() == "aburaan");
+  results = completer.completeFirst("abora", 9).candidates;
+  assert(results.size() == 2);
+  assert(results[0].displayText() == "aburaan");
+  assert(results[1].displayText() == "Abura’");
+
+  // One typo in a short prefix, and two in a long one.
+  assert(completer.complete("kaw").size() == 2);
+  assert(completer.complete("kw").empty());
+  results = completer.complete("malikeke");
+  assert(results.size() == 1);
+  assert(results[0].displayText() == "malikaka");
+  assert(completer.complete("kawqq").empty());
+
+  // Prefixes that match are completed as before.
+  results = completer.complete("kaaw");
+  assert(results.size() == 2);
+  assert(results[0].displayText() == "kaaw");
+
+  std::cout << "Complete fuzzy test passed" << std::endl;
+}
+
 int main() {
   testCompleter();
+  testCaseVariants();
+  testUnion();
+  testUserDictionary();
+  testUserDictionaryMerge();
+  testCompleteFirst();
+  testCompleteInfix();
+  testCompleteGloss();
+  testCompleteFuzzy();
   return 0;
 }
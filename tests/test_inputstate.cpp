@@ -71,6 +71,25 @@ void testInputtingState() {
   assert(state->candidatePageIndex() == 2);
   assert(state->selectedCandidateIndexInCurrentPage() == 1); // 19 - 18 = 1
 
+  // Only the first page, with the rest completed when it is needed.
+  int completions = 0;
+  args.candidates.assign(manyCandidates.begin(), manyCandidates.begin() + 9);
+  args.completeAll = [&]() {
+    ++completions;
+    return manyCandidates;
+  };
+  args.selectedCandidateIndex = 0;
+  state = std::make_unique<InputtingState>(args);
+  assert(state->candidatesInCurrentPage().size() == 9);
+  assert(completions == 0);
+  assert(state->candidatePageCount() == 3);
+  assert(state->candidates().size() == 20);
+  assert(completions == 1);
+  args.selectedCandidateIndex = 10;
+  state = std::make_unique<InputtingState>(args);
+  assert(completions == 2);
+  assert(state->candidatesInCurrentPage()[0].displayText() == "9");
+
   std::cout << "InputtingState test passed" << std::endl;
 }
 
@@ -0,0 +1,821 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../src/inputtable.h"
+#include "../src/keyscan.h"
+#include "../src/levenshteinautomaton.h"
+#include "../src/tableformat.h"
+#include "../src/utf8.h"
+
+using namespace McFoxIM;
+
+void createTestFile(const std::string& filename) {
+  std::ofstream out(filename);
+  out << R"({
+        "name": "測試",
+        "data": [
+            ["b", "B"],
+            ["dup", "D1"],
+            ["a", "A"],
+            ["dup", "D2"],
+            ["abura’", "油"]
+        ]
+    })";
+  out.close();
+}
+
+void testCompiledTable() {
+  std::string jsonFile = "test_inputtable_data.json";
+  std::string tableFile = "test_inputtable_data.table";
+  createTestFile(jsonFile);
+
+  InputTable source;
+  assert(source.load(jsonFile));
+  assert(source.size() == 5);
+  assert(TableFormat::write(source, tableFile));
+
+  InputTable table;
+  assert(table.load(tableFile));
+  assert(table.name() == "測試");
+  assert(table.size() == 5);
+
+  // Sorted by phrase, duplicates keep their source order
+  assert(table.decodePhraseAt(0) == "a");
+  assert(table.decodePhraseAt(1) == "abura’");
+  assert(table.descriptionAt(1) == "油");
+  assert(table.decodePhraseAt(2) == "b");
+  assert(table.decodePhraseAt(3) == "dup");
+  assert(table.descriptionAt(3) == "D1");
+  assert(table.descriptionAt(4) == "D2");
+
+  auto [first, last] = table.equalRange("dup");
+  assert(last - first == 2);
+  assert(table.descriptionAt(first) == "D1");
+  assert(table.descriptionAt(first + 1) == "D2");
+  assert(table.equalRange("c").first == table.equalRange("c").second);
+
+  assert(table.prefixRange("a").first == 0);
+  assert(table.prefixRange("a").second == 2);
+  assert(table.prefixRange("abu").first == 1);
+  assert(table.prefixRange("abu").second == 2);
+  assert(table.prefixRange("c").first == 3);
+  assert(table.prefixRange("c").second == 3);
+  assert(table.equalRange("a").first == 0);
+  assert(table.equalRange("a").second == 1);
+  assert(table.equalRange("dup").first == 3);
+  assert(table.equalRange("dup").second == 5);
+
+  std::filesystem::remove(jsonFile);
+  std::filesystem::remove(tableFile);
+  std::cout << "Compiled table test passed" << std::endl;
+}
+
+void testJsonTable() {
+  std::string jsonFile = "test_inputtable_json.json";
+  {
+    std::ofstream out(jsonFile);
+    out << R"({
+        "data": [
+            ["b", "B", 3],
+            ["a"],
+            "not an item",
+            {"ignored": ["x", "y"]},
+            ["a", "A\u0041", null]
+        ],
+        "name": "Escaped \"name\""
+    })";
+  }
+
+  InputTable table;
+  assert(table.load(jsonFile));
+  assert(table.name() == "Escaped \"name\"");
+  assert(table.size() == 2);
+  assert(table.decodePhraseAt(0) == "a");
+  assert(table.descriptionAt(0) == "AA");
+  assert(table.decodePhraseAt(1) == "b");
+
+  {
+    std::ofstream out(jsonFile);
+    out << R"({"name": "Bad", "data": [["a", 1]]})";
+  }
+  assert(!table.load(jsonFile));
+  {
+    std::ofstream out(jsonFile);
+    out << R"({"name": "Truncated", "data": [["a", "A"])";
+  }
+  assert(!table.load(jsonFile));
+
+  // A failed load keeps the previous table
+  assert(table.size() == 2);
+
+  std::filesystem::remove(jsonFile);
+  std::cout << "JSON table test passed" << std::endl;
+}
+
+void testLargeUnsortedTable() {
+  // Large enough to be sorted on several threads.
+  std::string jsonFile = "test_inputtable_large.json";
+  constexpr int kCount = 100000;
+  {
+    std::ofstream out(jsonFile);
+    out << R"({"name": "Large", "data": [)";
+    for (int i = 0; i < kCount; ++i) {
+      // Every phrase appears twice, and the descriptions number the entries.
+      out << (i ? "," : "") << "[\"w" << (i * 7919) % (kCount / 2)
+          << "\", \"" << i << "\"]";
+    }
+    out << "]}";
+  }
+
+  InputTable table;
+  assert(table.load(jsonFile));
+  assert(table.size() == kCount);
+  for (size_t i = 1; i < table.size(); ++i) {
+    assert(table.decodePhraseAt(i - 1) <= table.decodePhraseAt(i));
+    if (table.decodePhraseAt(i - 1) == table.decodePhraseAt(i)) {
+      assert(std::stoi(std::string(table.descriptionAt(i - 1))) <
+             std::stoi(std::string(table.descriptionAt(i))));
+    }
+  }
+
+  std::filesystem::remove(jsonFile);
+  std::cout << "Large unsorted table test passed" << std::endl;
+}
+
+void testInvalidCompiledTable() {
+  std::string tableFile = "test_inputtable_invalid.table";
+  {
+    std::ofstream out(tableFile, std::ios::binary);
+    out << "FOXTABLE but not really a table";
+  }
+
+  InputTable table;
+  assert(!table.load(tableFile));
+  assert(!table.load("does_not_exist.table"));
+
+  std::filesystem::remove(tableFile);
+  std::cout << "Invalid compiled table test passed" << std::endl;
+}
+
+void testGlossDictionary() {
+  std::string jsonFile = "test_inputtable_glosses.json";
+  std::string tableFile = "test_inputtable_glosses.table";
+  createTestFile(jsonFile);
+  {
+    InputTable source;
+    assert(source.load(jsonFile));
+    assert(TableFormat::write(source, tableFile));
+  }
+
+  auto glosses = std::make_shared<GlossDictionary>();
+  assert(glosses->intern("B") == glosses->intern("B"));
+  assert(glosses->at(glosses->intern("D1")) == "D1");
+  assert(glosses->size() == 2);
+  std::string longGloss(10000, 'x');
+  uint32_t longId = glosses->intern(longGloss);
+  assert(glosses->at(longId) == longGloss);
+  assert(glosses->at(glosses->intern("D1")) == "D1");
+  assert(glosses->size() == 3);
+
+  // JSON tables share the glosses, and the unsorted JSON table is sorted
+  // along with its gloss ids. Compiled tables read their descriptions from
+  // the mapping, so loading and reloading them adds nothing.
+  InputTable json;
+  assert(json.load(jsonFile, glosses));
+  assert(glosses->size() == 6);
+  InputTable compiled;
+  assert(compiled.load(tableFile, glosses));
+  assert(compiled.load(tableFile, glosses));
+  assert(glosses->size() == 6);
+  for (const auto* table : {&json, &compiled}) {
+    assert(table->size() == 5);
+    assert(table->decodePhraseAt(1) == "abura’");
+    assert(table->descriptionAt(1) == "油");
+    assert(table->descriptionAt(2) == "B");
+    assert(table->descriptionAt(3) == "D1");
+    assert(table->descriptionAt(4) == "D2");
+  }
+  auto [first, last] = compiled.equalRange("dup");
+  assert(last - first == 2);
+  assert(compiled.descriptionAt(first + 1) == "D2");
+
+  // Written back out, a table carries its descriptions again.
+  assert(TableFormat::write(json, tableFile));
+  InputTable roundTrip;
+  assert(roundTrip.load(tableFile));
+  assert(roundTrip.descriptionAt(0) == "A");
+
+  std::filesystem::remove(jsonFile);
+  std::filesystem::remove(tableFile);
+  std::cout << "Gloss dictionary test passed" << std::endl;
+}
+
+void testCompressedKeys() {
+  std::string jsonFile = "test_inputtable_compressed.json";
+  std::string tableFile = "test_inputtable_compressed.table";
+  // Enough entries to span several blocks, with shared prefixes, duplicates
+  // and an empty phrase.
+  std::vector<std::string> phrases = {""};
+  for (const char* stem : {"a", "ab", "abaw", "abura’", "ana", "ana", "b",
+                           "bali", "caay", "ca", "ˈo", "tamdaw"}) {
+    for (int i = 0; i < 5; ++i) {
+      phrases.push_back(stem + std::string(i, 'a'));
+    }
+  }
+  {
+    std::ofstream out(jsonFile);
+    out << R"({"name": "Compressed", "data": [)";
+    for (size_t i = 0; i < phrases.size(); ++i) {
+      out << (i ? "," : "") << "[\"" << phrases[i] << "\", \"" << i
+          << "\"]";
+    }
+    out << "]}";
+  }
+  InputTable plain;
+  assert(plain.load(jsonFile));
+  assert(TableFormat::write(plain, tableFile));
+
+  InputTable json;
+  assert(json.load(jsonFile));
+  json.compressKeys();
+  InputTable compiled;
+  assert(compiled.load(tableFile));
+  compiled.compressKeys();
+  assert(compiled.hasCompressedKeys());
+  assert(json.memoryUsage() < plain.memoryUsage());
+
+  std::vector<std::string> queries = {"", "c", "zzz", "abx", "ˈ"};
+  queries.insert(queries.end(), phrases.begin(), phrases.end());
+  for (const auto* table : {&json, &compiled}) {
+    assert(table->size() == plain.size());
+    for (size_t i = 0; i < plain.size(); ++i) {
+      assert(table->decodePhraseAt(i) == plain.decodePhraseAt(i));
+      assert(table->descriptionAt(i) == plain.descriptionAt(i));
+    }
+    for (const auto& query : queries) {
+      assert(table->prefixRange(query) == plain.prefixRange(query));
+      assert(table->equalRange(query) == plain.equalRange(query));
+    }
+    size_t visited = 0;
+    table->visitPhrases(3, 40, [&](size_t index, std::string_view phrase) {
+      assert(index == 3 + visited++);
+      assert(phrase == plain.decodePhraseAt(index));
+    });
+    assert(visited == 37);
+  }
+
+  // Written back out, a compressed table is a plain compiled table.
+  assert(TableFormat::write(compiled, tableFile));
+  InputTable roundTrip;
+  assert(roundTrip.load(tableFile));
+  assert(roundTrip.decodePhraseAt(30) == plain.decodePhraseAt(30));
+
+  std::filesystem::remove(jsonFile);
+  std::filesystem::remove(tableFile);
+  std::cout << "Compressed keys test passed" << std::endl;
+}
+
+void testBuiltinTable() {
+  std::string jsonFile = "test_inputtable_builtin.json";
+  createTestFile(jsonFile);
+  InputTable source;
+  assert(source.load(jsonFile));
+  auto bytes = TableFormat::serialize(source);
+  assert(bytes);
+
+  // Built-in tables are used in place, like the constexpr arrays generated
+  // by fox-tablec --embed.
+  std::vector<uint32_t> storage(bytes->size() / 4 + 1);
+  std::memcpy(storage.data(), bytes->data(), bytes->size());
+  const auto* data = reinterpret_cast<const char*>(storage.data());
+  InputTable table;
+  assert(table.loadBuiltin(data, bytes->size()));
+  assert(table.name() == "測試");
+  assert(table.size() == 5);
+  assert(table.descriptionAt(3) == "D1");
+  assert(table.memoryUsage() >= bytes->size());
+  assert(!table.loadBuiltin(data + 4, bytes->size() - 4));
+
+  std::filesystem::remove(jsonFile);
+  std::cout << "Built-in table test passed" << std::endl;
+}
+
+void testArchive() {
+  std::vector<std::string> jsonFiles = {"test_inputtable_dialect0.json",
+                                        "test_inputtable_dialect1.json"};
+  std::string archiveFile = "test_inputtable_family.archive";
+  {
+    std::ofstream out(jsonFiles[0]);
+    out << R"({"name": "Dialect 0", "data": [
+        ["a", "A"], ["dup", "D1"], ["b", "B"], ["dup", "D2"]]})";
+  }
+  {
+    // Shares "a" and both duplicates, in the other order.
+    std::ofstream out(jsonFiles[1]);
+    out << R"({"name": "Dialect 1", "data": [
+        ["dup", "D2"], ["c", "C"], ["a", "A"], ["dup", "D1"]]})";
+  }
+  std::vector<InputTable> sources(2);
+  std::vector<std::pair<TableFormat::Dialect, const InputTable*>> dialects;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    assert(sources[i].load(jsonFiles[i]));
+    dialects.push_back({{"TW_0" + std::to_string(i), sources[i].name()},
+                        &sources[i]});
+  }
+  assert(TableFormat::writeArchive("Family", dialects, archiveFile));
+
+  auto archive = std::make_shared<InputTable>();
+  assert(archive->load(archiveFile));
+  assert(archive->name() == "Family");
+  assert(archive->dialects().size() == 2);
+  assert(archive->dialects()[1].id == "TW_01");
+  assert(archive->dialects()[1].name == "Dialect 1");
+  // "a" and one "dup" are stored once.
+  assert(archive->size() == 6);
+  assert(archive->dialectMaskAt(0) == 3);
+
+  for (size_t d = 0; d < sources.size(); ++d) {
+    auto view = InputTable::dialectView(archive, d);
+    assert(view);
+    const auto& source = sources[d];
+    assert(view->name() == source.name());
+    assert(view->size() == source.size());
+    for (size_t i = 0; i < source.size(); ++i) {
+      assert(view->decodePhraseAt(i) == source.decodePhraseAt(i));
+      assert(view->descriptionAt(i) == source.descriptionAt(i));
+    }
+    for (const char* query : {"", "a", "c", "dup", "z"}) {
+      assert(view->prefixRange(query) == source.prefixRange(query));
+      assert(view->equalRange(query) == source.equalRange(query));
+    }
+  }
+  assert(!InputTable::dialectView(archive, 2));
+
+  // A view written back out is the dialect's own table.
+  auto view = InputTable::dialectView(archive, 1);
+  auto bytes = TableFormat::serialize(*view);
+  assert(bytes && bytes == TableFormat::serialize(sources[1]));
+
+  // Only the views are searched, so only they build a search index.
+  std::vector<InputTable::Entry> entries;
+  for (int i = 0; i < 100; ++i) {
+    entries.push_back({"a" + std::to_string(i), "A"});
+  }
+  InputTable large;
+  large.assign("Large", entries);
+  assert(TableFormat::writeArchive("Family", {{{"TW_00", "Large"}, &large}},
+                                   archiveFile));
+  archive = std::make_shared<InputTable>();
+  assert(archive->load(archiveFile));
+  std::span<const uint32_t> ranked;
+  assert(!archive->rankedEntries("a", ranked));
+  assert(archive->prefixRange("a1") == large.prefixRange("a1"));
+  view = InputTable::dialectView(archive, 0);
+  assert(view->rankedEntries("a", ranked));
+  assert(large.rankedEntries("a", ranked));
+
+  for (const auto& file : jsonFiles) {
+    std::filesystem::remove(file);
+  }
+  std::filesystem::remove(archiveFile);
+  std::cout << "Archive test passed" << std::endl;
+}
+
+void testExactLookup() {
+  // Every key finds its own index, and nothing else.
+  std::vector<uint64_t> hashes;
+  for (int i = 0; i < 50000; ++i) {
+    hashes.push_back(PerfectHash::hash("key" + std::to_string(i)));
+  }
+  PerfectHash hash;
+  assert(hash.build(hashes));
+  std::vector<bool> found(hashes.size(), false);
+  for (size_t i = 0; i < hashes.size(); ++i) {
+    size_t index = hash.find(hashes[i]);
+    assert(index == i);
+    assert(!found[index]);
+    found[index] = true;
+  }
+  assert(hash.memoryUsage() < hashes.size() * 5);
+  hashes.push_back(hashes.front());
+  assert(!hash.build(hashes));
+  assert(hash.empty());
+
+  // Exact lookups find the same entries as a search of the sorted phrases.
+  std::vector<InputTable::Entry> entries;
+  for (int i = 0; i < 3000; ++i) {
+    std::string phrase = "w" + std::to_string(i * 7 % 1000);
+    entries.push_back({phrase, std::to_string(i)});
+    entries.push_back({phrase + "’", ""});
+  }
+  entries.push_back({"", "empty"});
+  InputTable table;
+  table.assign("Exact", entries);
+  // The hash is built with the table, so the first lookup adds nothing.
+  size_t loaded = table.memoryUsage();
+  assert(table.equalRange("w5").first != table.equalRange("w5").second);
+  assert(table.memoryUsage() == loaded);
+  for (size_t i = 0; i < table.size(); ++i) {
+    std::string phrase = table.decodePhraseAt(i);
+    auto [first, last] = table.equalRange(phrase);
+    assert(first <= i && i < last);
+    assert(first == 0 || table.decodePhraseAt(first - 1) != phrase);
+    assert(last == table.size() || table.decodePhraseAt(last) != phrase);
+  }
+  for (const char* missing : {"w", "w1000", "x", "w5’’", "W5"}) {
+    auto [first, last] = table.equalRange(missing);
+    assert(first == last);
+  }
+
+  std::cout << "Exact lookup test passed" << std::endl;
+}
+
+void testPrefixSearch() {
+  // Short and long keys, shared prefixes, and bytes above 0x7f.
+  std::vector<InputTable::Entry> entries;
+  for (int i = 0; i < 5000; ++i) {
+    std::string phrase = std::to_string(i * 37 % 2000);
+    if (i % 3 == 0) {
+      phrase = "ma’" + phrase;
+    }
+    if (i % 7 == 0) {
+      phrase += std::string(40, 'a' + i % 5);
+    }
+    entries.push_back({phrase, ""});
+  }
+  entries.push_back({"", "empty"});
+  entries.push_back({"\xff", ""});
+  InputTable table;
+  table.assign("Trie", entries);
+
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < table.size(); ++i) {
+    keys.push_back(table.decodePhraseAt(i));
+  }
+  // Every prefix of every key, and every prefix extended by a byte that
+  // may not follow it.
+  std::vector<std::string> queries = {"", "\xff\xff", "z", "ma’9x"};
+  for (const auto& key : keys) {
+    for (size_t length = 0; length <= key.size(); ++length) {
+      queries.push_back(key.substr(0, length));
+      queries.push_back(key.substr(0, length) + "/");
+      queries.push_back(key.substr(0, length) + "b");
+    }
+  }
+  // Both search layouts, and the trie again after the other one.
+  for (auto layout :
+       {InputTable::SearchLayout::kTrie, InputTable::SearchLayout::kEytzinger,
+        InputTable::SearchLayout::kTrie}) {
+    table.setSearchLayout(layout);
+    std::span<const uint32_t> ranked;
+    assert(table.rankedEntries("1", ranked) ==
+           (layout == InputTable::SearchLayout::kTrie));
+    for (const auto& query : queries) {
+      auto first = std::lower_bound(keys.begin(), keys.end(), query);
+      auto last = first;
+      while (last != keys.end() &&
+             last->compare(0, query.size(), query) == 0) {
+        ++last;
+      }
+      auto range = table.prefixRange(query);
+      assert(range.first == static_cast<size_t>(first - keys.begin()));
+      assert(range.second == static_cast<size_t>(last - keys.begin()));
+    }
+  }
+
+  std::cout << "Prefix search test passed" << std::endl;
+}
+
+void testInfixSearch() {
+  // Roots inside affixed words, repeated roots, duplicates, and bytes above
+  // 0x7f.
+  const char* parts[] = {"a", "bu", "ra", "’", "k"};
+  std::vector<InputTable::Entry> entries;
+  for (int i = 0; i < 300; ++i) {
+    std::string phrase;
+    for (int n = i * 7919 % 997; n > 0; n /= 5) {
+      phrase += parts[n % 5];
+    }
+    entries.push_back({phrase, std::to_string(i)});
+  }
+  for (const char* phrase : {"abura’", "bura", "bura", "’bura", "burabura"}) {
+    entries.push_back({phrase, phrase});
+  }
+  InputTable table;
+  table.assign("Infix", entries);
+
+  // The expected entries: the first of each phrase that contains the infix,
+  // shorter phrases first.
+  auto expected = [&](const std::string& infix) {
+    std::vector<std::pair<size_t, uint32_t>> found;
+    for (size_t i = 0; i < table.size(); ++i) {
+      auto phrase = table.decodePhraseAt(i);
+      if ((i == 0 || phrase != table.decodePhraseAt(i - 1)) &&
+          phrase.find(infix) != std::string::npos) {
+        found.emplace_back(phrase.size(), static_cast<uint32_t>(i));
+      }
+    }
+    std::sort(found.begin(), found.end());
+    std::vector<uint32_t> result;
+    for (const auto& [length, entry] : found) {
+      result.push_back(entry);
+    }
+    return result;
+  };
+  std::vector<std::string> queries = {"x", "bura", "ura’", "’"};
+  for (size_t i = 0; i < table.size(); ++i) {
+    auto phrase = table.decodePhraseAt(i);
+    for (size_t start = 0; start < phrase.size(); ++start) {
+      if ((phrase[start] & 0xc0) == 0x80) {
+        continue;
+      }
+      for (size_t length = 1; start + length <= phrase.size(); ++length) {
+        queries.push_back(phrase.substr(start, length));
+      }
+    }
+  }
+  auto check = [&]() {
+    for (const auto& query : queries) {
+      auto all = expected(query);
+      assert(table.infixEntries(query, SIZE_MAX) == all);
+      for (size_t count : {1, 3}) {
+        auto first = table.infixEntries(query, count);
+        assert(first.size() == std::min(count, all.size()));
+        assert(std::equal(first.begin(), first.end(), all.begin()));
+      }
+    }
+  };
+
+  // The same entries with and without the index, and once the phrases are
+  // compressed.
+  assert(!table.hasInfixIndex());
+  check();
+  size_t memoryUsage = table.memoryUsage();
+  table.buildInfixIndex();
+  assert(table.hasInfixIndex());
+  assert(table.memoryUsage() > memoryUsage);
+  check();
+  assert(table.infixEntries("", SIZE_MAX).empty());
+  table.compressKeys();
+  check();
+
+  std::cout << "Infix search test passed" << std::endl;
+}
+
+void testGlossLookup() {
+  // Glosses that share characters and bigrams, repeat them, and have
+  // characters of one to four bytes.
+  const char* parts[] = {"電", "冰", "箱", "水", "a", "é", "𠀋", "（"};
+  std::vector<InputTable::Entry> entries;
+  for (int i = 0; i < 500; ++i) {
+    std::string description;
+    for (int n = i * 7919 % 4093; n > 0; n /= 8) {
+      description += parts[n % 8];
+    }
+    entries.push_back({"w" + std::to_string(i % 450), description});
+  }
+  entries.push_back({"ising", "電冰箱"});
+  auto glosses = std::make_shared<GlossDictionary>();
+  for (auto dictionary : {std::shared_ptr<GlossDictionary>(), glosses}) {
+    std::string path = "test_gloss_lookup.json";
+    {
+      std::ofstream out(path);
+      out << "{\"name\": \"Glosses\", \"data\": [";
+      for (size_t i = 0; i < entries.size(); ++i) {
+        out << (i ? "," : "") << "[\"" << entries[i].phrase << "\", \""
+            << entries[i].description << "\"]";
+      }
+      out << "]}";
+    }
+    InputTable table;
+    assert(table.load(path, dictionary));
+    std::filesystem::remove(path);
+
+    std::vector<std::string> queries = {"", "x", "電冰箱", "箱電", "𠀋"};
+    for (size_t i = 0; i < table.size(); i += 7) {
+      std::string description(table.descriptionAt(i));
+      for (size_t start = 0; start < description.size(); ++start) {
+        if ((description[start] & 0xc0) == 0x80) {
+          continue;
+        }
+        for (size_t end = start + 1; end <= description.size(); ++end) {
+          if (end == description.size() || (description[end] & 0xc0) != 0x80) {
+            queries.push_back(description.substr(start, end - start));
+          }
+        }
+      }
+    }
+    for (const auto& query : queries) {
+      std::vector<uint32_t> expected;
+      for (size_t i = 0; !query.empty() && i < table.size(); ++i) {
+        if (table.descriptionAt(i).find(query) != std::string_view::npos) {
+          expected.push_back(static_cast<uint32_t>(i));
+        }
+      }
+      assert(table.glossEntries(query) == expected);
+    }
+  }
+
+  std::cout << "Gloss lookup test passed" << std::endl;
+}
+
+void testFuzzySearch() {
+  // Phrases that share long prefixes, with apostrophes of both kinds and
+  // upper case letters.
+  const char* parts[] = {"a", "bu", "ra", "’", "'", "K", "ng", "é"};
+  std::vector<InputTable::Entry> entries;
+  for (int i = 0; i < 2000; ++i) {
+    std::string phrase;
+    for (int n = i * 7919 % 32749; n > 0; n /= 8) {
+      phrase += parts[n % 8];
+    }
+    entries.push_back({phrase, ""});
+  }
+  InputTable table;
+  table.assign("Fuzzy", entries);
+
+  // The least distance from a pattern to a start of a phrase, the slow way.
+  auto characters = [](std::string_view text) {
+    std::vector<uint32_t> result;
+    for (size_t pos = 0; pos < text.size();) {
+      result.push_back(
+          LevenshteinAutomaton::fold(Utf8::nextCharacter(text, pos)));
+    }
+    return result;
+  };
+  auto distance = [&](std::string_view pattern, std::string_view phrase) {
+    auto a = characters(pattern);
+    auto b = characters(phrase);
+    std::vector<std::vector<uint32_t>> cost(
+        a.size() + 1, std::vector<uint32_t>(b.size() + 1));
+    for (size_t i = 0; i <= a.size(); ++i) {
+      for (size_t j = 0; j <= b.size(); ++j) {
+        if (i == 0 || j == 0) {
+          cost[i][j] = static_cast<uint32_t>(i + j);
+          continue;
+        }
+        cost[i][j] = std::min({cost[i - 1][j] + 1, cost[i][j - 1] + 1,
+                                cost[i - 1][j - 1] + (a[i - 1] != b[j - 1])});
+      }
+    }
+    return *std::min_element(cost[a.size()].begin(), cost[a.size()].end());
+  };
+
+  auto check = [&](uint32_t maxDistance) {
+    for (const char* pattern :
+         {"abura'", "abuta", "bura’K", "ngaé", "xyz", "kng'bu", "aaaa"}) {
+      LevenshteinAutomaton automaton(pattern, maxDistance);
+      std::vector<InputTable::FuzzyMatch> matches;
+      assert(table.fuzzyEntries(automaton,
+                                std::chrono::steady_clock::time_point::max(),
+                                matches));
+      std::vector<InputTable::FuzzyMatch> expected;
+      for (size_t i = 0; i < table.size(); i = table.groupEnd(i)) {
+        uint32_t least = distance(pattern, table.decodePhraseAt(i));
+        if (least <= maxDistance) {
+          expected.push_back({static_cast<uint32_t>(i), least});
+        }
+      }
+      assert(matches.size() == expected.size());
+      for (size_t i = 0; i < matches.size(); ++i) {
+        assert(matches[i].entry == expected[i].entry);
+        assert(matches[i].distance == expected[i].distance);
+      }
+    }
+  };
+  for (bool compressed : {false, true}) {
+    if (compressed) {
+      table.compressKeys();
+    }
+    check(1);
+    check(2);
+  }
+
+  // A search out of time stops early.
+  LevenshteinAutomaton automaton("abura", 2);
+  std::vector<InputTable::FuzzyMatch> matches;
+  assert(!table.fuzzyEntries(automaton, std::chrono::steady_clock::now(),
+                             matches));
+
+  std::cout << "Fuzzy search test passed" << std::endl;
+}
+
+void testReload() {
+  // A large table, then a small one with case variants, in the same table.
+  std::string largeFile = "test_reload_large.json";
+  std::string smallFile = "test_reload_small.json";
+  {
+    std::ofstream out(largeFile);
+    out << R"({"name": "Large", "data": [)";
+    for (int i = 0; i < 3000; ++i) {
+      out << (i ? "," : "") << "[\"Ka" << i << "\", \"" << i << "\"]";
+    }
+    out << "]}";
+  }
+  {
+    std::ofstream out(smallFile);
+    out << R"({"name": "Small", "data": )"
+        << R"([["Ab", "1"], ["ab", "2"], ["b", "3"]]})";
+  }
+
+  for (auto layout : {InputTable::SearchLayout::kTrie,
+                      InputTable::SearchLayout::kEytzinger}) {
+    InputTable table;
+    table.setSearchLayout(layout);
+    assert(table.load(largeFile));
+    assert(table.load(smallFile));
+    assert(table.size() == 3);
+    assert(table.foldClassAt(0) != InputTable::kNoFoldClass);
+    assert(table.foldClassAt(0) == table.foldClassAt(1));
+    assert(table.foldClassAt(2) == InputTable::kNoFoldClass);
+    auto prefix = table.prefixRange("a");
+    assert(prefix.first == 1 && prefix.second == 2);
+    auto equal = table.equalRange("b");
+    assert(equal.first == 2 && equal.second == 3);
+  }
+
+  std::filesystem::remove(largeFile);
+  std::filesystem::remove(smallFile);
+  std::cout << "Reload test passed" << std::endl;
+}
+
+void testKeyScan() {
+  // Keys of every length around the vector widths, with bytes above 0x7f,
+  // packed into an arena that ends right after the last key.
+  std::vector<std::string> keys;
+  for (size_t length = 0; length < 70; ++length) {
+    for (char last : {'a', 'b', 'Z', '\xe2'}) {
+      keys.push_back(std::string(length, 'a') + last);
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  std::string arena;
+  std::vector<uint32_t> offsets = {0};
+  for (const auto& key : keys) {
+    arena += key;
+    offsets.push_back(static_cast<uint32_t>(arena.size()));
+  }
+  auto& scalar = KeyScan::kernels(KeyScan::Level::kScalar);
+  for (auto level : {KeyScan::Level::kScalar, KeyScan::Level::kSse42,
+                     KeyScan::Level::kAvx2}) {
+    auto& kernels = KeyScan::kernels(level);
+    for (size_t first = 0; first < keys.size(); ++first) {
+      for (size_t length = 0; length <= keys[first].size() + 1; ++length) {
+        std::string prefix = keys[first].substr(0, length);
+        if (length > keys[first].size()) {
+          prefix += 'a';
+        }
+        size_t end = kernels.prefixRunEnd(arena.data(), arena.size(),
+                                          offsets.data(), first, keys.size(),
+                                          prefix);
+        assert(end == scalar.prefixRunEnd(arena.data(), arena.size(),
+                                          offsets.data(), first, keys.size(),
+                                          prefix));
+        assert(end == first || keys[end - 1].starts_with(prefix));
+        assert(end == keys.size() || !keys[end].starts_with(prefix));
+      }
+    }
+    for (const auto& key : keys) {
+      std::string text = key + "-@[`{" + key;
+      assert(kernels.hasUpper(text.data(), text.size()) ==
+             scalar.hasUpper(text.data(), text.size()));
+      std::string lowered = text;
+      kernels.toLower(lowered.data(), lowered.size());
+      for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        assert(lowered[i] == (c >= 'A' && c <= 'Z' ? c + 32 : c));
+      }
+    }
+  }
+
+  std::cout << "Key scan test passed" << std::endl;
+}
+
+int main() {
+  testCompiledTable();
+  testJsonTable();
+  testLargeUnsortedTable();
+  testInvalidCompiledTable();
+  testGlossDictionary();
+  testCompressedKeys();
+  testBuiltinTable();
+  testArchive();
+  testExactLookup();
+  testPrefixSearch();
+  testInfixSearch();
+  testGlossLookup();
+  testFuzzySearch();
+  testReload();
+  testKeyScan();
+  return 0;
+}
@@ -0,0 +1,493 @@
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/indexcache.h"
+#include "../src/inputtable.h"
+#include "../src/inputtablemanager.h"
+#include "../src/tableformat.h"
+#include "../src/tablemanifest.h"
+
+using namespace McFoxIM;
+
+void createTestTable(const std::filesystem::path& path,
+                     const std::string& name) {
+  std::ofstream out(path);
+  out << R"({
+        "name": ")" << name << R"(",
+        "data": [
+            ["a", "A"],
+            ["b", "B"]
+        ]
+    })";
+  out.close();
+}
+
+void testProbeTables() {
+  std::filesystem::path dir = "test_inputtablemanager_probe";
+  std::filesystem::create_directories(dir);
+  createTestTable(dir / "TW_00.json", "南勢阿美語");
+  createTestTable(dir / "TW_05.json", "賽考利克泰雅語");
+
+  InputTable table;
+  assert(table.load((dir / "TW_05.json").string()));
+  assert(TableFormat::write(table, (dir / "TW_05.table").string()));
+
+  InputTableManager manager(dir.string());
+  const auto& tables = manager.availableTables();
+  assert(tables.size() == 2);
+  assert(tables[0].id == "TW_00");
+  assert(tables[0].name == "南勢阿美語");
+  assert(tables[0].path == (dir / "TW_00.json").string());
+  assert(tables[1].id == "TW_05");
+  assert(tables[1].name == "賽考利克泰雅語");
+  assert(tables[1].path == (dir / "TW_05.table").string());
+  assert(tables[1].entryCount == 2);
+
+  assert(manager.setTable("TW_05"));
+  assert(manager.currentTable().size() == 2);
+  assert(!manager.setTable("TW_99"));
+
+  std::filesystem::remove_all(dir);
+  std::cout << "Probe tables test passed" << std::endl;
+}
+
+void testManifest() {
+  std::filesystem::path dir = "test_inputtablemanager_manifest";
+  std::filesystem::create_directories(dir);
+  createTestTable(dir / "TW_00.json", "南勢阿美語");
+  createTestTable(dir / "TW_01.json", "秀姑巒阿美語");
+
+  // Only the tables listed in the manifest are used.
+  TableManifest::Record record;
+  assert(TableManifest::stat((dir / "TW_01.json").string(), record));
+  record.id = "TW_01";
+  record.name = "From manifest";
+  record.entryCount = 2;
+  record.path = "TW_01.json";
+  assert(TableManifest::write((dir / TableManifest::kFileName).string(),
+                              {record}));
+
+  auto records = TableManifest::read((dir / TableManifest::kFileName).string());
+  assert(records && records->size() == 1);
+  assert((*records)[0].size == record.size);
+  assert((*records)[0].modificationTime == record.modificationTime);
+
+  {
+    InputTableManager manager(dir.string());
+    const auto& tables = manager.availableTables();
+    assert(tables.size() == 1);
+    assert(tables[0].id == "TW_01");
+    assert(tables[0].name == "From manifest");
+    assert(tables[0].path == (dir / "TW_01.json").string());
+    assert(tables[0].entryCount == 2);
+    assert(manager.setTable("TW_01"));
+    assert(manager.currentTable().name() == "秀姑巒阿美語");
+  }
+
+  // A table that changed after the manifest was generated is probed.
+  TableManifest::Record resized = record;
+  ++resized.size;
+  TableManifest::Record touched = record;
+  --touched.modificationTime;
+  for (const auto& changed : {resized, touched}) {
+    assert(TableManifest::write((dir / TableManifest::kFileName).string(),
+                                {changed}));
+    InputTableManager manager(dir.string());
+    const auto& tables = manager.availableTables();
+    assert(tables.size() == 1);
+    assert(tables[0].name == "秀姑巒阿美語");
+    assert(tables[0].entryCount == 0);
+  }
+
+  std::filesystem::remove_all(dir);
+  std::cout << "Manifest test passed" << std::endl;
+}
+
+void testTableCache() {
+  std::filesystem::path dir = "test_inputtablemanager_cache";
+  std::filesystem::create_directories(dir);
+  createTestTable(dir / "TW_00.json", "南勢阿美語");
+  createTestTable(dir / "TW_01.json", "秀姑巒阿美語");
+  createTestTable(dir / "TW_02.json", "海岸阿美語");
+
+  InputTableManager manager(dir.string());
+  manager.setCacheLimits(2, 0);
+
+  assert(manager.setTable("TW_00"));
+  assert(manager.setTable("TW_01"));
+  assert(manager.setTable("TW_00"));
+  assert(manager.cacheStats().hits == 1);
+  assert(manager.cacheStats().misses == 2);
+  assert(manager.cachedTableCount() == 2);
+
+  // TW_01 is the least recently used table and makes room for TW_02.
+  assert(manager.setTable("TW_02"));
+  assert(manager.cacheStats().evictions == 1);
+  assert(manager.cachedTableCount() == 2);
+  assert(manager.setTable("TW_00"));
+  assert(manager.cacheStats().hits == 2);
+  assert(manager.setTable("TW_01"));
+  assert(manager.cacheStats().misses == 4);
+  assert(manager.currentTable().name() == "秀姑巒阿美語");
+
+  // A byte budget smaller than one table still keeps the current table.
+  manager.setCacheLimits(8, 1);
+  assert(manager.cachedTableCount() == 1);
+  assert(manager.currentTable().name() == "秀姑巒阿美語");
+
+  std::filesystem::remove_all(dir);
+  std::cout << "Table cache test passed" << std::endl;
+}
+
+// Stands in for the fcitx event dispatcher: callbacks scheduled from the
+// loader thread run when the test thread pumps them.
+class TestScheduler {
+ public:
+  void schedule(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callbacks_.push_back(std::move(callback));
+    condition_.notify_one();
+  }
+
+  void runOne() {
+    std::function<void()> callback;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      bool ready = condition_.wait_for(lock, std::chrono::seconds(5),
+                                       [this] { return !callbacks_.empty(); });
+      assert(ready && "Timed out waiting for the table loader");
+      callback = std::move(callbacks_.front());
+      callbacks_.pop_front();
+    }
+    callback();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::function<void()>> callbacks_;
+};
+
+void testBackgroundLoading() {
+  std::filesystem::path dir = "test_inputtablemanager_async";
+  std::filesystem::create_directories(dir);
+  createTestTable(dir / "TW_00.json", "南勢阿美語");
+  createTestTable(dir / "TW_01.json", "秀姑巒阿美語");
+
+  TestScheduler scheduler;
+  InputTableManager manager(dir.string());
+  manager.setScheduler([&scheduler](std::function<void()> callback) {
+    scheduler.schedule(std::move(callback));
+  });
+  std::string readyId;
+  manager.setTableReadyCallback(
+      [&readyId](const std::string& id) { readyId = id; });
+
+  // The current table is empty until the loaded table is published, and the
+  // requested one is not cached, so the engine learns no words meanwhile.
+  assert(manager.requestTable("TW_00"));
+  assert(manager.isLoading());
+  assert(!manager.isCached("TW_00"));
+  assert(manager.currentTable().size() == 0);
+  scheduler.runOne();
+  assert(!manager.isLoading());
+  assert(manager.isCached("TW_00"));
+  assert(readyId == "TW_00");
+  assert(manager.currentTable().name() == "南勢阿美語");
+
+  // A preloaded table is a cache hit later.
+  manager.preloadTables({"TW_01"});
+  scheduler.runOne();
+  assert(manager.cachedTableCount() == 2);
+  assert(manager.currentTable().name() == "南勢阿美語");
+  assert(manager.requestTable("TW_01"));
+  assert(!manager.isLoading());
+  assert(manager.currentTable().name() == "秀姑巒阿美語");
+  assert(manager.cacheStats().hits == 1);
+
+  assert(!manager.requestTable("TW_99"));
+
+  std::filesystem::remove_all(dir);
+  std::cout << "Background loading test passed" << std::endl;
+}
+
+void testReload() {
+  std::filesystem::path dir = "test_inputtablemanager_reload";
+  std::filesystem::create_directories(dir);
+  createTestTable(dir / "TW_00.json", "南勢阿美語");
+
+  TestScheduler scheduler;
+  InputTableManager manager(dir.string());
+  manager.setScheduler([&scheduler](std::function<void()> callback) {
+    scheduler.schedule(std::move(callback));
+  });
+  assert(manager.setTable("TW_00"));
+  auto before = manager.currentTableSnapshot();
+
+  // Snapshots taken before the reload stay valid after it.
+  createTestTable(dir / "TW_00.json", "秀姑巒阿美語");
+  manager.reloadFile("TW_00.json");
+  assert(manager.currentTableSnapshot() == before);
+  scheduler.runOne();
+  assert(manager.currentTable().name() == "秀姑巒阿美語");
+  assert(before->name() == "南勢阿美語");
+  assert(before->size() == 2);
+
+  // A broken file keeps the table that is in use.
+  {
+    std::ofstream out(dir / "TW_00.json");
+    out << "{";
+  }
+  manager.reloadFile("TW_00.json");
+  scheduler.runOne();
+  assert(manager.currentTable().name() == "秀姑巒阿美語");
+
+  // Files that are not tables are ignored.
+  manager.reloadFile("README.md");
+  assert(manager.availableTables().size() == 1);
+
+  std::filesystem::remove_all(dir);
+  std::cout << "Reload test passed" << std::endl;
+}
+
+void testArchives() {
+  std::filesystem::path dir = "test_inputtablemanager_archive";
+  std::filesystem::create_directories(dir);
+  createTestTable(dir / "TW_00.json", "南勢阿美語");
+  createTestTable(dir / "TW_01.json", "秀姑巒阿美語");
+  createTestTable(dir / "TW_05.json", "賽考利克泰雅語");
+
+  std::vector<InputTable> sources(2);
+  std::vector<std::pair<TableFormat::Dialect, const InputTable*>> dialects;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    std::string id = "TW_0" + std::to_string(i);
+    assert(sources[i].load((dir / (id + ".json")).string()));
+    dialects.push_back({{id, sources[i].name()}, &sources[i]});
+  }
+  std::string archivePath = (dir / "Amis.archive").string();
+  assert(TableFormat::writeArchive("Amis", dialects, archivePath));
+
+  // The dialects in the archive replace their table files.
+  InputTableManager manager(dir.string());
+  const auto& tables = manager.availableTables();
+  assert(tables.size() == 3);
+  assert(tables[0].id == "TW_00");
+  assert(tables[0].path == archivePath);
+  assert(tables[0].dialect == 0);
+  assert(tables[0].entryCount == 2);
+  assert(tables[1].id == "TW_01");
+  assert(tables[1].name == "秀姑巒阿美語");
+  assert(tables[1].dialect == 1);
+  assert(tables[2].id == "TW_05");
+  assert(tables[2].dialect == -1);
+
+  // The second dialect shares the archive loaded for the first one.
+  assert(manager.setTable("TW_00"));
+  auto first = manager.currentTableSnapshot();
+  assert(manager.setTable("TW_01"));
+  auto second = manager.currentTableSnapshot();
+  assert(second->name() == "秀姑巒阿美語");
+  assert(second->size() == 2);
+  assert(second->descriptionAt(second->equalRange("a").first) == "A");
+  assert(first->name() == "南勢阿美語");
+
+  // A changed table file is used on its own.
+  createTestTable(dir / "TW_01.json", "Updated");
+  manager.reloadFile("TW_01.json");
+  assert(manager.currentTable().name() == "Updated");
+  assert(manager.availableTables()[1].dialect == -1);
+
+  std::filesystem::remove_all(dir);
+  std::cout << "Archives test passed" << std::endl;
+}
+
+void testIdleEviction() {
+  std::filesystem::path dir = "test_inputtablemanager_idle";
+  std::filesystem::create_directories(dir);
+  createTestTable(dir / "TW_00.json", "南勢阿美語");
+  createTestTable(dir / "TW_01.json", "秀姑巒阿美語");
+
+  using Clock = InputTableManager::Clock;
+  InputTableManager manager(dir.string());
+  assert(manager.memoryUsage() == 0);
+  assert(manager.setTable("TW_00"));
+  assert(manager.setTable("TW_01"));
+  auto loadedAt = Clock::now();
+  assert(manager.memoryUsage() > 0);
+
+  assert(manager.evictIdleTables(std::chrono::minutes(10),
+                                 loadedAt + std::chrono::minutes(5)) == 0);
+  assert(manager.evictIdleTables(std::chrono::minutes(0),
+                                 loadedAt + std::chrono::hours(1)) == 0);
+  assert(manager.cachedTableCount() == 2);
+
+  // Every table but the current one goes.
+  size_t loadedBytes = manager.memoryUsage();
+  assert(manager.evictIdleTables(std::chrono::minutes(10),
+                                 loadedAt + std::chrono::minutes(11)) == 1);
+  assert(manager.cachedTableCount() == 1);
+  assert(manager.memoryUsage() < loadedBytes);
+  assert(!manager.isCached("TW_00"));
+  assert(manager.isCached("TW_01"));
+
+  // Typing goes on with the current table without requesting it again.
+  manager.touchCurrentTable();
+  assert(manager.currentTable().name() == "秀姑巒阿美語");
+  auto table = manager.currentTableSnapshot();
+  auto range = table->prefixRange("a");
+  assert(range.first < range.second);
+  assert(manager.evictIdleTables(std::chrono::minutes(10),
+                                 loadedAt + std::chrono::hours(1)) == 0);
+
+  std::filesystem::remove_all(dir);
+  std::cout << "Idle eviction test passed" << std::endl;
+}
+
+void testDataDirectories() {
+  std::filesystem::path userDir = "test_inputtablemanager_user";
+  std::filesystem::path systemDir = "test_inputtablemanager_system";
+  std::filesystem::path cacheDir = "test_inputtablemanager_index";
+  std::filesystem::create_directories(userDir);
+  std::filesystem::create_directories(systemDir);
+  createTestTable(systemDir / "TW_00.json", "南勢阿美語");
+  createTestTable(systemDir / "TW_01.json", "秀姑巒阿美語");
+  createTestTable(userDir / "TW_00.json", "User Amis");
+  {
+    // Any file name is a table id, and the phrases need not be sorted.
+    std::ofstream out(userDir / "class-glossary.json");
+    out << R"({"name": "Class", "data": [["pitilidan", "學校"],
+        ["cudad", "書"], ["pitilidan", "教室"]]})";
+  }
+
+  InputTableManager manager(
+      std::vector<std::string>{userDir.string(), systemDir.string()});
+  manager.setIndexCacheDirectory(cacheDir.string());
+  const auto& tables = manager.availableTables();
+  assert(tables.size() == 3);
+  assert(tables[0].id == "TW_00");
+  assert(tables[0].name == "User Amis");
+  assert(tables[1].id == "TW_01");
+  assert(tables[2].id == "class-glossary");
+  assert(tables[2].name == "Class");
+
+  // Files in a directory that does not take precedence are ignored.
+  createTestTable(systemDir / "TW_00.json", "Updated");
+  manager.reloadFile(systemDir.string(), "TW_00.json");
+  assert(manager.availableTables()[0].path ==
+         (userDir / "TW_00.json").string());
+
+  // The first load caches the index, and later loads read it.
+  assert(manager.setTable("class-glossary"));
+  assert(manager.currentTable().decodePhraseAt(0) == "cudad");
+  auto indexPath = IndexCache::pathFor(
+      cacheDir.string(), (userDir / "class-glossary.json").string());
+  assert(std::filesystem::exists(indexPath));
+  InputTableManager restarted(
+      std::vector<std::string>{userDir.string(), systemDir.string()});
+  restarted.setIndexCacheDirectory(cacheDir.string());
+  assert(restarted.setTable("class-glossary"));
+  assert(restarted.currentTable().size() == 3);
+  assert(restarted.currentTable().descriptionAt(2) == "教室");
+
+  // A changed table misses the cache and replaces its cached index.
+  {
+    std::ofstream out(userDir / "class-glossary.json");
+    out << R"({"name": "Class", "data": [["wawa", "小孩"]]})";
+  }
+  InputTableManager changed(userDir.string());
+  changed.setIndexCacheDirectory(cacheDir.string());
+  assert(changed.setTable("class-glossary"));
+  assert(changed.currentTable().size() == 1);
+  assert(!std::filesystem::exists(indexPath));
+  assert(std::distance(std::filesystem::directory_iterator(cacheDir),
+                       std::filesystem::directory_iterator()) == 1);
+
+  std::filesystem::remove_all(userDir);
+  std::filesystem::remove_all(systemDir);
+  std::filesystem::remove_all(cacheDir);
+  std::cout << "Data directories test passed" << std::endl;
+}
+
+void testUnions() {
+  std::filesystem::path dir = "test_inputtablemanager_union";
+  std::filesystem::create_directories(dir);
+  createTestTable(dir / "TW_00.json", "南勢阿美語");
+  createTestTable(dir / "TW_01.json", "秀姑巒阿美語");
+  {
+    std::ofstream out(dir / "Amis.union");
+    out << R"({"name": "阿美語", "tables": ["TW_00", "TW_01", "TW_99"]})";
+  }
+  std::ofstream(dir / "Broken.union") << "{";
+
+  InputTableManager manager(dir.string());
+  const auto& tables = manager.availableTables();
+  assert(tables.size() == 3);
+  assert(tables[0].id == "Amis");
+  assert(tables[0].name == "阿美語");
+  assert(tables[0].members.size() == 3);
+  assert(tables[0].entryCount == 0);  // unknown for JSON tables
+
+  // The members are loaded as they are, and unknown ones are left out. A
+  // member that is loaded already is shared.
+  assert(manager.setTable("TW_00"));
+  auto member = manager.currentTableSnapshot();
+  assert(manager.setTable("Amis"));
+  auto table = manager.currentTableSnapshot();
+  assert(table->name() == "阿美語");
+  assert(table->size() == 0);
+  assert(table->members().size() == 2);
+  assert(table->members()[0].label == "南勢阿美語");
+  assert(table->members()[1].label == "秀姑巒阿美語");
+  assert(table->members()[1].table->size() == 2);
+  assert(table->memoryUsage() > table->members()[0].table->memoryUsage());
+  assert(table->members()[0].table == member);
+  assert(manager.memoryUsage() == table->memoryUsage());
+
+  // A changed member reloads the union.
+  createTestTable(dir / "TW_01.json", "Updated");
+  manager.reloadFile("TW_01.json");
+  assert(manager.currentTable().members()[1].table->name() == "Updated");
+
+  // A loaded member is reloaded first, and the union shares the new one.
+  createTestTable(dir / "TW_00.json", "Changed");
+  manager.reloadFile("TW_00.json");
+  table = manager.currentTableSnapshot();
+  assert(table->members()[0].table->name() == "Changed");
+  assert(manager.setTable("TW_00"));
+  assert(manager.currentTableSnapshot() == table->members()[0].table);
+  assert(manager.setTable("Amis"));
+
+  // So does a changed union.
+  {
+    std::ofstream out(dir / "Amis.union");
+    out << R"({"name": "阿美語", "tables": ["TW_01"]})";
+  }
+  manager.reloadFile("Amis.union");
+  assert(manager.currentTable().members().size() == 1);
+
+  std::filesystem::remove_all(dir);
+  std::cout << "Unions test passed" << std::endl;
+}
+
+int main() {
+  testProbeTables();
+  testManifest();
+  testTableCache();
+  testBackgroundLoading();
+  testReload();
+  testArchives();
+  testUnions();
+  testIdleEviction();
+  testDataDirectories();
+  return 0;
+}
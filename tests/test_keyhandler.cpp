@@ -1,5 +1,6 @@
 #include <cassert>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <fstream>
 #include <filesystem>
@@ -10,6 +11,7 @@
 #include "../src/keyhandler.h"
 #include "../src/inputtable.h"
 #include "../src/completer.h"
+#include "../src/userdictionary.h"
 
 using namespace McFoxIM;
 
@@ -31,11 +33,11 @@ void testKeyHandler() {
   std::string testFile = "test_keyhandler_data.json";
   createTestTable(testFile);
 
-  InputTable table;
-  bool loaded = table.load(testFile);
+  auto table = std::make_shared<InputTable>();
+  bool loaded = table->load(testFile);
   assert(loaded);
 
-  Completer completer([&table]() -> const InputTable& { return table; });
+  Completer completer([table]() { return table; });
   KeyHandler handler(completer);
 
   // Helper to run handle
@@ -130,6 +132,93 @@ void testKeyHandler() {
     assert(commitState->commitString() == "a "); 
   }
 
+  // Test 6: '*' starts an infix search only when it is enabled
+  {
+    InputState::EmptyState state;
+    fcitx::KeyEvent event(nullptr, fcitx::Key("*"), false);
+    assert(runHandle(event, state) == nullptr);
+
+    handler.setInfixSearch(true);
+    auto newState = runHandle(event, state);
+    auto inputState = dynamic_cast<InputState::InputtingState*>(newState.get());
+    assert(inputState != nullptr);
+    assert(inputState->composingBuffer() == "*");
+    assert(inputState->candidates().empty());
+
+    fcitx::KeyEvent b(nullptr, fcitx::Key("b"), false);
+    newState = runHandle(b, *inputState);
+    inputState = dynamic_cast<InputState::InputtingState*>(newState.get());
+    assert(inputState != nullptr);
+    assert(inputState->composingBuffer() == "*b");
+    assert(inputState->candidates().size() == 1);
+    assert(inputState->candidates()[0].displayText() == "b");
+    handler.setInfixSearch(false);
+  }
+
+  // Test 7: '=' looks up the selected text in the descriptions
+  {
+    InputState::EmptyState state;
+    fcitx::KeyEvent event(nullptr, fcitx::Key("="), false);
+    assert(runHandle(event, state) == nullptr);
+
+    handler.setGlossLookup(true);
+    handler.setSelectionProvider([]() { return std::string("B"); });
+    auto newState = runHandle(event, state);
+    auto inputState = dynamic_cast<InputState::InputtingState*>(newState.get());
+    assert(inputState != nullptr);
+    assert(inputState->composingBuffer() == "=B");
+    assert(inputState->candidates().size() == 1);
+    assert(inputState->candidates()[0].displayText() == "b");
+
+    fcitx::KeyEvent one(nullptr, fcitx::Key("1"), false);
+    newState = runHandle(one, *inputState);
+    auto commitState =
+        dynamic_cast<InputState::CommittingState*>(newState.get());
+    assert(commitState != nullptr);
+    assert(commitState->commitString() == "b");
+    handler.setGlossLookup(false);
+  }
+
+  // Shift+Delete forgets a learned word, but not the words of the table.
+  {
+    auto dir = std::filesystem::temp_directory_path() / "fox_test_forget";
+    std::filesystem::remove_all(dir);
+    UserDictionary dictionary(dir.string(), "TW_Test");
+    assert(dictionary.add("bb", "Learned"));
+    completer.setUserDictionaryProvider([&]() { return &dictionary; });
+
+    InputState::EmptyState state;
+    fcitx::KeyEvent b(nullptr, fcitx::Key("b"), false);
+    auto newState = runHandle(b, state);
+    auto inputState = dynamic_cast<InputState::InputtingState*>(newState.get());
+    assert(inputState != nullptr);
+    assert(inputState->candidates().size() == 2);
+
+    InputState::InputtingState::Args args;
+    args.cursorIndex = inputState->cursorIndex();
+    args.composingBuffer = inputState->composingBuffer();
+    args.candidates = inputState->candidates();
+    args.selectedCandidateIndex = 1;
+    InputState::InputtingState selected(args);
+    assert(selected.candidatesInCurrentPage()[1].displayText() == "bb");
+
+    fcitx::KeyEvent forget(nullptr, fcitx::Key("Shift+Delete"), false);
+    assert(runHandle(forget, selected) == nullptr);
+    handler.setWordRemover(
+        [&](const std::string& word) { return dictionary.remove(word); });
+    newState = runHandle(forget, selected);
+    inputState = dynamic_cast<InputState::InputtingState*>(newState.get());
+    assert(inputState != nullptr);
+    assert(inputState->composingBuffer() == "b");
+    assert(inputState->candidates().size() == 1);
+    assert(inputState->candidates()[0].displayText() == "b");
+    assert(dictionary.size() == 0);
+
+    assert(runHandle(forget, *inputState) == nullptr);
+    completer.setUserDictionaryProvider(nullptr);
+    std::filesystem::remove_all(dir);
+  }
+
   std::filesystem::remove(testFile);
   std::cout << "KeyHandler test passed" << std::endl;
 }